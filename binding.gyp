@@ -5,8 +5,15 @@
             'sources': [
                 'src/module.cpp',
                 'src/arcsim_binding.cpp',
+                'src/mesh_generation.cpp',
+                'src/mesh_cache.cpp',
+                'src/obstacle_sdf.cpp',
+                'src/sdf/triangle_bvh.cpp',
+                'src/sdf/sdf_builder.cpp',
+                'src/sdf/sdf_codec.cpp',
                 'src/arcsim_translator.cpp',        
                 'src/translation/arcsim_translation.cpp',
+                'src/translation/position_codec.cpp',
                 'src/jsoncpp.cpp'
             ],
             'include_dirs': [
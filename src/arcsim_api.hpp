@@ -0,0 +1,141 @@
+#ifndef ARCSIM_API_HPP_
+#define ARCSIM_API_HPP_
+
+#pragma once
+
+#include "interface.hpp"
+#include "shared_library.hpp"
+
+#include <string>
+#include <stdexcept>
+
+namespace api_functions {
+typedef uint32_t arcsim_version(unsigned int* major, unsigned int* minor, unsigned int* patch, char* build);
+typedef uint32_t api_version(unsigned int* major, unsigned int* minor);
+typedef uint32_t create_session(int version_major, int version_minor, SessionType session_type, int* out_handle);
+typedef uint32_t destroy_session(int session_handle);
+typedef uint32_t get_error_message(int session_handle, const char*& message );
+typedef uint32_t validate_garment(const char *json, BinBlob *bin);
+typedef uint32_t validate_garment_from_file(const char* json_file, const char* bin_file);
+typedef uint32_t validate_body(const char *json, BinBlob *bin);
+typedef uint32_t validate_body_from_file(const char* json_file, const char* bin_file);
+typedef uint32_t add_garment(int session_handle, const char* name, const char* json, BinBlob* bin, int* out_handle);
+typedef uint32_t add_garment_from_file(int session_handle, const char* json_file, const char* bin_file, int* out_handle);
+typedef uint32_t add_handle(int session_handle, int garment_handle, const char* json, int* out_handle );
+typedef uint32_t remove_handle(int session_handle, int handle_handle );
+typedef uint32_t get_last_handle_id(int session_handle, int* last_handle_id);
+typedef uint32_t set_handle_properties( int session_handle, int handle_handle, HandleParams* params);
+typedef uint32_t get_handle_properties( int session_handle, int handle_handle, HandleParams* params);
+typedef uint32_t get_handle_locations( int session_handle, int handle_handle, HandleLocations** locations);
+typedef uint32_t free_handle_locations( int session_handle, HandleLocations* locations);
+typedef uint32_t add_obstacle(int session_handle, const char *json, BinBlob *bin, int* out_handle);
+typedef uint32_t add_obstacle_from_file(int session_handle, const char* json_file, const char* bin_file, int* out_handle);
+typedef uint32_t add_obstacle_frame(int session_handle, int obstacle_handle, int frame, BinBlob *bin);
+typedef uint32_t add_obstacle_frame_from_file(int session_handle, int obstacle_handle, int frame, const char* bin_file);
+typedef uint32_t get_garment_mesh(int session_handle, int garment_handle, BinBlob** out_mesh, bool export_sim_metadata);
+typedef uint32_t free_garment_mesh(BinBlob* mesh);
+typedef uint32_t save_mesh(int session_handle, int garment_handle, const char *out_filename);
+typedef uint32_t extrude_mesh(int session_handle, int garment_handle, BinBlob** out_mesh);
+typedef uint32_t finalize_mesh(int session_handle);
+typedef uint32_t freeze_piece(int session_handle, int garment_handle, const char* piece_name);
+typedef uint32_t unfreeze_piece(int session_handle, int garment_handle, const char* piece_name);
+typedef uint32_t prepare_simulation(int session_handle, SimParams* params);
+typedef uint32_t get_default_simulation_parameters(SimParams *params);
+typedef uint32_t damp_velocities(int session_handle, double factor);
+typedef uint32_t prepare_stitching(int session_handle, StitchingParams* params);
+typedef uint32_t get_default_stitching_parameters(StitchingParams *params);
+typedef uint32_t prepare_meshing(int session_handle, MeshingParams* params);
+typedef uint32_t get_default_meshing_parameters(MeshingParams* params);
+typedef uint32_t get_session_status(int session_handle, SessionStatus* out_status);
+typedef uint32_t start_session(int session_handle);
+typedef uint32_t pause_session(int session_handle);
+typedef uint32_t reset_session(int session_handle);
+}
+
+#define ARCSIM_API_FUNCTIONS(F)                 \
+    F(arcsim_version)                           \
+    F(api_version)                              \
+    F(create_session)                           \
+    F(destroy_session)                          \
+    F(get_error_message)                        \
+    F(validate_garment)                         \
+    F(validate_garment_from_file)               \
+    F(validate_body)                            \
+    F(validate_body_from_file)                  \
+    F(add_garment)                              \
+    F(add_garment_from_file)                    \
+    F(add_handle)                               \
+    F(remove_handle)                            \
+    F(get_last_handle_id)                       \
+    F(set_handle_properties)                    \
+    F(get_handle_properties)                    \
+    F(get_handle_locations)                     \
+    F(free_handle_locations)                    \
+    F(add_obstacle)                             \
+    F(add_obstacle_from_file)                   \
+    F(add_obstacle_frame)                       \
+    F(add_obstacle_frame_from_file)             \
+    F(get_garment_mesh)                         \
+    F(free_garment_mesh)                        \
+    F(save_mesh)                                \
+    F(extrude_mesh)                             \
+    F(finalize_mesh)                            \
+    F(freeze_piece)                             \
+    F(unfreeze_piece)                           \
+    F(prepare_simulation)                       \
+    F(get_default_simulation_parameters)        \
+    F(damp_velocities)                          \
+    F(prepare_stitching)                        \
+    F(get_default_stitching_parameters)         \
+    F(prepare_meshing)                          \
+    F(get_default_meshing_parameters)           \
+    F(get_session_status)                       \
+    F(start_session)                            \
+    F(pause_session)                            \
+    F(reset_session)
+
+
+// Dispatch table for the ARCSim library. Every entry point is resolved once
+// when the library is loaded; calls through the table are a plain indirect
+// call, which keeps symbol lookups off the per-frame callback path.
+struct ArcsimApi
+{
+#define ARCSIM_API_DECLARE(name) api_functions:: name * name = {nullptr};
+    ARCSIM_API_FUNCTIONS(ARCSIM_API_DECLARE)
+#undef ARCSIM_API_DECLARE
+
+    // Interface version reported by the library, passed to create_session
+    unsigned int api_major = {0};
+    unsigned int api_minor = {0};
+
+    explicit ArcsimApi(ARCSim::SharedLibrary::HandleType plugin_handle)
+    {
+#define ARCSIM_API_RESOLVE(name) name = Resolve< api_functions:: name >(plugin_handle, #name);
+        ARCSIM_API_FUNCTIONS(ARCSIM_API_RESOLVE)
+#undef ARCSIM_API_RESOLVE
+
+        if( !api_version )
+            throw std::runtime_error("Library does not export api_version");
+        if( api_version(&api_major, &api_minor) != ARC_OK )
+            throw std::runtime_error("Could not query the library api version");
+        if( api_major != INTERFACE_API_BINARY_VERSION_MAJOR )
+            throw std::runtime_error( "Incompatible api version " + std::to_string(api_major) + "." + std::to_string(api_minor) +
+                                      ", binding expects " + std::to_string(INTERFACE_API_BINARY_VERSION_MAJOR) + ".x" );
+    }
+
+private:
+    template<typename TSignature>
+    static TSignature* Resolve(ARCSim::SharedLibrary::HandleType plugin_handle, const char* name)
+    {
+        // Not every engine build exports every entry point; missing ones are
+        // reported when they are called.
+        try {
+            return ARCSim::SharedLibrary::GetFunctionPointer<TSignature>(plugin_handle, name);
+        }
+        catch( std::runtime_error& ) {
+            return nullptr;
+        }
+    }
+};
+
+#endif
@@ -1,97 +1,77 @@
 #include "arcsim_binding.hpp"
 #include "interface.hpp"
 #include <translation/arcsim_translation.hpp>
+#include <translation/position_codec.hpp>
 
 #include <iostream>
 #include <string>
+#include <cstdio>
 #include <fstream>
 #include <type_traits>
+#include <array>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <set>
+
+#include <deque>
 
 #include "napi-thread-safe-callback.hpp"
+#include "delivery_queue.hpp"
+#include "frame_ring.hpp"
+#include "session_pool.hpp"
+#include "worker_pool.hpp"
+#include "mesh_generation.hpp"
+#include "mesh_cache.hpp"
+#include "obstacle_cache.hpp"
+#include "obstacle_sdf.hpp"
+#include "external_buffer.hpp"
 
 
 
 using namespace Napi;
 
-namespace api_functions {
-typedef uint32_t arcsim_version(unsigned int* major, unsigned int* minor, unsigned int* patch, char* build);
-typedef uint32_t api_version(unsigned int* major, unsigned int* minor);
-typedef uint32_t create_session(int version_major, int version_minor, SessionType session_type, int* out_handle);
-typedef uint32_t destroy_session(int session_handle);
-typedef uint32_t get_error_message(int session_handle, const char*& message );
-typedef uint32_t validate_garment(const char *json, BinBlob *bin);
-typedef uint32_t validate_garment_from_file(const char* json_file, const char* bin_file);
-typedef uint32_t validate_body(const char *json, BinBlob *bin);
-typedef uint32_t validate_body_from_file(const char* json_file, const char* bin_file);
-typedef uint32_t add_garment(int session_handle, const char* name, const char* json, BinBlob* bin, int* out_handle);
-typedef uint32_t add_garment_from_file(int session_handle, const char* json_file, const char* bin_file, int* out_handle);
-typedef uint32_t add_handle(int session_handle, int garment_handle, const char* json, int* out_handle );
-typedef uint32_t remove_handle(int session_handle, int handle_handle );
-typedef uint32_t get_last_handle_id(int session_handle, int* last_handle_id);    
-typedef uint32_t set_handle_properties( int session_handle, int handle_handle, HandleParams* params);
-typedef uint32_t get_handle_properties( int session_handle, int handle_handle, HandleParams* params);
-typedef uint32_t get_handle_locations( int session_handle, int handle_handle, HandleLocations** locations);
-typedef uint32_t free_handle_locations( int session_handle, HandleLocations* locations);    
-typedef uint32_t add_obstacle(int session_handle, const char *json, BinBlob *bin, int* out_handle);
-typedef uint32_t add_obstacle_from_file(int session_handle, const char* json_file, const char* bin_file, int* out_handle);
-typedef uint32_t add_obstacle_frame(int session_handle, int obstacle_handle, int frame, BinBlob *bin);
-typedef uint32_t add_obstacle_frame_from_file(int session_handle, int obstacle_handle, int frame, const char* bin_file);
-typedef uint32_t get_garment_mesh(int session_handle, int garment_handle, BinBlob** out_mesh, bool export_sim_metadata);
-typedef uint32_t free_garment_mesh(BinBlob* mesh);
-typedef uint32_t save_mesh(int session_handle, int garment_handle, const char *out_filename);
-typedef uint32_t extrude_mesh(int session_handle, int garment_handle, BinBlob** out_mesh);
-typedef uint32_t finalize_mesh(int session_handle);
-typedef uint32_t freeze_piece(int session_handle, int garment_handle, const char* piece_name);
-typedef uint32_t unfreeze_piece(int session_handle, int garment_handle, const char* piece_name);
-typedef uint32_t prepare_simulation(int session_handle, SimParams* params);
-typedef uint32_t get_default_simulation_parameters(SimParams *params);
-typedef uint32_t damp_velocities(int session_handle, double factor);
-typedef uint32_t prepare_stitching(int session_handle, StitchingParams* params);
-typedef uint32_t get_default_stitching_parameters(StitchingParams *params);
-typedef uint32_t prepare_meshing(int session_handle, MeshingParams* params);
-typedef uint32_t get_default_meshing_parameters(MeshingParams* params);
-typedef uint32_t get_session_status(int session_handle, SessionStatus* out_status);
-typedef uint32_t start_session(int session_handle);
-typedef uint32_t pause_session(int session_handle);
-typedef uint32_t reset_session(int session_handle);
-}
-
-
-
+// Blob layout the engine reads; newer layouts are only used by the binding
+typedef Geometry::blob_formats::format_0_3 EngineBlobFormat;
 
 #define STRINGIFY(name) #name
 #define GetFunction(name, ...) \
     {\
-        std::cout << "Calling " << STRINGIFY(name) << " from ARCSim Library..." << std::endl;\
-        api_functions:: name * fnc_ptr;\
-        try {\
-            fnc_ptr = ARCSim::SharedLibrary::GetFunctionPointer< api_functions:: name >(plugin_handle_, STRINGIFY(name)); \
-        }\
-        catch( std::exception& err ) {\
-            Napi::Error::New(env, std::string("Binding Error: ") + err.what()).ThrowAsJavaScriptException();\
-            return env.Null();\                                                            
+        if( !api_ || !api_->name ) {\
+            Napi::Error::New(env, std::string("Binding Error: ARCSim library does not export ") + STRINGIFY(name)).ThrowAsJavaScriptException();\
+            return env.Null();\
         }\
         try{\
-           validate(env, fnc_ptr(__VA_ARGS__ ) );\
+           validate(env, api_->name(__VA_ARGS__ ) );\
         }\
         catch( ... ) {\
             Napi::Error::New(env, std::string("Unknown Error") ).ThrowAsJavaScriptException();\
-            return env.Null();\                                                            
+            return env.Null();\
         }\
 };
 
-#define GetFunctionNoReturn(name, ...) \
+// Variant for Napi::AsyncWorker::Execute, which must report errors through
+// SetError since no JS exceptions can be thrown off the main thread
+#define GetFunctionAsync(name, ...) \
     {\
-        std::cout << "Calling " << STRINGIFY(name) << " from ARCSim Library..." << std::endl;\
-        api_functions:: name * fnc_ptr;\
-        try {\
-            fnc_ptr = ARCSim::SharedLibrary::GetFunctionPointer< api_functions:: name >(plugin_handle_, STRINGIFY(name)); \
+        if( !api_ || !api_->name ) {\
+            SetError(std::string("Binding Error: ARCSim library does not export ") + STRINGIFY(name));\
+            return;\
         }\
-        catch( std::exception& err ) {\
-            Napi::Error::New(env, std::string("Binding Error: ") + err.what()).ThrowAsJavaScriptException();\
+        ErrorCode code = api_->name(__VA_ARGS__ );\
+        if( code != ARC_OK ) {\
+            SetError(std::string("ARCSim Error: ") + translateError( code ));\
+            return;\
         }\
-        try{\
-           validate(env, fnc_ptr(__VA_ARGS__ ) );\
+};
+
+#define GetFunctionNoReturn(name, ...) \
+    {\
+        if( !api_ || !api_->name ) {\
+            Napi::Error::New(env, std::string("Binding Error: ARCSim library does not export ") + STRINGIFY(name)).ThrowAsJavaScriptException();\
+        }\
+        else try{\
+           validate(env, api_->name(__VA_ARGS__ ) );\
         }\
         catch( ... ) {\
             Napi::Error::New(env, std::string("Unknown Error") ).ThrowAsJavaScriptException();\
@@ -99,16 +79,125 @@ typedef uint32_t reset_session(int session_handle);
 };
 
 
+// A frame captured on the engine's callback thread, waiting to be translated
+struct FrameJob {
+    CallbackData data;
+    std::vector< std::pair<int, BinBlob*> > meshes;
+    bool has_error = {false};
+    std::string error_msg;
+};
+
+// Topology last delivered to JS for a garment
+struct TopologyState {
+    uint64_t hash = {0};
+    uint32_t version = {0};
+    bool delivered = {false};
+};
+
+// Topology of one packed garment frame, reported next to its bytes
+struct FrameTopology {
+    uint64_t hash;
+    uint32_t version;
+    bool included;
+};
+typedef std::vector<FrameTopology> FrameTopologyList;
+
+// Everything handed to JS for one frame. The lists run parallel to each
+// other, with one entry per packed garment.
+struct FrameOutput {
+    PackedBufferList garments_bytes = std::make_shared< std::vector<PackedBuffer> >();
+    PackedBufferList garments_positions = std::make_shared< std::vector<PackedBuffer> >();
+    FrameTopologyList garments_topology;
+};
+
+// A packed frame waiting in the delivery queue for the JS callback
+struct PendingFrame {
+    CallbackData data;
+    FrameOutput output;
+    bool has_error = {false};
+    std::string error_msg;
+};
+
+// Number of CallbackType values, for per event type settings
+const int CALLBACK_TYPE_COUNT = CT_Error + 1;
+
 struct BindingContext {
     BindingContext(Napi::Env& env) :
         env(env)
-    {}
+    {
+        mesh_interval.fill( 1 );
+        event_count.fill( 0 );
+    }
+
+    std::vector<int> GetGarmentHandles() {
+        std::lock_guard<std::mutex> lock(handles_mutex);
+        return garment_handles;
+    }
 
     std::vector<int> garment_handles, obstacle_handles;    
-    ARCSim::SharedLibrary::HandleType plugin_handle_;
+    std::mutex handles_mutex;
+    std::shared_ptr<const ArcsimApi> api_;
     Napi::Env env;
-    ThreadSafeCallback* callback;
+    std::unique_ptr<ThreadSafeCallback> callback;
     std::string garment_json;    
+
+    // Off-thread frame extraction, enabled by the async_frames option. The
+    // queue holds up to frame_queue_size jobs; it and stop_frame_worker are
+    // guarded by frame_mutex, under which both sides wait.
+    uint32_t frame_queue_size = {0};
+    std::deque< std::unique_ptr<FrameJob> > frame_queue;
+    std::thread frame_worker;
+    bool stop_frame_worker = {false};
+    std::mutex frame_mutex;
+    std::condition_variable frame_available;
+    std::condition_variable frame_space;
+
+    // Frames leave out unchanged topology, enabled by the topology_streaming
+    // option. Only touched by whichever thread packs the frames.
+    bool topology_streaming = {false};
+    std::map<int, TopologyState> garment_topology;
+
+    // Positions are sent quantized next to the frames instead of inside
+    // them, enabled by the quantize_positions option. With delta_positions
+    // they are coded against the last frame delivered for the garment.
+    bool quantize_positions = {false};
+    bool delta_positions = {false};
+    std::map<int, std::vector<uint16_t> > garment_positions;
+
+    // Frames handed to JS but not yet taken by the callback, bounded as set
+    // by the delivery_policy and delivery_queue_size options. Shared with
+    // the callbacks still pending, which may run after the context is gone.
+    std::shared_ptr< DeliveryQueue<PendingFrame> > delivery;
+
+    // Which engine events reach JS, and how often each type carries the
+    // garment meshes, set by the event_mask and mesh_interval options. Only
+    // touched by the engine's callback thread.
+    uint32_t event_mask = {~0u};
+    std::array< uint32_t, CALLBACK_TYPE_COUNT > mesh_interval;
+    std::array< uint32_t, CALLBACK_TYPE_COUNT > event_count;
+
+    bool WantsEvent( int type ) const
+    {
+        // Errors are always reported
+        return type == CT_Error || type < 0 || type >= 32 || ( event_mask & ( 1u << type ) );
+    }
+
+    // Counts the event; true if this one should carry the meshes
+    bool WantsMeshes( int type )
+    {
+        if( type == CT_Error )
+            return false;
+        if( type < 0 || type >= CALLBACK_TYPE_COUNT )
+            return true;
+        const uint32_t interval = mesh_interval[type];
+        return interval != 0 && event_count[type]++ % interval == 0;
+    }
+
+    // Status and positions shared with JS through a SharedArrayBuffer, set
+    // by the frame_ring option. The reference keeps the buffer alive.
+    std::unique_ptr<FrameRingWriter> frame_ring;
+    Napi::ObjectReference frame_ring_buffer;
+    bool ring_delivers_meshes = {false};
 };
 
 struct ARCSimSession
@@ -116,7 +205,14 @@ struct ARCSimSession
     SimParams params;
     MeshingParams meshing_params;    
     bool has_initialized;
-    BindingContext* context = {nullptr};    
+    // Owns the context and with it the JS callback
+    std::unique_ptr<BindingContext> context;
+
+    // Serializes asset ingestion into the engine; conversion runs unlocked
+    std::mutex engine_mutex;
+    // Set under engine_mutex once the engine session is going away; its
+    // handle may then be handed out again
+    bool destroyed = {false};
 };
 
 
@@ -158,14 +254,27 @@ void validate(Napi::Env& env, ErrorCode code ){
 }
 
 
+// The engine has a single log callback for the whole process, shared by the
+// bindings of every Node environment. It is installed by the first
+// SetupLogging and removed by the last TearDownLogging; the engine may log
+// from any thread.
 class LogData
 {
 public:
     std::unique_ptr< std::ofstream > logfile;
     std::string logpath;
-    bool isFileLogging;
+    bool isFileLogging = {false};
+    int users = {0};
+    // Recursive, since removing the callback may call CloseHandler
+    std::recursive_mutex mutex;
 };
 
+LogData& GetLogData()
+{
+    static LogData log_data;
+    return log_data;
+}
+
 std::ostream& operator<<(std::ostream& os, const LogMessage& message)
 {
     os << message.preamble;
@@ -180,6 +289,7 @@ std::ostream& operator<<(std::ostream& os, const LogMessage& message)
 void LogHandler( void* user_data, const LogMessage* message )
 {
     LogData& logdata = *reinterpret_cast<LogData*>( user_data );
+    std::lock_guard<std::recursive_mutex> lock( logdata.mutex );
 
     if( logdata.isFileLogging ) {
         std::ofstream &os = *(logdata.logfile);
@@ -196,6 +306,7 @@ void LogHandler( void* user_data, const LogMessage* message )
 void CloseHandler( void* user_data )
 {                           
     LogData& logdata = *reinterpret_cast<LogData*>( user_data );
+    std::lock_guard<std::recursive_mutex> lock( logdata.mutex );
     if( logdata.isFileLogging ) {
         (*logdata.logfile).close();
         logdata.isFileLogging = false;        
@@ -205,6 +316,7 @@ void CloseHandler( void* user_data )
 void FlushHandler( void* user_data )
 {
     LogData& logdata = *reinterpret_cast<LogData*>( user_data );
+    std::lock_guard<std::recursive_mutex> lock( logdata.mutex );
     if( logdata.isFileLogging ) {
         (*logdata.logfile).flush();
     }
@@ -212,9 +324,13 @@ void FlushHandler( void* user_data )
     std::cerr.flush();
 }
 
+// Only the first of concurrent users sets the verbosity and log file
 void SetupLogging(int verbosity, std::string log_file )
 {
-    static LogData log_data;
+    LogData& log_data = GetLogData();
+    std::lock_guard<std::recursive_mutex> lock( log_data.mutex );
+    if( log_data.users++ > 0 )
+        return;
     
     log_data.isFileLogging = false;
     if( log_file != "" ){
@@ -228,13 +344,615 @@ void SetupLogging(int verbosity, std::string log_file )
 
 void TearDownLogging()
 {
+    LogData& log_data = GetLogData();
+    std::lock_guard<std::recursive_mutex> lock( log_data.mutex );
+    if( log_data.users == 0 || --log_data.users > 0 )
+        return;
     api_log_callback(nullptr, nullptr, (LogVerbosity) 0, nullptr, nullptr);
 }
 
 
+// Translates a garment mesh into a packed GarmentFrame and adds it to the
+// frame output. Depending on the session options the topology is left out
+// when it matches the last frame delivered for the garment, and the
+// positions are sent quantized in a buffer of their own.
+void PackGarmentFrame( BindingContext& context, int garment_id, const Geometry::Blob& blob,
+                       const SessionStatus& status, FrameOutput& output )
+{
+    uint32_t content = ARCSimTranslation::FRAME_ALL;
+    if( context.quantize_positions )
+        content &= ~ARCSimTranslation::FRAME_POSITIONS;
+
+    TopologyState* topology = nullptr;
+    uint64_t topology_hash = 0;
+    if( context.topology_streaming ){
+        topology = &context.garment_topology[garment_id];
+        topology_hash = blob.TopologyHash();
+        if( topology->delivered && topology->hash == topology_hash )
+            content &= ~ARCSimTranslation::FRAME_TOPOLOGY;
+    }
+
+    // Straight from the blob into a builder sized up front, skipping GarmentFrameT
+    flatbuffers::FlatBufferBuilder fbb( ARCSimTranslation::EstimateGarmentFrameSize( blob, content ) );
+    auto garment_frame = ARCSimTranslation::PackGarmentFrame( fbb, blob, status.frame, status.steps, status.time, content );
+    fbb.Finish( garment_frame, nullptr );
+    output.garments_bytes->push_back( fbb.Release() );
+
+    if( context.quantize_positions ){
+        const auto& vertices = blob.Get3DVertices();
+        output.garments_positions->push_back(
+            PositionCodec::Encode( reinterpret_cast<const float*>( vertices.data() ), blob.NumVertices(), garment_id,
+                                   context.delta_positions ? &context.garment_positions[garment_id] : nullptr ) );
+    }
+
+    if( topology ){
+        const bool included = ( content & ARCSimTranslation::FRAME_TOPOLOGY ) != 0;
+        if( included ){
+            topology->hash = topology_hash;
+            topology->version++;
+            topology->delivered = true;
+        }
+        output.garments_topology.push_back( { topology_hash, topology->version, included } );
+    }
+}
+
+// Hands a garment mesh returned by the engine to the frame ring, if the
+// session has one, and to the frame output unless the ring replaces it
+void ProcessGarmentMesh( BindingContext& context, int garment_id, const BinBlob& garment_data,
+                         const SessionStatus& status, FrameOutput& output )
+{
+    Geometry::Blob blob;
+    blob.Load( garment_data );
+
+    if( context.frame_ring )
+        context.frame_ring->AddGarment( garment_id, reinterpret_cast<const float*>( blob.Get3DVertices().data() ), blob.NumVertices() );
+    if( !context.frame_ring || context.ring_delivers_meshes )
+        PackGarmentFrame( context, garment_id, blob, status, output );
+}
+
+// Forgets what was delivered for every garment, for when a packed frame
+// never reaches JS: the next frame then carries full topology and positions
+void ResetGarmentStreams( BindingContext& context )
+{
+    for( auto& topology : context.garment_topology )
+        topology.second.delivered = false;
+    context.garment_positions.clear();
+}
+
+// Called before packing a frame. When the delivery queue may drop frames
+// and JS is behind, the frame is packed in full, so dropping never leaves
+// JS with a frame whose topology or position deltas refer to a dropped one.
+void PrepareFramePacking( BindingContext& context )
+{
+    if( context.delivery && context.delivery->Policy() != DeliveryPolicy::Block && context.delivery->Depth() > 0 )
+        ResetGarmentStreams( context );
+}
+
+// Progress updates may be dropped by the delivery queue; state changes and
+// errors are always delivered
+bool IsDroppableFrame( const CallbackData& data, bool has_error )
+{
+    if( has_error )
+        return false;
+    switch( data.type ){
+    case CT_CollisionStep:
+    case CT_OptimizationStep:
+    case CT_RemeshingStep:
+    case CT_SimulationFrame:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Queues a frame for the JS callback, which runs on the main thread. Every
+// frame added to the delivery queue schedules one callback, which takes the
+// oldest frame; frames replacing a dropped one reuse its callback.
+void DeliverFrame( BindingContext& context, const CallbackData& data,
+                   FrameOutput&& output,
+                   bool has_error, const std::string& error_msg )
+{
+    PendingFrame frame;
+    frame.data = data;
+    frame.output = std::move( output );
+    frame.has_error = has_error;
+    frame.error_msg = error_msg;
+    switch( context.delivery->Push( std::move( frame ), IsDroppableFrame( data, has_error ) ) ){
+    case DeliveryQueue<PendingFrame>::PUSHED:
+        break;
+    case DeliveryQueue<PendingFrame>::REPLACED:
+        return;
+    case DeliveryQueue<PendingFrame>::DROPPED:
+        // JS never sees this frame, the next one has to be complete
+        ResetGarmentStreams( context );
+        return;
+    }
+
+    std::shared_ptr< DeliveryQueue<PendingFrame> > delivery = context.delivery;
+    context.callback->call([delivery](Napi::Env env, std::vector<napi_value>& args)
+    {
+        PendingFrame frame;
+        delivery->TryPop( frame );
+        const CallbackData& data = frame.data;
+        const FrameOutput& output = frame.output;
+
+        const int type = data.type;
+        const FrameTopologyList& garments_topology = output.garments_topology;
+        Napi::Array garment_updates = Napi::Array::New(env);
+            
+        for( size_t i = 0; i< output.garments_bytes->size(); ++i)
+            garment_updates[i] = ToExternalByteArray( env, std::move( (*output.garments_bytes)[i] ) );
+            
+        Napi::Object status = Napi::Object::New(env);
+        status.Set("handle", Napi::Number::New(env, data.session_status.handle));
+        status.Set("type",  Napi::Number::New(env, data.session_status.type));
+        status.Set("state",  Napi::Number::New(env, data.session_status.state));
+        status.Set("frame",  Napi::Number::New(env, data.session_status.frame));
+        status.Set("steps",  Napi::Number::New(env, data.session_status.steps));
+        status.Set("time",  Napi::Number::New(env, data.session_status.time));
+        if(frame.has_error)
+            status.Set("error", Napi::String::New(env, frame.error_msg));            
+        status.Set("garment_data", garment_updates );
+        status.Set("queue_depth", Napi::Number::New(env, delivery->Depth()));
+        status.Set("dropped_frames", Napi::Number::New(env, delivery->Dropped()));
+
+        // One entry per garment_data buffer; the hash is a hex string since
+        // it doesn't fit a JS number
+        if( !garments_topology.empty() ){
+            Napi::Array topology = Napi::Array::New(env);
+            for( size_t i = 0; i < garments_topology.size(); ++i ){
+                char hash_hex[17];
+                snprintf( hash_hex, sizeof(hash_hex), "%016llx", (unsigned long long) garments_topology[i].hash );
+                Napi::Object entry = Napi::Object::New(env);
+                entry.Set("version", Napi::Number::New(env, garments_topology[i].version));
+                entry.Set("hash", Napi::String::New(env, hash_hex));
+                entry.Set("included", Napi::Boolean::New(env, garments_topology[i].included));
+                topology[i] = entry;
+            }
+            status.Set("garment_topology", topology );
+        }
+
+        // Quantized positions, decoded with QuantizedPositionDecoder in index.js
+        if( !output.garments_positions->empty() ){
+            Napi::Array positions = Napi::Array::New(env);
+            for( size_t i = 0; i < output.garments_positions->size(); ++i )
+                positions[i] = ToExternalByteArray( env, std::move( (*output.garments_positions)[i] ) );
+            status.Set("garment_positions", positions );
+        }
+            
+        args = { Napi::Number::New(env, type),
+                 Napi::Number::New(env, data.session_handle),
+                 status };
+    });
+}
+
+// Drains the frame queue of a session: translates the captured meshes,
+// returns them to the engine and hands the result to JS. Runs until
+// StopFrameWorker is called and the queue is empty.
+void FrameWorker( BindingContext* context )
+{
+    const std::shared_ptr<const ArcsimApi>& api_ = context->api_;
+    std::deque< std::unique_ptr<FrameJob> >& queue = context->frame_queue;
+    std::unique_ptr<FrameJob> job;
+
+    for(;;){
+        {
+            std::unique_lock<std::mutex> lock( context->frame_mutex );
+            context->frame_available.wait( lock, [&]{
+                    return !queue.empty() || context->stop_frame_worker;
+                });
+            // Stopped, and nothing the engine queued is left
+            if( queue.empty() )
+                return;
+            job = std::move( queue.front() );
+            queue.pop_front();
+        }
+        context->frame_space.notify_one();
+
+        FrameOutput output;
+        PrepareFramePacking( *context );
+        const SessionStatus& status = job->data.session_status;
+        const bool ring_frame = context->frame_ring && !job->meshes.empty();
+        if( ring_frame )
+            context->frame_ring->BeginFrame( job->data.type, status.frame, status.steps, status.time );
+        for( auto& mesh : job->meshes ){
+            if( !job->has_error ){
+                try{
+                    ProcessGarmentMesh( *context, mesh.first, *mesh.second, status, output );
+                }
+                catch( std::exception& err ){
+                    job->has_error = true;
+                    job->error_msg = std::string("Failed to convert garment: ") + err.what();
+                }
+            }
+            api_->free_garment_mesh( mesh.second );
+        }
+        if( ring_frame )
+            context->frame_ring->EndFrame( !job->has_error );
+
+        DeliverFrame( *context, job->data, std::move( output ), job->has_error, job->error_msg );
+        job.reset();
+    }
+}
+
+void StopFrameWorker( BindingContext& context )
+{
+    if( !context.frame_worker.joinable() )
+        return;
+    {
+        std::lock_guard<std::mutex> lock( context.frame_mutex );
+        context.stop_frame_worker = true;
+    }
+    context.frame_available.notify_one();
+    context.frame_space.notify_all();
+    context.frame_worker.join();
+}
+
+// Cuts a session off from JS before its engine session is destroyed or
+// reset: asset workers no longer reach the engine, the engine no longer
+// waits for JS, which can't take frames while the main thread waits for
+// the engine, and the frame worker has handed over what it was given.
+void DetachSession( ARCSimSession& session )
+{
+    {
+        std::lock_guard<std::mutex> lock( session.engine_mutex );
+        session.destroyed = true;
+    }
+    if( session.context ){
+        if( session.context->delivery )
+            session.context->delivery->Close();
+        StopFrameWorker( *session.context );
+    }
+}
+
+
+
+// Converts a packed asset and adds it to a session on the libuv thread pool,
+// so ingesting large assets doesn't block the event loop. The JS callback is
+// called with (handle) on success or (null, error) on failure.
+class AddAssetWorker : public Napi::AsyncWorker
+{
+public:
+    AddAssetWorker(const Napi::Function& callback,
+                   const std::shared_ptr<const ArcsimApi>& api,
+                   int session_handle,
+                   std::shared_ptr<ARCSimSession> session,
+                   Napi::Uint8Array data) :
+        AsyncWorker(callback),
+        api_(api),
+        session_handle(session_handle),
+        session(std::move(session)),
+        data_ref( Napi::Persistent( data.As<Napi::Object>() ) ),
+        data( data.Data() ),
+        data_length( data.ElementLength() ),
+        asset_handle( -1 )
+    {}
+
+protected:
+    void OnOK() override
+    {
+        Napi::Env env = Env();
+        Callback().Call({ Napi::Number::New(env, asset_handle) });
+    }
+
+    void OnError(const Napi::Error& e) override
+    {
+        Napi::Env env = Env();
+        Callback().Call({ env.Null(), e.Value() });
+    }
+
+    // Takes engine_mutex; sets the error and returns false if the session
+    // was destroyed since the worker was queued
+    bool LockSession( std::unique_lock<std::mutex>& lock )
+    {
+        lock = std::unique_lock<std::mutex>( session->engine_mutex );
+        if( session->destroyed ){
+            SetError("Invalid Session Handle");
+            return false;
+        }
+        return true;
+    }
+
+    std::shared_ptr<const ArcsimApi> api_;
+    int session_handle;
+    std::shared_ptr<ARCSimSession> session;
+
+    // Keeps the input array alive while Execute reads it
+    Napi::ObjectReference data_ref;
+    const uint8_t* data;
+    size_t data_length;
+
+    int asset_handle;
+};
+
+class AddGarmentWorker : public AddAssetWorker
+{
+public:
+    using AddAssetWorker::AddAssetWorker;
+
+protected:
+    void Execute() override
+    {
+        std::unique_ptr<ARCSim::GarmentT> fb_garment( UnPackFromBytestream<ARCSim::GarmentT>(data, data_length, nullptr) );
+        if(!fb_garment){
+            SetError("Garment data must be a packed Garment");
+            return;
+        }
+
+        Geometry::Blob blob;
+        std::string garment_json;
+        try{
+            ARCSimTranslation::ConvertFromFB(blob, garment_json, *fb_garment);
+        }
+        catch( std::exception& err ){
+            SetError(std::string("Failed to convert garment: ")+err.what());
+            return;
+        }
+
+        // Serialize once, straight into the buffer handed to the engine,
+        // in the 0.3 layout the engine reads
+        BinBlob garment_blob;
+        std::unique_ptr<char[]> garment_bytes;
+        try{
+            garment_blob.len = blob.SerializedSize<EngineBlobFormat>();
+            garment_bytes.reset( new char[ garment_blob.len ] );
+            blob.Save<EngineBlobFormat>( garment_bytes.get(), garment_blob.len );
+            garment_blob.buffer = garment_bytes.get();
+        }
+        catch( std::exception& err ){
+            SetError(std::string("Failed to serialize garment: ")+err.what());
+            return;
+        }
+
+        std::unique_lock<std::mutex> lock;
+        if( !LockSession( lock ) )
+            return;
+        GetFunctionAsync(validate_garment, garment_json.c_str() , &garment_blob );
+        GetFunctionAsync(add_garment, session_handle, "data_garment", garment_json.c_str(), &garment_blob, &asset_handle);
+    }
+
+    void OnOK() override
+    {
+        // Only now the garment becomes part of the frames sent to JS
+        if(session->context && !session->destroyed){
+            std::lock_guard<std::mutex> lock(session->context->handles_mutex);
+            session->context->garment_handles.push_back( asset_handle );    
+        }
+        AddAssetWorker::OnOK();
+    }
+};
+
+class AddObstacleWorker : public AddAssetWorker
+{
+public:
+    using AddAssetWorker::AddAssetWorker;
+
+protected:
+    void Execute() override
+    {
+        // Bodies already added to a session, this one or another, are not
+        // converted again
+        ObstacleCache::EntryPtr obstacle;
+        try{
+            obstacle = ObstacleCache::Instance().Get( ObstacleCache::KeyOf(data, data_length), [this](){
+                return ConvertObstacle();
+            });
+        }
+        catch( std::exception& err ){
+            SetError(err.what());
+            return;
+        }
+
+        // The entry bytes stay alive while this worker holds on to it
+        BinBlob obstacle_blob;
+        obstacle_blob.buffer = obstacle->bytes.get();
+        obstacle_blob.len = obstacle->len;
+
+        std::unique_lock<std::mutex> lock;
+        if( !LockSession( lock ) )
+            return;
+        if( !api_ || !api_->validate_body ) {
+            SetError("Binding Error: ARCSim library does not export validate_body");
+            return;
+        }
+        ErrorCode code = obstacle->Validate(*api_);
+        if( code != ARC_OK ) {
+            SetError(std::string("ARCSim Error: ") + translateError( code ));
+            return;
+        }
+        GetFunctionAsync(add_obstacle, session_handle, obstacle->json.c_str(), &obstacle_blob, &asset_handle);
+    }
+
+private:
+    ObstacleCache::EntryPtr ConvertObstacle() const
+    {
+        std::unique_ptr<ARCSim::ObstacleFrameT> fb_obsframe( UnPackFromBytestream<ARCSim::ObstacleFrameT>(data, data_length, nullptr) );
+        if(!fb_obsframe)
+            throw std::runtime_error("Obstacle data must be a packed ObstacleFrame");
+
+        std::shared_ptr<ObstacleCache::Entry> entry = std::make_shared<ObstacleCache::Entry>();
+        Geometry::Blob blob;
+        try{
+            ARCSimTranslation::ConvertFromFB(blob, entry->json, *fb_obsframe);
+        }
+        catch( std::exception& err ){
+            throw std::runtime_error(std::string("Failed to convert obstacle: ")+err.what());
+        }
+
+        // Serialize once, straight into the buffer handed to the engine,
+        // in the 0.3 layout the engine reads
+        try{
+            entry->len = blob.SerializedSize<EngineBlobFormat>();
+            entry->bytes.reset( new char[ entry->len ] );
+            blob.Save<EngineBlobFormat>( entry->bytes.get(), entry->len );
+        }
+        catch( std::exception& err ){
+            throw std::runtime_error(std::string("Failed to serialize obstacle: ")+err.what());
+        }
+        return entry;
+    }
+};
+
+
+// Builds the SDF parts of a packed obstacle on the libuv thread pool. The JS
+// callback is called with (packed obstacle) on success or (null, error) on
+// failure.
+class GenerateSdfWorker : public Napi::AsyncWorker
+{
+public:
+    GenerateSdfWorker(const Napi::Function& callback,
+                      Napi::Uint8Array data,
+                      const Sdf::SdfOptions& options,
+                      bool sparse,
+                      std::shared_ptr<MeshCache> cache) :
+        AsyncWorker(callback),
+        data_ref( Napi::Persistent( data.As<Napi::Object>() ) ),
+        data( data.Data() ),
+        data_length( data.ElementLength() ),
+        options( options ),
+        sparse( sparse ),
+        cache( std::move(cache) )
+    {}
+
+protected:
+    void Execute() override
+    {
+        std::unique_ptr<ARCSim::ObstacleFrameT> fb_obsframe( UnPackFromBytestream<ARCSim::ObstacleFrameT>(data, data_length, nullptr) );
+        if(!fb_obsframe){
+            SetError("Obstacle data must be a packed ObstacleFrame");
+            return;
+        }
+
+        try{
+            BuildObstacleSdf( *fb_obsframe, options, sparse, cache.get() );
+            packed = PackToBuffer( fb_obsframe.get(), nullptr );
+        }
+        catch( std::exception& err ){
+            SetError(std::string("Failed to build obstacle SDF: ")+err.what());
+        }
+    }
+
+    void OnOK() override
+    {
+        Napi::Env env = Env();
+        Callback().Call({ ToExternalByteArray( env, std::move(packed) ) });
+    }
+
+    void OnError(const Napi::Error& e) override
+    {
+        Napi::Env env = Env();
+        Callback().Call({ env.Null(), e.Value() });
+    }
+
+private:
+    // Keeps the input array alive while Execute reads it
+    Napi::ObjectReference data_ref;
+    const uint8_t* data;
+    size_t data_length;
+
+    const Sdf::SdfOptions options;
+    const bool sparse;
+    const std::shared_ptr<MeshCache> cache;
+    PackedBuffer packed;
+};
+
+
+// Live bindings of every Node environment the addon is loaded in
+struct EnvironmentRegistry {
+    std::mutex mutex;
+    std::map< napi_env, std::set<ArcsimBinding*> > bindings;
+};
+
+EnvironmentRegistry& GetEnvironments()
+{
+    static EnvironmentRegistry environments;
+    return environments;
+}
+
+void ArcsimBinding::RegisterEnvironment(Napi::Env env) {
+    EnvironmentRegistry& environments = GetEnvironments();
+    {
+        std::lock_guard<std::mutex> lock( environments.mutex );
+        environments.bindings[env];
+    }
+    napi_add_env_cleanup_hook( env, &ArcsimBinding::CleanupEnvironment, static_cast<napi_env>( env ) );
+}
+
+// Runs on the environment's thread as it shuts down, before the event loop
+// is gone: engine threads must not call into it anymore afterwards
+void ArcsimBinding::CleanupEnvironment(void* env) {
+    EnvironmentRegistry& environments = GetEnvironments();
+    std::set<ArcsimBinding*> bindings;
+    {
+        std::lock_guard<std::mutex> lock( environments.mutex );
+        auto it = environments.bindings.find( static_cast<napi_env>( env ) );
+        if( it == environments.bindings.end() )
+            return;
+        bindings.swap( it->second );
+        environments.bindings.erase( it );
+    }
+    for( ArcsimBinding* binding : bindings )
+        binding->Shutdown();
+}
+
+void ArcsimBinding::Shutdown() {
+    for( auto& entry : per_session_sim_params ){
+        ARCSimSession& session = *entry.second;
+        DetachSession( session );
+        if( api_ && api_->destroy_session )
+            api_->destroy_session( entry.first );
+        // The engine no longer calls back. Asset workers still holding the
+        // session free the rest when done.
+        session.context.reset();
+    }
+    per_session_sim_params.clear();
+
+    // Queued meshing jobs are dropped, running ones finish first; their
+    // sessions are released before the pool is cleared. Their results never
+    // reach JS.
+    if( meshing_workers_ )
+        meshing_workers_->Shutdown();
+    if( session_pool_ )
+        session_pool_->Clear();
+}
+
+ArcsimBinding::~ArcsimBinding() {
+    EnvironmentRegistry& environments = GetEnvironments();
+    {
+        std::lock_guard<std::mutex> lock( environments.mutex );
+        auto it = environments.bindings.find( env_ );
+        if( it != environments.bindings.end() )
+            it->second.erase( this );
+    }
+    // Nothing in JS can reach these sessions anymore
+    Shutdown();
+}
+
+// Keeps as many idle sessions of each type as the counts of { simulation,
+// meshing } say, the types left out are unchanged
+void WarmSessionPool(Napi::Env env, SessionPool& pool, const Napi::Object& counts) {
+    const std::pair<const char*, SessionType> types[] = { { "simulation", ST_Simulation }, { "meshing", ST_Meshing } };
+    for( const auto& type : types ){
+        if( !counts.Has(type.first) )
+            continue;
+        const Napi::Value count = counts.Get(type.first);
+        if( !count.IsNumber() || count.As<Napi::Number>().Int32Value() < 0 ){
+            Napi::TypeError::New(env, std::string("Session pool count for ") + type.first + " must be a positive number")
+                .ThrowAsJavaScriptException();
+            return;
+        }
+        validate( env, pool.Warm( type.second, count.As<Napi::Number>().Uint32Value() ) );
+    }
+}
 
 ArcsimBinding::ArcsimBinding(const Napi::CallbackInfo& info) : ObjectWrap(info) {
     Napi::Env env = info.Env();
+    env_ = env;
+    {
+        EnvironmentRegistry& environments = GetEnvironments();
+        std::lock_guard<std::mutex> lock( environments.mutex );
+        environments.bindings[env_].insert( this );
+    }
 
     if (info.Length() < 1) {
         Napi::TypeError::New(env, "Wrong number of arguments")
@@ -254,11 +972,24 @@ ArcsimBinding::ArcsimBinding(const Napi::CallbackInfo& info) : ObjectWrap(info)
         std::cout << "Attempting to load plugin at: " << std::endl;
         std::cout << this->plugin_path_ << std::endl;
         plugin_handle_ = ARCSim::SharedLibrary::Load( this->plugin_path_ );
+        api_ = std::make_shared<const ArcsimApi>( plugin_handle_ );
+        session_pool_ = std::make_shared<SessionPool>( api_ );
+        meshing_workers_ = std::make_shared<WorkerPool>( std::max( 1u, std::thread::hardware_concurrency() ) );
     }
     catch( std::runtime_error& err ){
         std::cout << err.what() << std::endl;
         Napi::Error::New(env, std::string("ARCSim Plugin could not be loaded: ") + err.what())
           .ThrowAsJavaScriptException();        
+        return;
+    }
+
+    // Sessions created now spare the first requests their construction
+    if( info.Length() > 1 && info[1].IsObject() ){
+        Napi::Object options = info[1].As<Napi::Object>();
+        if( options.Has("session_pool") && options.Get("session_pool").IsObject() )
+            WarmSessionPool( env, *session_pool_, options.Get("session_pool").As<Napi::Object>() );
+        if( options.Has("mesh_cache") )
+            ConfigureMeshCache( env, options.Get("mesh_cache") );
     }
 
     //SetupLogging( 3, "" );    
@@ -274,17 +1005,16 @@ Napi::Value ArcsimBinding::Version(const Napi::CallbackInfo& info) {
         return env.Null();
     }
 
-    unsigned int major, minor, patch, api_major, api_minor;
-    char build[32];
+    unsigned int major, minor, patch;
+    char build[INTERFACE_API_MAX_BUILD_INFO_LENGTH];
     GetFunction(arcsim_version, &major, &minor, &patch, build);
-    GetFunction(api_version, &api_major, &api_minor);
 
     auto ret = Napi::Object::New(env);
     ret.Set( "major", Napi::Number::New(env, major) );
     ret.Set( "minor", Napi::Number::New(env, minor) );
     ret.Set( "patch", Napi::Number::New(env, patch) );
-    ret.Set( "api_major", Napi::Number::New(env, api_major) );
-    ret.Set( "api_minor", Napi::Number::New(env, api_minor) );
+    ret.Set( "api_major", Napi::Number::New(env, api_->api_major) );
+    ret.Set( "api_minor", Napi::Number::New(env, api_->api_minor) );
     ret.Set( "build", Napi::String::New(env, std::string(build) ) );
 
     return ret;
@@ -300,10 +1030,19 @@ Napi::Value ArcsimBinding::CreateSimulationSession(const Napi::CallbackInfo& inf
         return env.Null();
     }
 
-    ARCSimSession* session = new ARCSimSession();
+    if( !session_pool_ ){
+        Napi::Error::New(env, "Binding Error: ARCSim library is not loaded").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    // Only handed over to per_session_sim_params once the session is
+    // created, every return before frees it with its context and callback
+    std::unique_ptr<ARCSimSession> session( new ARCSimSession() );
     SimParams& params = session->params;
     
-    GetFunction(get_default_simulation_parameters, &params);
+    validate(env, session_pool_->DefaultSimulationParameters(&params));
+    if( env.IsExceptionPending() )
+        return env.Null();
     params.callback.data_passthrough_ptr = nullptr;
     
     if( info.Length() == 1) {
@@ -377,114 +1116,255 @@ Napi::Value ArcsimBinding::CreateSimulationSession(const Napi::CallbackInfo& inf
         
         if(config.Has("callback")){
             if(!config.Get("callback").IsFunction()){
-                delete session;
                 Napi::TypeError::New(env, "Callback must be a function")
                     .ThrowAsJavaScriptException();
                 return env.Null();
             }
-            BindingContext* bindingContext = new BindingContext(env);
-            bindingContext->plugin_handle_ = plugin_handle_;
+            session->context.reset( new BindingContext(env) );
+            BindingContext* bindingContext = session->context.get();
+            bindingContext->api_ = api_;
             bindingContext->env = env;
-            bindingContext->callback = new ThreadSafeCallback(config.Get("callback").As<Function>());
+            bindingContext->callback.reset( new ThreadSafeCallback(config.Get("callback").As<Function>()) );
             params.callback.data_passthrough_ptr = bindingContext;
-            session->context = bindingContext;            
+
+            // Bounds the frames waiting for JS. By default progress frames
+            // are dropped when JS falls behind, so the engine never waits on
+            // the main thread. With block it does, and the main thread must
+            // not wait on the engine, with pause_session or start_session,
+            // while frames are pending.
+            DeliveryPolicy delivery_policy = DeliveryPolicy::DropOldest;
+
+            if( config.Has("delivery_policy") ){
+                std::string policy = config.Get("delivery_policy").ToString().Utf8Value();
+                if( policy == "block" )
+                    delivery_policy = DeliveryPolicy::Block;
+                else if( policy == "drop_oldest" )
+                    delivery_policy = DeliveryPolicy::DropOldest;
+                else if( policy == "latest" )
+                    delivery_policy = DeliveryPolicy::Latest;
+                else{
+                    Napi::TypeError::New(env, "delivery_policy must be one of block, drop_oldest or latest")
+                        .ThrowAsJavaScriptException();
+                    return env.Null();
+                }
+            }
+            uint32_t delivery_queue_size = 8;
+            if( config.Has("delivery_queue_size") )
+                delivery_queue_size = config.Get("delivery_queue_size").ToNumber().Uint32Value();
+            bindingContext->delivery.reset( new DeliveryQueue<PendingFrame>( delivery_queue_size, delivery_policy ) );
+
+            // Shared memory ring for status and positions. The JS wrapper
+            // allocates the SharedArrayBuffer, since N-API can't.
+            if( config.Has("frame_ring") ){
+                Napi::Object ring = config.Get("frame_ring").ToObject();
+                if( !ring.Has("buffer") || !ring.Get("buffer").IsTypedArray() ||
+                    ring.Get("buffer").As<Napi::TypedArray>().TypedArrayType() != napi_int32_array ){
+                    Napi::TypeError::New(env, "frame_ring.buffer must be an Int32Array over a SharedArrayBuffer")
+                        .ThrowAsJavaScriptException();
+                    return env.Null();
+                }
+                if( !ring.Has("max_vertices") || !ring.Get("max_vertices").IsNumber() ){
+                    Napi::TypeError::New(env, "frame_ring.max_vertices must be provided")
+                        .ThrowAsJavaScriptException();
+                    return env.Null();
+                }
+                Napi::Int32Array buffer = ring.Get("buffer").As<Napi::Int32Array>();
+                const uint32_t slots = ring.Has("slots") ? ring.Get("slots").ToNumber().Uint32Value() : 3;
+                const uint32_t max_vertices = ring.Get("max_vertices").As<Napi::Number>().Uint32Value();
+                const uint32_t max_garments = ring.Has("max_garments") ? ring.Get("max_garments").ToNumber().Uint32Value() : 16;
+                try{
+                    bindingContext->frame_ring.reset( new FrameRingWriter( reinterpret_cast<char*>( buffer.Data() ), buffer.ByteLength(),
+                                                                           slots, max_vertices, max_garments ) );
+                }
+                catch( std::exception& err ){
+                    Napi::Error::New(env, err.what()).ThrowAsJavaScriptException();
+                    return env.Null();
+                }
+                bindingContext->frame_ring_buffer = Napi::Persistent( buffer.As<Napi::Object>() );
+                bindingContext->ring_delivers_meshes = ring.Has("deliver_meshes") && ring.Get("deliver_meshes").ToBoolean();
+            }
+
+            // Bit ( 1 << CallbackType ) set for every event JS wants
+            if( config.Has("event_mask") )
+                bindingContext->event_mask = config.Get("event_mask").ToNumber().Uint32Value();
+
+            // Either one interval for every event type, or an object from
+            // CallbackType to interval. 0 sends the status only, n the meshes
+            // with every n-th event of the type.
+            if( config.Has("mesh_interval") ){
+                Napi::Value mesh_interval = config.Get("mesh_interval");
+                if( mesh_interval.IsNumber() )
+                    bindingContext->mesh_interval.fill( mesh_interval.As<Napi::Number>().Uint32Value() );
+                else if( mesh_interval.IsObject() ){
+                    Napi::Object intervals = mesh_interval.As<Napi::Object>();
+                    Napi::Array types = intervals.GetPropertyNames();
+                    for( uint32_t i = 0; i < types.Length(); ++i ){
+                        Napi::Value type_key = types.Get(i);
+                        int32_t type = type_key.ToNumber().Int32Value();
+                        if( type < 0 || type >= CALLBACK_TYPE_COUNT || type_key.ToString().Utf8Value() != std::to_string( type ) ){
+                            Napi::TypeError::New(env, "mesh_interval keys must be CallbackType values")
+                                .ThrowAsJavaScriptException();
+                            return env.Null();
+                        }
+                        Napi::Value interval = intervals.Get(type_key);
+                        if( !interval.IsNumber() ){
+                            Napi::TypeError::New(env, "mesh_interval values must be numbers")
+                                .ThrowAsJavaScriptException();
+                            return env.Null();
+                        }
+                        bindingContext->mesh_interval[type] = interval.As<Napi::Number>().Uint32Value();
+                    }
+                }
+                else{
+                    Napi::TypeError::New(env, "mesh_interval must be a number or an object")
+                        .ThrowAsJavaScriptException();
+                    return env.Null();
+                }
+            }
+
+            // Translate frames on a binding-owned thread instead of the engine's callback thread
+            if( config.Has("async_frames") && config.Get("async_frames").ToBoolean() ){
+                uint32_t queue_size = 8;
+                if( config.Has("frame_queue_size") )
+                    queue_size = config.Get("frame_queue_size").ToNumber().Uint32Value();
+                bindingContext->frame_queue_size = std::max( 1u, queue_size );
+            }
+
+            // Only send faces, piece maps and material space data when they change
+            if( config.Has("topology_streaming") )
+                bindingContext->topology_streaming = config.Get("topology_streaming").ToBoolean();
+
+            // 16 bit positions across each frame's bounding box, optionally delta coded
+            if( config.Has("quantize_positions") )
+                bindingContext->quantize_positions = config.Get("quantize_positions").ToBoolean();
+            if( config.Has("delta_positions") )
+                bindingContext->delta_positions = config.Get("delta_positions").ToBoolean();
         }
     }
 
-    ErrorCode result;
-    unsigned int api_major, api_minor;
+    // An option that failed to convert left its exception pending; the
+    // session must not be created behind it
+    if( env.IsExceptionPending() )
+        return env.Null();
+
     int session_handle;
 
-    GetFunction(api_version, &api_major, &api_minor);
-    GetFunction(create_session, api_major, api_minor, ST_Simulation, &session_handle);
+    validate(env, session_pool_->Acquire(ST_Simulation, &session_handle));
+    if( env.IsExceptionPending() )
+        return env.Null();
+
+    if( session->context && session->context->frame_queue_size )
+        session->context->frame_worker = std::thread( FrameWorker, session->context.get() );
 
     // Setup the callback function - its a stub that redirects calls to the JS callback, if one is set
     params.callback.func_ptr = [](CallbackData data){
         if( !data.data_passthrough )
             return;
         BindingContext& bindingContext = *reinterpret_cast<BindingContext*>(data.data_passthrough);
-        ARCSim::SharedLibrary::HandleType& plugin_handle_ = bindingContext.plugin_handle_;
-        std::vector<int> garment_handles = bindingContext.garment_handles;        
+        // The shared status is kept current whatever JS subscribed to
+        if( bindingContext.frame_ring )
+            bindingContext.frame_ring->WriteStatus( data.type, data.session_status.state, data.session_status.frame,
+                                                    data.session_status.steps, data.session_status.time );
+        // Filtered events cost nothing, and status only events skip the meshes
+        if( !bindingContext.WantsEvent( data.type ) )
+            return;
+        const bool with_meshes = bindingContext.WantsMeshes( data.type );
+
+        const std::shared_ptr<const ArcsimApi>& api_ = bindingContext.api_;
+        std::vector<int> garment_handles;
+        if( with_meshes )
+            garment_handles = bindingContext.GetGarmentHandles();
         Napi::Env env = bindingContext.env;
-        ThreadSafeCallback& js_callback = *(bindingContext.callback);
-        std::vector< std::vector<uint8_t> > garments_bytes;
         const char* error_msg = nullptr;
         if( data.type == CT_Error ){
             GetFunctionNoReturn(get_error_message, data.session_handle, error_msg);
         }
-        else{            
+
+        if( bindingContext.frame_queue_size ){
+            // Only take the raw meshes here, the frame worker does the translation
+            std::unique_ptr<FrameJob> job( new FrameJob() );
+            job->data = data;
+            if( error_msg ){
+                job->has_error = true;
+                job->error_msg = error_msg;
+            }
+            if( with_meshes ){
+                for( int garment_id : garment_handles ){
+                    BinBlob* garment_data = nullptr;
+                    GetFunctionNoReturn(get_garment_mesh,
+                                        data.session_status.handle,
+                                        garment_id,
+                                        &garment_data,
+                                        false
+                                        );
+                    if( garment_data )
+                        job->meshes.emplace_back( garment_id, garment_data );
+                }
+            }
+
+            // Frames are never dropped while the worker runs: if it falls
+            // behind the engine waits here for a free slot. Once it is
+            // stopped, nothing would take the frame anymore.
+            bool pushed = false;
+            {
+                std::unique_lock<std::mutex> lock( bindingContext.frame_mutex );
+                std::deque< std::unique_ptr<FrameJob> >& queue = bindingContext.frame_queue;
+                bindingContext.frame_space.wait( lock, [&]{
+                        return queue.size() < bindingContext.frame_queue_size || bindingContext.stop_frame_worker;
+                    });
+                if( !bindingContext.stop_frame_worker ){
+                    queue.push_back( std::move(job) );
+                    pushed = true;
+                }
+            }
+
+            if( pushed )
+                bindingContext.frame_available.notify_one();
+            else{
+                for( auto& mesh : job->meshes )
+                    GetFunctionNoReturn(free_garment_mesh, mesh.second);
+            }
+            return;
+        }
+
+        FrameOutput output;
+        PrepareFramePacking( bindingContext );
+        if( with_meshes ){
+            const bool ring_frame = bindingContext.frame_ring && !garment_handles.empty();
+            if( ring_frame )
+                bindingContext.frame_ring->BeginFrame( data.type, data.session_status.frame, data.session_status.steps, data.session_status.time );
             for( int garment_id : garment_handles ){
-                std::cout << "Loading garment " << garment_id << " for frame " << data.session_status.frame << std::endl;
-                
                 // Fetch the current mesh...
-                Geometry::Blob blob;
                 BinBlob* garment_data;
                 GetFunctionNoReturn(get_garment_mesh,
                                     data.session_status.handle,
-                                    garment_id /* This is bad! We need to replace with all garments! */,
+                                    garment_id,
                                     &garment_data,
                                     false
                                     );
-                blob.Load( *garment_data );
-                GetFunctionNoReturn(free_garment_mesh, garment_data);
-                ARCSim::GarmentFrameT fb_garmentFrame;        
                 try{
-                    ARCSimTranslation::ConvertToFB(blob, fb_garmentFrame);
-                    fb_garmentFrame.frame = data.session_status.frame;
-                    fb_garmentFrame.subframe = data.session_status.steps;
-                    fb_garmentFrame.timestamp = data.session_status.time;
+                    ProcessGarmentMesh( bindingContext, garment_id, *garment_data, data.session_status, output );
                 }
                 catch( std::exception& err ){
+                    GetFunctionNoReturn(free_garment_mesh, garment_data);
+                    if( ring_frame )
+                        bindingContext.frame_ring->EndFrame( false );
+                    // Nothing of this frame reaches JS
+                    ResetGarmentStreams( bindingContext );
                     Napi::Error::New(env, std::string("Failed to convert garment: ")+err.what() ).ThrowAsJavaScriptException();
                     return;
                 }
-                
-                PackedBuffer buffer = PackToBuffer( &fb_garmentFrame, nullptr );
-                //std::cout << "Packed buffer: " << buffer.size() << std::endl;
-                
-                
-                std::vector<uint8_t> bytes;
-                bytes.resize(buffer.size());                
-                memcpy( bytes.data(), buffer.data(), buffer.size());
-                garments_bytes.push_back(bytes);                
+                GetFunctionNoReturn(free_garment_mesh, garment_data);
             }
+            if( ring_frame )
+                bindingContext.frame_ring->EndFrame();
         }
-        
-        
-            
-        js_callback.call([=](Napi::Env env, std::vector<napi_value>& args)
-        {
-            const int type = data.type;
-            Napi::Array garment_updates = Napi::Array::New(env);
-            
-            for( int i = 0; i< garments_bytes.size(); ++i){
-                //std::cout << "Building JS Array from bytes" << std::endl;
-                //std::cout << "   Index: " << i << std::endl;
-                //std::cout << "   Size:  " << garments_bytes[i].size() << std::endl;
-                
-                Napi::Uint8Array js_byte_array = Napi::Uint8Array::New(env, garments_bytes[i].size());
-                memcpy( js_byte_array.Data(), garments_bytes[i].data(), garments_bytes[i].size());
-                garment_updates[i] = js_byte_array;                
-            }
-            
-            Napi::Object status = Napi::Object::New(env);
-            status.Set("handle", Napi::Number::New(env, data.session_status.handle));
-            status.Set("type",  Napi::Number::New(env, data.session_status.type));
-            status.Set("state",  Napi::Number::New(env, data.session_status.state));
-            status.Set("frame",  Napi::Number::New(env, data.session_status.frame));
-            status.Set("steps",  Napi::Number::New(env, data.session_status.steps));
-            status.Set("time",  Napi::Number::New(env, data.session_status.time));
-            if(error_msg)
-                status.Set("error", Napi::String::New(env, error_msg));            
-            status.Set("garment_data", garment_updates );
-            
-            args = { Napi::Number::New(env, type),
-                     Napi::Number::New(env, data.session_handle),
-                     status };
-        });
+
+        DeliverFrame( bindingContext, data, std::move( output ), error_msg != nullptr, error_msg ? error_msg : "" );
     };    
     
-    per_session_sim_params.insert( {session_handle, session} );
+    // A pooled handle may have belonged to a destroyed session
+    per_session_sim_params[session_handle] = std::move( session );
     
     return Napi::Number::New(env, session_handle);
 }
@@ -492,7 +1372,7 @@ Napi::Value ArcsimBinding::CreateSimulationSession(const Napi::CallbackInfo& inf
 Napi::Value ArcsimBinding::AddObstacle(const Napi::CallbackInfo& info){
     Napi::Env env = info.Env();
 
-    if (info.Length() != 2) {
+    if (info.Length() != 3) {
         Napi::TypeError::New(env, "Wrong number of arguments")
           .ThrowAsJavaScriptException();
         return env.Null();
@@ -512,7 +1392,7 @@ Napi::Value ArcsimBinding::AddObstacle(const Napi::CallbackInfo& info){
         return env.Null();
     }
     
-    ARCSimSession& session = *reinterpret_cast<ARCSimSession*>(res->second);
+    std::shared_ptr<ARCSimSession> session = res->second;
     
     if (!info[1].IsTypedArray()) {
         Napi::TypeError::New(env, "Obstacle data must be provided as a Uint8 TypedArray")
@@ -525,43 +1405,27 @@ Napi::Value ArcsimBinding::AddObstacle(const Napi::CallbackInfo& info){
           .ThrowAsJavaScriptException();
         return env.Null();
     }
-    
-    Napi::Uint8Array u8array = obstacle_plain_data.As<Napi::Uint8Array>();
-    uint8_t* obstacle_data = obstacle_plain_data.As<Napi::Uint8Array>().Data();           
-    BinBlob obstacle_blob;
-    std::string obstacle_json;
-    //TODO: Convert obstacle data to blob and json here!!!   
-    ARCSim::ObstacleFrameT* fb_obsframe = UnPackFromBytestream<ARCSim::ObstacleFrameT>(obstacle_data,
-                                                                                       obstacle_plain_data.ElementLength(),
-                                                                                       nullptr);
-    if(!fb_obsframe){
-        Napi::TypeError::New(env, "Obstacle data must be a packed ObstacleFrame")
+
+    if( !info[2].IsFunction()) {
+        Napi::TypeError::New(env, "Argument 3 must be a callback function")
             .ThrowAsJavaScriptException();
         return env.Null();
     }
-    Geometry::Blob blob;
-    try{
-        ARCSimTranslation::ConvertFromFB(blob, obstacle_json, *fb_obsframe);
-    }
-    catch( std::exception& err ){
-        Napi::Error::New(env, std::string("Failed to convert obstacle: ")+err.what() ).ThrowAsJavaScriptException();
-        return env.Null();
-    }
-    auto tmp_binblob = blob.Save();
-    obstacle_blob.buffer = tmp_binblob->buffer;
-    obstacle_blob.len = tmp_binblob->len;    
-        
-    int obstacle_handle;    
-    GetFunction(validate_body, obstacle_json.c_str() , &obstacle_blob );
-    GetFunction(add_obstacle, session_handle, obstacle_json.c_str(), &obstacle_blob,   &obstacle_handle);
     
-    return Napi::Number::New(env, obstacle_handle);
+    AddObstacleWorker* worker = new AddObstacleWorker(info[2].As<Napi::Function>(),
+                                                      api_,
+                                                      session_handle,
+                                                      session,
+                                                      obstacle_plain_data.As<Napi::Uint8Array>());
+    worker->Queue();
+    
+    return env.Null();
 }
 
 Napi::Value ArcsimBinding::AddGarment(const Napi::CallbackInfo& info){
     Napi::Env env = info.Env();
 
-    if (info.Length() != 2) {
+    if (info.Length() != 3) {
         Napi::TypeError::New(env, "Wrong number of arguments")
           .ThrowAsJavaScriptException();
         return env.Null();
@@ -581,7 +1445,7 @@ Napi::Value ArcsimBinding::AddGarment(const Napi::CallbackInfo& info){
         return env.Null();
     }
     
-    ARCSimSession& session = *reinterpret_cast<ARCSimSession*>(res->second);
+    std::shared_ptr<ARCSimSession> session = res->second;
     
     if (!info[1].IsTypedArray()) {
         Napi::TypeError::New(env, "Garment data must be provided as a Uint8 TypedArray")
@@ -594,45 +1458,21 @@ Napi::Value ArcsimBinding::AddGarment(const Napi::CallbackInfo& info){
           .ThrowAsJavaScriptException();
         return env.Null();
     }
-    
-    Napi::Uint8Array u8array = garment_plain_data.As<Napi::Uint8Array>();
-    uint8_t* garment_data = garment_plain_data.As<Napi::Uint8Array>().Data();           
-    BinBlob garment_blob;
-    std::string garment_json;
-    //TODO: Convert garment data to blob and json here!!!   
-    ARCSim::GarmentT* fb_garment = UnPackFromBytestream<ARCSim::GarmentT>(garment_data,
-                                                                                garment_plain_data.ElementLength(),
-                                                                                nullptr);
-    if(!fb_garment){
-        Napi::TypeError::New(env, "Garment data must be a packed Garment")
+
+    if( !info[2].IsFunction()) {
+        Napi::TypeError::New(env, "Argument 3 must be a callback function")
             .ThrowAsJavaScriptException();
         return env.Null();
     }
-    Geometry::Blob blob;
-    
-    try{
-        ARCSimTranslation::ConvertFromFB(blob, garment_json, *fb_garment);
-    }
-    catch( std::exception& err ){
-        Napi::Error::New(env, std::string("Failed to convert garment: ")+err.what() ).ThrowAsJavaScriptException();
-        return env.Null();
-    }
-    
-    auto tmp_binblob = blob.Save();
-    garment_blob.buffer = tmp_binblob->buffer;
-    garment_blob.len = tmp_binblob->len;    
-
-    std::ofstream blob_out("./blob.bin");
-    blob_out.write( garment_blob.buffer, garment_blob.len );
-    blob_out.close();
     
-    int garment_handle;    
-    GetFunction(validate_garment, garment_json.c_str() , &garment_blob );
-    GetFunction(add_garment, session_handle, "data_garment", garment_json.c_str(), &garment_blob,   &garment_handle);
-    if(session.context)
-        session.context->garment_handles.push_back( garment_handle );    
+    AddGarmentWorker* worker = new AddGarmentWorker(info[2].As<Napi::Function>(),
+                                                    api_,
+                                                    session_handle,
+                                                    session,
+                                                    garment_plain_data.As<Napi::Uint8Array>());
+    worker->Queue();
     
-    return Napi::Number::New(env, garment_handle);
+    return env.Null();
 }
 
 
@@ -660,7 +1500,7 @@ Napi::Value ArcsimBinding::StartSimulation(const Napi::CallbackInfo& info){
     }
     
     
-    ARCSimSession& session = *reinterpret_cast<ARCSimSession*>(res->second);
+    ARCSimSession& session = *res->second;
 
     if(! session.has_initialized ){
         GetFunction(prepare_simulation, session_handle, &session.params);
@@ -694,9 +1534,6 @@ Napi::Value ArcsimBinding::PauseSimulation(const Napi::CallbackInfo& info){
             .ThrowAsJavaScriptException();
         return env.Null();
     }
-    
-    
-    ARCSimSession& session = *reinterpret_cast<ARCSimSession*>(res->second);
 
     GetFunction(pause_session, session_handle);
     
@@ -726,7 +1563,27 @@ Napi::Value ArcsimBinding::DestroySimulationSession(const Napi::CallbackInfo& in
         return env.Null();
     }
 
-    GetFunction(destroy_session, session_handle);
+    // Asset workers still queued hold the session until they are done, but
+    // must not reach the engine under a handle that may be reissued
+    std::shared_ptr<ARCSimSession> owned_session = res->second;
+    ARCSimSession& session = *owned_session;
+    DetachSession( session );
+
+    if( !session_pool_ || !api_->reset_session ){
+        GetFunction(destroy_session, session_handle);
+    }
+    else{
+        // Resetting stops the session like destroying it, and makes it
+        // ready for the next create_session
+        session_pool_->Release(ST_Simulation, session_handle);
+    }
+    // The handle may be handed out again, it must not lead to this session
+    per_session_sim_params.erase( res );
+
+    // The engine no longer calls back: the frame ring, whose buffer JS may
+    // now collect, and the JS callback go with the context. Frames already
+    // handed to the callback are still delivered.
+    session.context.reset();
 
     return env.Null();    
 }
@@ -734,7 +1591,7 @@ Napi::Value ArcsimBinding::DestroySimulationSession(const Napi::CallbackInfo& in
 Napi::Value ArcsimBinding::GenerateMesh(const Napi::CallbackInfo& info){
     Napi::Env env = info.Env();
 
-    if (info.Length() != 2) {
+    if (info.Length() != 2 && info.Length() != 3) {
         Napi::TypeError::New(env, "Wrong number of arguments")
           .ThrowAsJavaScriptException();
         return env.Null();
@@ -752,100 +1609,408 @@ Napi::Value ArcsimBinding::GenerateMesh(const Napi::CallbackInfo& info){
         return env.Null();
     }
 
+    // { per_piece, concurrency }: separately sewn parts meshed in parallel,
+    // one session each
 
-    ARCSimSession* session = new ARCSimSession();
-    MeshingParams& params = session->meshing_params;
-    
-    GetFunction(get_default_meshing_parameters, &params);
-    params.callback.data_passthrough_ptr = nullptr;
+    bool per_piece = false;
+    unsigned concurrency = std::max( 1u, std::thread::hardware_concurrency() );
+    if( info.Length() == 3 ){
+        if( !info[2].IsObject()) {
+            Napi::TypeError::New(env, "Argument 3 must be an options object")
+                .ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        Napi::Object options = info[2].As<Napi::Object>();
+        if( options.Has("per_piece") )
+            per_piece = options.Get("per_piece").ToBoolean();
+        if( options.Has("concurrency") )
+            concurrency = std::max( 1u, options.Get("concurrency").ToNumber().Uint32Value() );
+    }
 
-    unsigned int api_major, api_minor;
-    int session_handle;
+    if( !session_pool_ ){
+        Napi::Error::New(env, "Binding Error: ARCSim library is not loaded").ThrowAsJavaScriptException();
+        return env.Null();
+    }
 
-    GetFunction(api_version, &api_major, &api_minor);
-    GetFunction(create_session, api_major, api_minor, ST_Meshing, &session_handle);
+    MeshingParams params;
+    validate(env, session_pool_->DefaultMeshingParameters(&params));
+    if( env.IsExceptionPending() )
+        return env.Null();
+    params.callback.data_passthrough_ptr = nullptr;
 
-    int garment_handle;
     std::string garment_json = info[0].As<Napi::String>().Utf8Value();
-    GetFunction(add_garment, session_handle, "data_garment", garment_json.c_str(), nullptr, &garment_handle);
-    
-    BindingContext* bindingContext = new BindingContext(env);
-    bindingContext->plugin_handle_ = plugin_handle_;
-    bindingContext->env = env;
-    bindingContext->callback = new ThreadSafeCallback(info[1].As<Function>());
-    bindingContext->garment_handles.push_back(garment_handle);
-    bindingContext->garment_json = garment_json;    
-    params.callback.data_passthrough_ptr = bindingContext;
 
-    params.callback.func_ptr = [](CallbackData data){
-        if( !data.data_passthrough )
-            return;
-        BindingContext& bindingContext = *reinterpret_cast<BindingContext*>(data.data_passthrough);
-        ARCSim::SharedLibrary::HandleType& plugin_handle_ = bindingContext.plugin_handle_;
-        Napi::Env env = bindingContext.env;
-        ThreadSafeCallback& js_callback = *(bindingContext.callback);
-        // Check status
-        if( !( data.type == CT_Finished || data.type == CT_Error ) )
-            return;
+    // Meshed on the binding's workers, which wait for the engine to finish
+    // before they take the mesh and hand the session back, so a session is
+    // never reset from under the engine's callback
+    std::shared_ptr<const ArcsimApi> api = api_;
+    std::shared_ptr<SessionPool> pool = session_pool_;
+    std::shared_ptr<MeshCache> cache = mesh_cache_;
+    // Shut down, and so joined, before the binding lets go of it
+    WorkerPool* workers = meshing_workers_.get();
+    // Queued calls are still made once the callback is gone
+    auto js_callback = std::make_shared<ThreadSafeCallback>( info[1].As<Function>() );
+    const bool posted = workers->Post( [api, pool, workers, cache, js_callback, params, garment_json, per_piece, concurrency]{
+        auto result = std::make_shared<MeshingResult>( per_piece ? MeshGarmentByPiece( *api, *pool, params, garment_json,
+                                                                                       concurrency, *workers, cache.get() )
+                                                                 : MeshGarment( *api, *pool, params, garment_json, cache.get() ) );
+        js_callback->call([result](Napi::Env env, std::vector<napi_value>& args)
+        {
+            Napi::Uint8Array js_byte_array = result->cached_scene ? ToExternalByteArray( env, std::move(result->cached_scene) )
+                                                                  : ToExternalByteArray( env, std::move(result->scene) );
+            if( result->has_error )
+                args = { js_byte_array, Napi::String::New(env, result->error_msg) };
+            else
+                args = { js_byte_array };
+        });
+    } );
+    // Once shut down, the pool would never run the job and so never call back
+    if( !posted )
+        Napi::Error::New(env, "Binding Error: the binding is shut down").ThrowAsJavaScriptException();
+    return env.Null();
+}
 
-        const char* error_msg = nullptr;
-        if( data.type == CT_Error )
-            GetFunctionNoReturn(get_error_message, data.session_handle, error_msg);
+Napi::Value ArcsimBinding::GenerateMeshBatch(const Napi::CallbackInfo& info){
+    Napi::Env env = info.Env();
 
-        ARCSim::SceneT fb_scene;
-        if( data.type == CT_Finished ){            
-            // Fetch the current mesh...
-            Geometry::Blob blob;
-            BinBlob* garment_data;
-            GetFunctionNoReturn(get_garment_mesh,
-                                data.session_status.handle,
-                                bindingContext.garment_handles[0],
-                                &garment_data,
-                                false
-                                );
-            blob.Load( *garment_data );
-            GetFunctionNoReturn(free_garment_mesh, garment_data);
-
-            std::vector< std::array< float, 2 > > vertices_2d = blob.Get2DVertices();
-            std::vector< std::array< float, 3 > > vertices_3d;
-            vertices_3d.resize( vertices_2d.size() );
-            for( int v = 0; v < vertices_2d.size(); ++v)
-                vertices_3d.at(v) = { vertices_2d.at(v)[0], vertices_2d.at(v)[1], 0.0 };
-            blob.Set3DVertices(vertices_3d);                                
-            
-            fb_scene.garments.emplace_back( std::make_unique<ARCSim::GarmentT>() );
-            try{
-                ARCSimTranslation::ConvertToFB( blob, bindingContext.garment_json, *(fb_scene.garments.at(0)) );
-                ARCSimTranslation::ConvertToFB( blob, bindingContext.garment_json, fb_scene.constraints );
-            }
-            catch( std::exception& err ){
-                Napi::Error::New(env, std::string("Failed to convert garment: ")+err.what() ).ThrowAsJavaScriptException();
-                return;
-            }
+    if (info.Length() != 3) {
+        Napi::TypeError::New(env, "Wrong number of arguments")
+          .ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    if( !info[0].IsArray()) {
+        Napi::TypeError::New(env, "Argument 1 must be an array of JSON Strings")
+            .ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    if( !info[1].IsObject()) {
+        Napi::TypeError::New(env, "Argument 2 must be an options object")
+            .ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    if( !info[2].IsFunction()) {
+        Napi::TypeError::New(env, "Argument 3 must be a callback function")
+            .ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    if( !session_pool_ ){
+        Napi::Error::New(env, "Binding Error: ARCSim library is not loaded").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    Napi::Array jsons = info[0].As<Napi::Array>();
+    std::vector<std::string> garment_jsons;
+    garment_jsons.reserve( jsons.Length() );
+    for( uint32_t i = 0; i < jsons.Length(); ++i ){
+        Napi::Value json = jsons[i];
+        if( !json.IsString() ){
+            Napi::TypeError::New(env, "Argument 1 must be an array of JSON Strings")
+                .ThrowAsJavaScriptException();
+            return env.Null();
         }
-        
-        PackedBuffer buffer = PackToBuffer( &fb_scene, ARCSim::SceneIdentifier() );
+        garment_jsons.push_back( json.As<Napi::String>().Utf8Value() );
+    }
 
-        std::vector<uint8_t> bytes;
-        bytes.resize(buffer.size());                
-        memcpy( bytes.data(), buffer.data(), buffer.size());
-        
-        js_callback.call([data, bytes, error_msg](Napi::Env env, std::vector<napi_value>& args)
-        {
-            Napi::Uint8Array js_byte_array = Napi::Uint8Array::New(env, bytes.size());
-            memcpy( js_byte_array.Data(), bytes.data(), bytes.size());
+    Napi::Object options = info[1].As<Napi::Object>();
+    unsigned concurrency = std::max( 1u, std::thread::hardware_concurrency() );
+    if( options.Has("concurrency") ){
+        if( !options.Get("concurrency").IsNumber() || options.Get("concurrency").As<Napi::Number>().Int32Value() < 1 ){
+            Napi::TypeError::New(env, "concurrency must be a number of at least 1")
+                .ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        concurrency = options.Get("concurrency").As<Napi::Number>().Uint32Value();
+    }
 
+    // One parameter set for the whole batch
+    MeshingParams params;
+    validate(env, session_pool_->DefaultMeshingParameters(&params));
+    if( env.IsExceptionPending() )
+        return env.Null();
+    if( options.Has("meshing_params") && options.Get("meshing_params").IsObject() ){
+        Napi::Object overrides = options.Get("meshing_params").As<Napi::Object>();
+        if( overrides.Has("edge_length") )
+            params.edge_length = overrides.Get("edge_length").ToNumber().FloatValue();
+        if( overrides.Has("max_deviation") )
+            params.max_deviation = overrides.Get("max_deviation").ToNumber().FloatValue();
+        if( overrides.Has("min_subdiv") )
+            params.min_subdiv = overrides.Get("min_subdiv").ToNumber().FloatValue();
+    }
+    params.callback.func_ptr = nullptr;
+    params.callback.data_passthrough_ptr = nullptr;
 
-            if(error_msg)
-                args = { js_byte_array, Napi::String::New(env, error_msg) };
+    // Every result is passed as { index, data, error, timings }, and null
+    // follows the last one
+    auto js_callback = std::make_shared<ThreadSafeCallback>( info[2].As<Function>() );
+    auto on_result = [js_callback]( size_t index, MeshingResult&& result ){
+        auto shared_result = std::make_shared<MeshingResult>( std::move( result ) );
+        js_callback->call([index, shared_result](Napi::Env env, std::vector<napi_value>& args)
+        {
+            MeshingResult& result = *shared_result;
+            auto item = Napi::Object::New(env);
+            item.Set( "index", Napi::Number::New(env, double(index)) );
+            if( result.has_error )
+                item.Set( "error", Napi::String::New(env, result.error_msg) );
+            else if( result.cached_scene )
+                item.Set( "data", ToExternalByteArray( env, std::move(result.cached_scene) ) );
             else
-                args = { js_byte_array };
+                item.Set( "data", ToExternalByteArray( env, std::move(result.scene) ) );
+            item.Set( "cached", Napi::Boolean::New(env, result.cached_scene != nullptr) );
+
+            auto timings = Napi::Object::New(env);
+            timings.Set( "queued_ms", Napi::Number::New(env, result.timings.queued) );
+            timings.Set( "session_ms", Napi::Number::New(env, result.timings.session) );
+            timings.Set( "meshing_ms", Napi::Number::New(env, result.timings.meshing) );
+            timings.Set( "convert_ms", Napi::Number::New(env, result.timings.convert) );
+            timings.Set( "total_ms", Napi::Number::New(env, result.timings.total) );
+            item.Set( "timings", timings );
+            args = { item };
+        });
+    };
+    auto on_done = [js_callback](){
+        js_callback->call([](Napi::Env env, std::vector<napi_value>& args)
+        {
+            args = { env.Null() };
         });
     };
 
-    GetFunction(prepare_meshing, session_handle, &params);
-    GetFunction(start_session, session_handle);
-    
+    auto batch = std::make_shared<MeshBatch>( api_, session_pool_, params, std::move( garment_jsons ), concurrency,
+                                              std::move( on_result ), std::move( on_done ), mesh_cache_ );
+    batch->Start( *meshing_workers_ );
+
+    auto ret = Napi::Object::New(env);
+    ret.Set( "size", Napi::Number::New(env, double(batch->Size())) );
+    // Requests running at the same time share the pool's threads
+    ret.Set( "concurrency", Napi::Number::New(env, std::min( batch->Concurrency(), meshing_workers_->MaxThreads() )) );
+    return ret;
+}
+
+// { directory, max_bytes } enables the mesh cache, null disables it
+void ArcsimBinding::ConfigureMeshCache(Napi::Env env, const Napi::Value& options) {
+    if( options.IsNull() || options.IsUndefined() ){
+        mesh_cache_.reset();
+        return;
+    }
+    if( !options.IsObject() || !options.As<Napi::Object>().Has("directory") ||
+        !options.As<Napi::Object>().Get("directory").IsString() ){
+        Napi::TypeError::New(env, "mesh_cache must be null or { directory, max_bytes }")
+            .ThrowAsJavaScriptException();
+        return;
+    }
+    Napi::Object config = options.As<Napi::Object>();
+    const std::string directory = config.Get("directory").As<Napi::String>().Utf8Value();
+    uint64_t max_bytes = uint64_t(1) << 30;
+    if( config.Has("max_bytes") )
+        max_bytes = uint64_t( std::max( 0.0, config.Get("max_bytes").ToNumber().DoubleValue() ) );
+
+    // Results of another engine build may differ
+    unsigned int major, minor, patch;
+    char build[INTERFACE_API_MAX_BUILD_INFO_LENGTH];
+    if( !api_ || !api_->arcsim_version || api_->arcsim_version(&major, &minor, &patch, build) != ARC_OK ){
+        Napi::Error::New(env, "Binding Error: the mesh cache needs the engine version").ThrowAsJavaScriptException();
+        return;
+    }
+    build[INTERFACE_API_MAX_BUILD_INFO_LENGTH - 1] = 0;
+    const std::string version = std::to_string(major) + "." + std::to_string(minor) + "." + std::to_string(patch) + " " + build;
+
+    try{
+        mesh_cache_ = std::make_shared<MeshCache>( directory, max_bytes, version );
+    }
+    catch( std::exception& err ){
+        Napi::Error::New(env, err.what()).ThrowAsJavaScriptException();
+    }
+}
+
+Napi::Value ArcsimBinding::SetMeshCache(const Napi::CallbackInfo& info){
+    Napi::Env env = info.Env();
+
+    if (info.Length() != 1) {
+        Napi::TypeError::New(env, "Wrong number of arguments")
+          .ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    ConfigureMeshCache( env, info[0] );
+    return env.Null();
+}
+
+Napi::Value ArcsimBinding::MeshCacheStats(const Napi::CallbackInfo& info){
+    Napi::Env env = info.Env();
+
+    if( !mesh_cache_ )
+        return env.Null();
+
+    const MeshCache::Stats stats = mesh_cache_->GetStats();
+    auto ret = Napi::Object::New(env);
+    ret.Set( "hits", Napi::Number::New(env, double(stats.hits)) );
+    ret.Set( "misses", Napi::Number::New(env, double(stats.misses)) );
+    ret.Set( "stores", Napi::Number::New(env, double(stats.stores)) );
+    ret.Set( "evictions", Napi::Number::New(env, double(stats.evictions)) );
+    ret.Set( "entries", Napi::Number::New(env, double(stats.entries)) );
+    ret.Set( "bytes", Napi::Number::New(env, double(stats.bytes)) );
+    ret.Set( "max_bytes", Napi::Number::New(env, double(stats.max_bytes)) );
+    return ret;
+}
+
+Napi::Value ArcsimBinding::SetObstacleCache(const Napi::CallbackInfo& info){
+    Napi::Env env = info.Env();
+
+    if (info.Length() != 1 || !info[0].IsObject() || !info[0].As<Napi::Object>().Has("max_bytes")) {
+        Napi::TypeError::New(env, "Obstacle cache options must be provided as { max_bytes }")
+          .ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    // Shared by every session of the process, whichever binding made them
+    const double max_bytes = info[0].As<Napi::Object>().Get("max_bytes").ToNumber().DoubleValue();
+    ObstacleCache::Instance().SetMaxBytes( uint64_t( std::max( 0.0, max_bytes ) ) );
+    return env.Null();
+}
+
+Napi::Value ArcsimBinding::ObstacleCacheStats(const Napi::CallbackInfo& info){
+    Napi::Env env = info.Env();
+
+    const ObstacleCache::Stats stats = ObstacleCache::Instance().GetStats();
+    auto ret = Napi::Object::New(env);
+    ret.Set( "hits", Napi::Number::New(env, double(stats.hits)) );
+    ret.Set( "misses", Napi::Number::New(env, double(stats.misses)) );
+    ret.Set( "evictions", Napi::Number::New(env, double(stats.evictions)) );
+    ret.Set( "entries", Napi::Number::New(env, double(stats.entries)) );
+    ret.Set( "in_use", Napi::Number::New(env, double(stats.in_use)) );
+    ret.Set( "bytes", Napi::Number::New(env, double(stats.bytes)) );
+    ret.Set( "max_bytes", Napi::Number::New(env, double(stats.max_bytes)) );
+    return ret;
+}
+
+Napi::Value ArcsimBinding::GenerateObstacleSdf(const Napi::CallbackInfo& info){
+    Napi::Env env = info.Env();
+
+    if (info.Length() != 3) {
+        Napi::TypeError::New(env, "Wrong number of arguments")
+          .ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    if (!info[0].IsTypedArray() || info[0].As<Napi::TypedArray>().TypedArrayType() != napi_uint8_array) {
+        Napi::TypeError::New(env, "Obstacle data must be provided as a Uint8 TypedArray")
+          .ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    if (!info[1].IsObject() || !info[1].As<Napi::Object>().Get("dx").IsNumber()) {
+        Napi::TypeError::New(env, "SDF options must be provided as { dx, innerband, outerband, threads, sparse }")
+          .ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    Napi::Object config = info[1].As<Napi::Object>();
+    Sdf::SdfOptions options;
+    options.dx = config.Get("dx").ToNumber().FloatValue();
+    // Bands of four samples unless told otherwise
+    options.innerband = config.Has("innerband") ? config.Get("innerband").ToNumber().FloatValue() : 4 * options.dx;
+    options.outerband = config.Has("outerband") ? config.Get("outerband").ToNumber().FloatValue() : 4 * options.dx;
+    if( config.Has("threads") )
+        options.threads = unsigned( std::max( 0, config.Get("threads").ToNumber().Int32Value() ) );
+    // Bricks unless told otherwise
+    const bool sparse = !config.Has("sparse") || config.Get("sparse").ToBoolean().Value();
+    if( !( options.dx > 0 ) || !( options.innerband >= 0 ) || !( options.outerband >= 0 ) ||
+        !( options.innerband + options.outerband > 0 ) ){
+        Napi::TypeError::New(env, "SDF options need dx > 0 and non negative bands, not both empty")
+          .ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    if( !info[2].IsFunction()) {
+        Napi::TypeError::New(env, "Argument 3 must be a callback function")
+            .ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    GenerateSdfWorker* worker = new GenerateSdfWorker(info[2].As<Napi::Function>(),
+                                                      info[0].As<Napi::Uint8Array>(),
+                                                      options,
+                                                      sparse,
+                                                      sdf_cache_);
+    worker->Queue();
+
+    return env.Null();
+}
+
+Napi::Value ArcsimBinding::SetSdfCache(const Napi::CallbackInfo& info){
+    Napi::Env env = info.Env();
+
+    if (info.Length() != 1) {
+        Napi::TypeError::New(env, "Wrong number of arguments")
+          .ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    if( info[0].IsNull() || info[0].IsUndefined() ){
+        sdf_cache_.reset();
+        return env.Null();
+    }
+    if( !info[0].IsObject() || !info[0].As<Napi::Object>().Get("directory").IsString() ){
+        Napi::TypeError::New(env, "sdf_cache must be null or { directory, max_bytes }")
+            .ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    Napi::Object config = info[0].As<Napi::Object>();
+    const std::string directory = config.Get("directory").As<Napi::String>().Utf8Value();
+    uint64_t max_bytes = uint64_t(1) << 30;
+    if( config.Has("max_bytes") )
+        max_bytes = uint64_t( std::max( 0.0, config.Get("max_bytes").ToNumber().DoubleValue() ) );
+
+    // SDFs don't depend on the engine, their keys hash the obstacle mesh instead
+    try{
+        sdf_cache_ = std::make_shared<MeshCache>( directory, max_bytes, std::string(), ".sdf" );
+    }
+    catch( std::exception& err ){
+        Napi::Error::New(env, err.what()).ThrowAsJavaScriptException();
+    }
+    return env.Null();
+}
+
+Napi::Value ArcsimBinding::SdfCacheStats(const Napi::CallbackInfo& info){
+    Napi::Env env = info.Env();
+
+    if( !sdf_cache_ )
+        return env.Null();
+
+    const MeshCache::Stats stats = sdf_cache_->GetStats();
+    auto ret = Napi::Object::New(env);
+    ret.Set( "hits", Napi::Number::New(env, double(stats.hits)) );
+    ret.Set( "misses", Napi::Number::New(env, double(stats.misses)) );
+    ret.Set( "stores", Napi::Number::New(env, double(stats.stores)) );
+    ret.Set( "evictions", Napi::Number::New(env, double(stats.evictions)) );
+    ret.Set( "entries", Napi::Number::New(env, double(stats.entries)) );
+    ret.Set( "bytes", Napi::Number::New(env, double(stats.bytes)) );
+    ret.Set( "max_bytes", Napi::Number::New(env, double(stats.max_bytes)) );
+    return ret;
+}
+
+Napi::Value ArcsimBinding::WarmSessions(const Napi::CallbackInfo& info){
+    Napi::Env env = info.Env();
+
+    if (info.Length() != 1 || !info[0].IsObject()) {
+        Napi::TypeError::New(env, "Session counts must be provided as { simulation, meshing }")
+          .ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    if( !session_pool_ ){
+        Napi::Error::New(env, "Binding Error: ARCSim library is not loaded").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    WarmSessionPool( env, *session_pool_, info[0].As<Napi::Object>() );
+    if( env.IsExceptionPending() )
+        return env.Null();
+
+    auto ret = Napi::Object::New(env);
+    ret.Set( "simulation", Napi::Number::New(env, session_pool_->Idle(ST_Simulation)) );
+    ret.Set( "meshing", Napi::Number::New(env, session_pool_->Idle(ST_Meshing)) );
+    return ret;
 }
 
 
@@ -859,6 +2024,15 @@ Napi::Function ArcsimBinding::GetClass(Napi::Env env) {
                 ArcsimBinding::InstanceMethod("add_garment", &ArcsimBinding::AddGarment),
                 ArcsimBinding::InstanceMethod("start_sim", &ArcsimBinding::StartSimulation),
                 ArcsimBinding::InstanceMethod("pause_sim", &ArcsimBinding::PauseSimulation),
-                ArcsimBinding::InstanceMethod("generate_mesh", &ArcsimBinding::GenerateMesh)
+                ArcsimBinding::InstanceMethod("generate_mesh", &ArcsimBinding::GenerateMesh),
+                ArcsimBinding::InstanceMethod("generate_mesh_batch", &ArcsimBinding::GenerateMeshBatch),
+                ArcsimBinding::InstanceMethod("warm_sessions", &ArcsimBinding::WarmSessions),
+                ArcsimBinding::InstanceMethod("set_mesh_cache", &ArcsimBinding::SetMeshCache),
+                ArcsimBinding::InstanceMethod("mesh_cache_stats", &ArcsimBinding::MeshCacheStats),
+                ArcsimBinding::InstanceMethod("set_obstacle_cache", &ArcsimBinding::SetObstacleCache),
+                ArcsimBinding::InstanceMethod("obstacle_cache_stats", &ArcsimBinding::ObstacleCacheStats),
+                ArcsimBinding::InstanceMethod("generate_obstacle_sdf", &ArcsimBinding::GenerateObstacleSdf),
+                ArcsimBinding::InstanceMethod("set_sdf_cache", &ArcsimBinding::SetSdfCache),
+                ArcsimBinding::InstanceMethod("sdf_cache_stats", &ArcsimBinding::SdfCacheStats)
     });
 }
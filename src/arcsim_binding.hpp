@@ -5,12 +5,20 @@
 
 #include <napi.h>
 #include <map>
+#include <memory>
 #include "shared_library.hpp"
+#include "arcsim_api.hpp"
+
+class SessionPool;
+class MeshCache;
+class WorkerPool;
+struct ARCSimSession;
 
 class ArcsimBinding : public Napi::ObjectWrap<ArcsimBinding>
 {
 public:
     ArcsimBinding(const Napi::CallbackInfo&);
+    ~ArcsimBinding();
     Napi::Value Version(const Napi::CallbackInfo&);
     Napi::Value CreateSimulationSession(const Napi::CallbackInfo&);
     Napi::Value DestroySimulationSession(const Napi::CallbackInfo&);
@@ -20,15 +28,44 @@ public:
     Napi::Value PauseSimulation(const Napi::CallbackInfo&);
 
     Napi::Value GenerateMesh(const Napi::CallbackInfo&);    
+    Napi::Value GenerateMeshBatch(const Napi::CallbackInfo&);
+    Napi::Value WarmSessions(const Napi::CallbackInfo&);
+    Napi::Value SetMeshCache(const Napi::CallbackInfo&);
+    Napi::Value MeshCacheStats(const Napi::CallbackInfo&);
+    Napi::Value SetObstacleCache(const Napi::CallbackInfo&);
+    Napi::Value ObstacleCacheStats(const Napi::CallbackInfo&);
+    Napi::Value GenerateObstacleSdf(const Napi::CallbackInfo&);
+    Napi::Value SetSdfCache(const Napi::CallbackInfo&);
+    Napi::Value SdfCacheStats(const Napi::CallbackInfo&);
     
     static Napi::Function GetClass(Napi::Env);
 
+    // Called once for every Node environment (main thread or worker) the
+    // addon is loaded in
+    static void RegisterEnvironment(Napi::Env);
+
 private:
+    // Destroys the sessions still running and stops the meshing jobs, before
+    // their environment goes away
+    void Shutdown();
+    static void CleanupEnvironment(void* env);
+    void ConfigureMeshCache(Napi::Env, const Napi::Value& options);
+
+    napi_env env_;
     std::string plugin_path_;
     ARCSim::SharedLibrary::HandleType plugin_handle_;
+    std::shared_ptr<const ArcsimApi> api_;
+    // Shared with meshing requests, which hand their session back when done
+    std::shared_ptr<SessionPool> session_pool_;
+    // Threads shared by the meshing requests, which run no more at once
+    std::shared_ptr<WorkerPool> meshing_workers_;
+    // Meshing results kept on disk, set by the mesh_cache option
+    std::shared_ptr<MeshCache> mesh_cache_;
+    // Obstacle SDFs kept on disk, set by set_sdf_cache
+    std::shared_ptr<MeshCache> sdf_cache_;
     
-    // Session info    
-    std::map<int, void*> per_session_sim_params; 
+    // Session info, shared with the asset workers still adding to them
+    std::map<int, std::shared_ptr<ARCSimSession> > per_session_sim_params; 
 };
 
 
@@ -4,6 +4,7 @@
 #pragma once
 
 #include <napi.h>
+#include <string>
 
 class ArcsimTranslator : public Napi::ObjectWrap<ArcsimTranslator>
 {
@@ -17,8 +18,7 @@ public:
 
 private:
 
-    void LoadBinJson( const std::string& json_path, const std::string& bin_path,
-                      std::string& json_data, std::shared_ptr<char>& bin_data, uint64_t& bin_size);
+    static std::string LoadJson( const std::string& json_path );
     
 
     
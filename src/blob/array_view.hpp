@@ -0,0 +1,79 @@
+#ifndef GEOMETRY_BLOB_ARRAY_VIEW_
+#define GEOMETRY_BLOB_ARRAY_VIEW_
+
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+
+namespace Geometry
+{
+    // Non-owning, read-only view of a contiguous array, for handing out blob
+    // contents without copying them. Only valid while the viewed storage is
+    // neither modified nor destroyed.
+    template< typename T >
+    class ArrayView
+    {
+    public:
+        typedef T value_type;
+        typedef const T* const_iterator;
+
+        ArrayView()
+            : data_( nullptr ),
+              size_( 0 )
+        {}
+
+        ArrayView( const T* data, size_t size )
+            : data_( data ),
+              size_( size )
+        {}
+
+        ArrayView( const std::vector< T >& vector )
+            : data_( vector.data() ),
+              size_( vector.size() )
+        {}
+
+        const T* data() const
+        {
+            return data_;
+        }
+
+        size_t size() const
+        {
+            return size_;
+        }
+
+        bool empty() const
+        {
+            return size_ == 0;
+        }
+
+        const T* begin() const
+        {
+            return data_;
+        }
+
+        const T* end() const
+        {
+            return data_ + size_;
+        }
+
+        const T& operator[]( size_t index ) const
+        {
+            return data_[index];
+        }
+
+        const T& at( size_t index ) const
+        {
+            if( index >= size_ )
+                throw std::out_of_range( "ArrayView index out of range" );
+            return data_[index];
+        }
+
+    private:
+        const T* data_;
+        size_t size_;
+    };
+}
+
+#endif // GEOMETRY_BLOB_ARRAY_VIEW_
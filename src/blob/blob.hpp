@@ -2,14 +2,17 @@
 #define GEOMETRY_API_BLOB
 
 #include <blob/blob_formats/formats.hpp>
-
-#include <typeinfo>
+#include <blob/array_view.hpp>
+#include <blob/content_hash.hpp>
 
 
 namespace Geometry
 {
+    class BlobView;
+
     class Blob
     {
+        friend class BlobView;
 
     public:
         // FIXME: this structure is replicated from BinBlob interface
@@ -34,6 +37,9 @@ namespace Geometry
                                           );                
             }
                             
+        // Walks the CAST_FROM chain from PREV_FORMAT up to CURR_FORMAT at compile
+        // time. Every step moves the buffers into the next format, so `other` is
+        // left empty and the mesh data itself is never copied.
         template< class CURR_FORMAT, class PREV_FORMAT, typename = void >
         struct UpConvertHelper;
 
@@ -41,10 +47,9 @@ namespace Geometry
         struct UpConvertHelper<CURR_FORMAT, PREV_FORMAT,
                                typename std::enable_if< std::is_same< typename CURR_FORMAT::CAST_FROM , PREV_FORMAT >::value >::type >
         {
-            void operator()(CURR_FORMAT& current, const blob_formats::format_base* other)
+            void operator()(CURR_FORMAT& current, PREV_FORMAT&& other)
                 {
-                    const PREV_FORMAT* prev_ptr = dynamic_cast<const PREV_FORMAT*>( other );
-                    current = *prev_ptr;
+                    current = std::move( other );
                 }
 
         };
@@ -53,14 +58,13 @@ namespace Geometry
         struct UpConvertHelper<CURR_FORMAT, PREV_FORMAT,
                                typename std::enable_if< !std::is_same< typename CURR_FORMAT::CAST_FROM , PREV_FORMAT >::value >::type >
         {
-            void operator()(CURR_FORMAT& current, const blob_formats::format_base* other)
+            void operator()(CURR_FORMAT& current, PREV_FORMAT&& other)
                 {
                     typedef typename CURR_FORMAT::CAST_FROM INTERMEDIATE_FORMAT;
 
-                    std::unique_ptr< INTERMEDIATE_FORMAT > f_inter = std::make_unique<INTERMEDIATE_FORMAT>();
-                    INTERMEDIATE_FORMAT* inter_ptr = f_inter.get();
-                    UpConvertHelper< INTERMEDIATE_FORMAT, PREV_FORMAT >()(*inter_ptr, other );
-                    UpConvertHelper< CURR_FORMAT, INTERMEDIATE_FORMAT>()( current, inter_ptr );
+                    INTERMEDIATE_FORMAT intermediate;
+                    UpConvertHelper< INTERMEDIATE_FORMAT, PREV_FORMAT >()( intermediate, std::move( other ) );
+                    UpConvertHelper< CURR_FORMAT, INTERMEDIATE_FORMAT>()( current, std::move( intermediate ) );
                 }
 
         };
@@ -71,7 +75,7 @@ namespace Geometry
         const uint16_t version_minor;
         uint16_t orig_version_major;
         uint16_t orig_version_minor;
-        typedef blob_formats::format_0_3 CURRENT_FORMAT;
+        typedef blob_formats::format_0_4 CURRENT_FORMAT;
         std::unique_ptr<CURRENT_FORMAT> blob;
 
     public:
@@ -151,15 +155,29 @@ namespace Geometry
             return blob->include_2D_coords;
         }
 
+        /*
+        *   Setters have overloads taking their arrays by rvalue reference, which
+        *   take over the caller's buffers instead of copying them
+        */
+
         void Set3DVertices(const std::vector< std::array< float, 3 > >& vertices)
         {
-            blob->vertices_3D = vertices;
+            Set3DVertices( std::vector< std::array< float, 3 > >( vertices ) );
+        }
+
+        void Set3DVertices(std::vector< std::array< float, 3 > >&& vertices)
+        {
             blob->n_vertices = static_cast<uint32_t>(vertices.size());
+            blob->vertices_3D = std::move( vertices );
         }
 
         void Set2DVertices(const std::vector< std::array< float, 2 > >& vertices)
         {
-            blob->vertices_2D = vertices;
+            Set2DVertices( std::vector< std::array< float, 2 > >( vertices ) );
+        }
+
+        void Set2DVertices(std::vector< std::array< float, 2 > >&& vertices)
+        {
             if( vertices.size() > 0 )
                 blob->include_2D_coords = true;
             else
@@ -167,6 +185,7 @@ namespace Geometry
 
                 // If this doesn't match the 3D vertex count, the self-check will catch it...
             blob->n_vertices = static_cast<uint32_t>(vertices.size());
+            blob->vertices_2D = std::move( vertices );
         }
 
         void SetNumTexChannels( uint32_t channels )
@@ -180,10 +199,20 @@ namespace Geometry
             blob->texture_channels.at( channel ) = coords;
         }
 
+        void SetTexChannel(uint32_t channel, std::vector< std::array< float, 2 > >&& coords )
+        {
+            blob->texture_channels.at( channel ) = std::move( coords );
+        }
+
         void SetFaces(const std::vector< std::array< uint32_t, 3> >& faces)
         {
-            blob->faces = faces;
+            SetFaces( std::vector< std::array< uint32_t, 3> >( faces ) );
+        }
+
+        void SetFaces(std::vector< std::array< uint32_t, 3> >&& faces)
+        {
             blob->n_faces = static_cast<uint32_t>(faces.size());
+            blob->faces = std::move( faces );
         }
 
         void SetNumPieces( uint32_t num_pieces)
@@ -198,6 +227,12 @@ namespace Geometry
             blob->pieces.at(piece_id).vertices = vertices;
         }
 
+        void SetPiece(uint32_t piece_id, const std::string& name, std::vector<uint32_t>&& vertices )
+        {
+            blob->pieces.at(piece_id).name = name;
+            blob->pieces.at(piece_id).vertices = std::move( vertices );
+        }
+
         void SetNumCurves( uint32_t num_curves )
         {
             blob->curves.resize( num_curves );
@@ -211,12 +246,24 @@ namespace Geometry
             blob->curves.at(curve_id).vertices = vertices;
         }
 
+        void SetCurve( uint32_t curve_id, const std::string& name, uint32_t piece_id, std::vector< uint32_t >&& vertices )
+        {
+            blob->curves.at(curve_id).name = name;
+            blob->curves.at(curve_id).piece_id = piece_id;
+            blob->curves.at(curve_id).vertices = std::move( vertices );
+        }
+
         void SetGeomData( std::string data_name, bool face_centric, const std::vector< double >& data )
         {
 
             blob->geom_data[data_name] = std::pair< bool, std::vector< double > >( face_centric, data );
         }
 
+        void SetGeomData( std::string data_name, bool face_centric, std::vector< double >&& data )
+        {
+            blob->geom_data[data_name] = std::pair< bool, std::vector< double > >( face_centric, std::move( data ) );
+        }
+
         const std::vector< std::array< float, 3 > >& Get3DVertices() const
         {
             return blob->vertices_3D;
@@ -250,6 +297,150 @@ namespace Geometry
             vertices = blob->curves.at(curve_id).vertices;
         }
 
+        /*
+        *   Views into the blob, valid until it is modified or destroyed. Unlike
+        *   GetPiece / GetCurve / GetGeomData they never copy or allocate.
+        */
+
+        const std::string& GetPieceName( uint32_t piece_id ) const
+        {
+            return blob->pieces.at(piece_id).name;
+        }
+
+        ArrayView< uint32_t > GetPieceVertices( uint32_t piece_id ) const
+        {
+            return blob->pieces.at(piece_id).vertices;
+        }
+
+        const std::string& GetCurveName( uint32_t curve_id ) const
+        {
+            return blob->curves.at(curve_id).name;
+        }
+
+        uint32_t GetCurvePiece( uint32_t curve_id ) const
+        {
+            return blob->curves.at(curve_id).piece_id;
+        }
+
+        ArrayView< uint32_t > GetCurveVertices( uint32_t curve_id ) const
+        {
+            return blob->curves.at(curve_id).vertices;
+        }
+
+        ArrayView< std::array< float, 2 > > GetTexChannelView( uint32_t channel ) const
+        {
+            return blob->texture_channels.at( channel );
+        }
+
+        bool HasGeomData( const std::string& data_name ) const
+        {
+            return blob->geom_data.count( data_name ) > 0;
+        }
+
+        bool IsGeomDataFaceCentric( const std::string& data_name ) const
+        {
+            return blob->geom_data.at(data_name).first;
+        }
+
+        ArrayView< double > GetGeomDataView( const std::string& data_name ) const
+        {
+            return blob->geom_data.at(data_name).second;
+        }
+
+        // Hash of everything but the 3D vertices and geometry data: counts,
+        // faces, 2D coordinates, texture channels, pieces and curves. Stays the
+        // same from frame to frame until the mesh is changed.
+        uint64_t TopologyHash() const
+        {
+            ContentHash hash;
+            hash.UpdateValue( blob->n_vertices );
+            hash.UpdateValue( blob->n_faces );
+            hash.UpdateValue( blob->n_pieces );
+            hash.UpdateValue( blob->n_curves );
+            hash.UpdateValue( blob->n_texture_channels );
+            hash.UpdateValue( blob->include_2D_coords );
+
+            hash.Update( blob->faces.data(), blob->faces.size() * sizeof( blob->faces[0] ) );
+            if( blob->include_2D_coords )
+                hash.Update( blob->vertices_2D.data(), blob->vertices_2D.size() * sizeof( blob->vertices_2D[0] ) );
+            for( const auto& channel : blob->texture_channels )
+                hash.Update( channel.data(), channel.size() * sizeof( channel[0] ) );
+
+            for( const auto& piece : blob->pieces ){
+                hash.UpdateValue( uint64_t( piece.name.size() ) ).Update( piece.name.data(), piece.name.size() );
+                hash.UpdateValue( uint64_t( piece.vertices.size() ) ).Update( piece.vertices.data(), piece.vertices.size() * sizeof(uint32_t) );
+            }
+            for( const auto& curve : blob->curves ){
+                hash.UpdateValue( uint64_t( curve.name.size() ) ).Update( curve.name.data(), curve.name.size() );
+                hash.UpdateValue( curve.piece_id );
+                hash.UpdateValue( uint64_t( curve.vertices.size() ) ).Update( curve.vertices.data(), curve.vertices.size() * sizeof(uint32_t) );
+            }
+            return hash.Digest();
+        }
+
+        // Adds the mesh of another blob as disconnected pieces of this one:
+        // its faces, pieces and curves are offset by this blob's vertex and
+        // piece counts. Geometry data missing on either side is zero filled.
+        void Append( const Blob& other )
+        {
+            const CURRENT_FORMAT& source = *other.blob;
+            const uint32_t vertex_offset = blob->n_vertices;
+            const uint32_t face_offset = blob->n_faces;
+            const uint32_t piece_offset = blob->n_pieces;
+            const bool empty = blob->n_vertices == 0 && blob->n_pieces == 0;
+
+            if( !empty && ( blob->include_2D_coords != source.include_2D_coords ||
+                            blob->n_texture_channels != source.n_texture_channels ) )
+                throw BlobError::Consistency( "Cannot append a blob with different 2D coordinates or texture channels" );
+            if( blob->name.empty() )
+                blob->name = source.name;
+            if( empty ){
+                blob->include_2D_coords = source.include_2D_coords;
+                SetNumTexChannels( source.n_texture_channels );
+            }
+
+            blob->vertices_3D.insert( blob->vertices_3D.end(), source.vertices_3D.begin(), source.vertices_3D.end() );
+            blob->vertices_2D.insert( blob->vertices_2D.end(), source.vertices_2D.begin(), source.vertices_2D.end() );
+            for( uint32_t channel = 0; channel < blob->n_texture_channels; ++channel )
+                blob->texture_channels[channel].insert( blob->texture_channels[channel].end(),
+                                                        source.texture_channels[channel].begin(),
+                                                        source.texture_channels[channel].end() );
+
+            blob->faces.reserve( blob->faces.size() + source.faces.size() );
+            for( const auto& face : source.faces )
+                blob->faces.push_back( { face[0] + vertex_offset, face[1] + vertex_offset, face[2] + vertex_offset } );
+
+            for( const auto& piece : source.pieces ){
+                blob->pieces.push_back( piece );
+                for( uint32_t& v : blob->pieces.back().vertices )
+                    v += vertex_offset;
+            }
+            for( const auto& curve : source.curves ){
+                blob->curves.push_back( curve );
+                blob->curves.back().piece_id += piece_offset;
+                for( uint32_t& v : blob->curves.back().vertices )
+                    v += vertex_offset;
+            }
+
+            blob->n_vertices += source.n_vertices;
+            blob->n_faces += source.n_faces;
+            blob->n_pieces += source.n_pieces;
+            blob->n_curves += source.n_curves;
+
+            // Geometry data holds one value per vertex or face
+            for( const auto& entry : source.geom_data ){
+                const bool face_centric = entry.second.first;
+                auto& target = blob->geom_data[entry.first];
+                target.first = face_centric;
+                target.second.resize( face_centric ? face_offset : vertex_offset, 0.0 );
+                target.second.insert( target.second.end(), entry.second.second.begin(), entry.second.second.end() );
+            }
+            for( auto& entry : blob->geom_data ){
+                if( !source.geom_data.count( entry.first ) )
+                    entry.second.second.resize( entry.second.first ? blob->n_faces : blob->n_vertices, 0.0 );
+            }
+        }
+
         std::vector< std::string > GetGeomDataNames()
         {
             std::vector< std::string > names;
@@ -284,27 +475,27 @@ namespace Geometry
         template<typename BufferType>
         void Load(const BufferType& blobdata)
         {
-            std::stringstream data;
-
-                // Load binary data into a buffer container
-            data.write( blobdata.buffer, blobdata.len );
-                // ... and return to the beginning
-            data.seekg(0);
-
-            Load<std::stringstream::char_type, std::stringstream::traits_type>( data );
+                // Decode straight from the caller's memory, without copying it into a stream
+            BufferReader reader( blobdata.buffer, blobdata.len );
+            LoadFrom( reader );
         }
 
         template <typename charT, typename traits>
         void Load( std::basic_istream<charT, traits>& in_stream)
+        {
+                // Trigger exceptions if we encounter a bad buffer state
+            in_stream.exceptions( std::ios_base::failbit | std::ios_base::badbit | std::ios_base::eofbit );
+            LoadFrom( in_stream );
+        }
+
+    private:
+        template <typename Reader>
+        void LoadFrom( Reader& in_stream )
         {
             std::stringstream errout;
             blob = std::make_unique<CURRENT_FORMAT>();
 
             try {
-                    // Trigger exceptions if we encounter a bad buffer state
-                in_stream.exceptions( std::ios_base::failbit | std::ios_base::badbit | std::ios_base::eofbit );
-
-
                     // Read and check version
                 {
                     uint16_t loaded_version_major = 0, loaded_version_minor = 0;
@@ -313,16 +504,13 @@ namespace Geometry
                     if( loaded_version_major != version_major ||
                         loaded_version_minor != version_minor ){
                         if( loaded_version_major == 0 && loaded_version_minor == 1 ){
-                            std::unique_ptr<blob_formats::format_0_1> format_0_1_blob = std::make_unique<blob_formats::format_0_1>();
-                            format_0_1_blob->Load( in_stream );
-                            format_0_1_blob->self_check();
-                            UpConvertHelper<CURRENT_FORMAT, blob_formats::format_0_1>()( *blob.get(), format_0_1_blob.get() );
+                            LoadLegacy<blob_formats::format_0_1>( in_stream );
                         }
                         else if( loaded_version_major == 0 && loaded_version_minor == 2 ){
-                            std::unique_ptr<blob_formats::format_0_2> format_0_2_blob = std::make_unique<blob_formats::format_0_2>();
-                            format_0_2_blob->Load( in_stream );
-                            format_0_2_blob->self_check();
-                            UpConvertHelper<CURRENT_FORMAT, blob_formats::format_0_2>()( *blob.get(), format_0_2_blob.get() );
+                            LoadLegacy<blob_formats::format_0_2>( in_stream );
+                        }
+                        else if( loaded_version_major == 0 && loaded_version_minor == 3 ){
+                            LoadLegacy<blob_formats::format_0_3>( in_stream );
                         }
                         else{
                             errout << "Version mismatch. Expecting " << version_major << "." <<
@@ -331,7 +519,7 @@ namespace Geometry
                         }
                     }
                     else{
-                        blob->Load( in_stream );
+                        blob->LoadFrom( in_stream );
                     }
                     orig_version_major = loaded_version_major;
                     orig_version_minor = loaded_version_minor;
@@ -347,51 +535,79 @@ namespace Geometry
             SelfCheck();
         }
 
-        BinBlob_UniquePtr Save() const
+        // Decodes an older version once and moves it up into the current format
+        template <class FORMAT, typename Reader>
+        void LoadLegacy( Reader& in_stream )
         {
+            FORMAT legacy_blob;
+            legacy_blob.LoadFrom( in_stream );
+            legacy_blob.self_check();
+            UpConvertHelper<CURRENT_FORMAT, FORMAT>()( *blob, std::move( legacy_blob ) );
+        }
 
-            std::stringstream data;
-            std::stringstream errout;
-
-            Save( data );
+    public:
+        // Exact number of bytes Save produces for the current contents.
+        //
+        // Here and in Save(char*, uint64_t), FORMAT may name an older format the
+        // current one derives from, to write files for readers that predate it.
+        template< class FORMAT = CURRENT_FORMAT >
+        uint64_t SerializedSize() const
+        {
+            static_assert( std::is_base_of< FORMAT, CURRENT_FORMAT >::value, "The current format cannot be written as FORMAT" );
+            return 2 * sizeof( uint16_t ) + static_cast<const FORMAT&>( *blob ).serialized_size();
+        }
 
-                // Allocate the BinBlob according to the amount of data written to the stringstream
+        BinBlob_UniquePtr Save() const
+        {
+                // Serialize straight into a single allocation of the exact size.
                 // The following is safe as long as the buffer we are allocating never escapes this
                 // function unless wrapped by the BinBlob unique_ptr with custom deleter. This deleter
                 // will take care of the deallocation once the client is finished with the BinBlob.
-            std::streamoff buffer_size = data.tellp();
-            if( buffer_size != std::streamoff(-1)){
-                unsigned long len = static_cast<unsigned long>( buffer_size );
-                char* buffer = new char[ len ];
-                data.seekg(0);
-                data.read( buffer, len );
-                BinBlob_UniquePtr output_blob = BuildSafeBlobPtr();
-                output_blob = std::make_unique<BinBuffer>();
-                output_blob->buffer = buffer;
-                output_blob->len = len;                
-                return output_blob;
-            }
-            else{
-                errout << "Failed to write Blob object: Error in reading buffer size.";
-                throw BlobError::IO(errout.str());
-            }
+            const uint64_t len = SerializedSize();
+            std::unique_ptr<char[]> buffer( new char[ len ] );
+            Save( buffer.get(), len );
+
+            BinBlob_UniquePtr output_blob = BuildSafeBlobPtr();
+            output_blob.reset( new BinBuffer() );
+            output_blob->buffer = buffer.release();
+            output_blob->len = len;
+            return output_blob;
+        }
+
+        // Serializes into caller-owned memory, which must hold at least
+        // SerializedSize<FORMAT>() bytes. Returns the number of bytes written.
+        template< class FORMAT = CURRENT_FORMAT >
+        uint64_t Save( char* buffer, uint64_t len ) const
+        {
+            BufferWriter writer( buffer, len );
+            SaveTo<FORMAT>( writer );
+            return writer.tellp();
         }
 
         template <typename charT, typename traits>
         void Save( std::basic_ostream<charT,traits>& out_stream) const
         {
+                // Trigger exceptions if we encounter a bad buffer state
+            out_stream.exceptions( std::ios_base::failbit | std::ios_base::badbit | std::ios_base::eofbit );
+            SaveTo( out_stream );
+        }
+
+    private:
+        template <class FORMAT = CURRENT_FORMAT, typename Writer>
+        void SaveTo( Writer& out_stream ) const
+        {
+            static_assert( std::is_base_of< FORMAT, CURRENT_FORMAT >::value, "The current format cannot be written as FORMAT" );
             SelfCheck();
 
             std::stringstream errout;
 
             try {
-                    // Trigger exceptions if we encounter a bad buffer state
-                out_stream.exceptions( std::ios_base::failbit | std::ios_base::badbit | std::ios_base::eofbit );
-
-                out_stream.write( reinterpret_cast<const char*>(&version_major), sizeof( uint16_t ));
-                out_stream.write( reinterpret_cast<const char*>(&version_minor), sizeof( uint16_t ));
+                const uint16_t format_version_major = static_cast<uint16_t>( FORMAT::version_major() );
+                const uint16_t format_version_minor = static_cast<uint16_t>( FORMAT::version_minor() );
+                out_stream.write( reinterpret_cast<const char*>(&format_version_major), sizeof( uint16_t ));
+                out_stream.write( reinterpret_cast<const char*>(&format_version_minor), sizeof( uint16_t ));
 
-                blob->Save( out_stream );
+                static_cast<const FORMAT&>( *blob ).SaveTo( out_stream );
 
             }
             catch( std::ios_base::failure &fail) {
@@ -402,7 +618,6 @@ namespace Geometry
             }
         }
 
-
     };
 }
 
@@ -160,6 +160,13 @@ namespace Geometry
             }
 
             virtual void Load( std::istream& data )
+            {
+                LoadFrom( data );
+            }
+
+            // Shared by stream and in-memory (BufferReader) decoding
+            template< typename Reader >
+            void LoadFrom( Reader& data )
             {
                     // Read name
                 {
@@ -203,21 +210,13 @@ namespace Geometry
 
                     // Read 3D vertices
                 {
-                    for( uint32_t v = 0; v < n_vertices; v++ ){
-                        VEC3D vertex;
-                        data.read( reinterpret_cast<char*>( vertex.data() ), sizeof(VEC3D) );
-                        vertices_3D.push_back( vertex );
-                    }
+                    read_array( data, vertices_3D, n_vertices );
                 }
 
                     // Read 2D vertices
                 {
                     if( include_2D_coords ){
-                        for( uint32_t v = 0; v < n_vertices; v++ ){
-                            VEC2D vertex;
-                            data.read( reinterpret_cast<char*>( vertex.data() ), sizeof(VEC2D) );
-                            vertices_2D.push_back( vertex );
-                        }
+                        read_array( data, vertices_2D, n_vertices );
                     }
                     else
                         vertices_2D.resize(0);
@@ -226,23 +225,14 @@ namespace Geometry
                     // Read Texture Coords
                 {
                     for( uint32_t c = 0 ; c < n_texture_channels; c++ ){
-                        VERTEX2D_ARRAY tex_channel;
-                        for( uint32_t v = 0; v < n_vertices; v++ ){
-                            VEC2D vertex;
-                            data.read( reinterpret_cast<char*>( vertex.data() ), sizeof(VEC2D) );
-                            tex_channel.push_back( vertex );
-                        }
-                        texture_channels.push_back( tex_channel );
+                        texture_channels.emplace_back();
+                        read_array( data, texture_channels.back(), n_vertices );
                     }
                 }
 
                     // Read Faces
                 {
-                    for( uint32_t v = 0; v < n_faces; v++ ){
-                        TRIANGLE tri;
-                        data.read( reinterpret_cast<char*>( tri.data() ), sizeof(TRIANGLE) );
-                        faces.push_back( tri );
-                    }
+                    read_array( data, faces, n_faces );
                 }
 
                     // Read Pieces
@@ -261,12 +251,8 @@ namespace Geometry
                         data.read( reinterpret_cast<char*>( &(curve.piece_id) ), sizeof( uint32_t ) );
                         uint32_t curve_verts;
                         data.read( reinterpret_cast<char*>( &curve_verts ), sizeof( uint32_t ) );
-                        for( uint32_t v = 0; v < curve_verts; v++ ){
-                            uint32_t vert_idx;
-                            data.read( reinterpret_cast<char*>( &vert_idx ), sizeof( uint32_t ) );
-                            curve.vertices.push_back( vert_idx );
-                        }
-                        curves.push_back( curve );
+                        read_array( data, curve.vertices, curve_verts );
+                        curves.push_back( std::move( curve ) );
                     }
                 }
 
@@ -70,23 +70,32 @@ namespace Geometry
 
             format_0_2& operator=( const CAST_FROM& other )
             {
-                name = other.name;
+                CAST_FROM copy( other );
+                return *this = std::move( copy );
+            }
+
+            // Takes over the buffers of `other` instead of copying them
+            format_0_2& operator=( CAST_FROM&& other )
+            {
+                name = std::move( other.name );
                 n_texture_channels = other.n_texture_channels;
                 include_2D_coords = other.include_2D_coords;
                 n_vertices = other.n_vertices;
                 n_faces = other.n_faces;
                 n_pieces = other.n_pieces;
                 n_curves = other.n_curves;
-                vertices_3D = other.vertices_3D;
-                vertices_2D = other.vertices_2D;
-                texture_channels = other.texture_channels;
-                faces = other.faces;
+                vertices_3D = std::move( other.vertices_3D );
+                vertices_2D = std::move( other.vertices_2D );
+                texture_channels = std::move( other.texture_channels );
+                faces = std::move( other.faces );
+                curves.clear();
+                curves.reserve( n_curves );
                 for( uint32_t c = 0; c < n_curves; c++){
                     CURVE curve;
-                    curve.name = other.curves.at(c).name;
+                    curve.name = std::move( other.curves.at(c).name );
                     curve.piece_id = other.curves.at(c).piece_id;
-                    curve.vertices = other.curves.at(c).vertices;
-                    curves.push_back(curve);
+                    curve.vertices = std::move( other.curves.at(c).vertices );
+                    curves.push_back( std::move( curve ) );
                 }
 
                     // Build reverse vertex / face map for acceleration
@@ -96,9 +105,11 @@ namespace Geometry
                         verts2faces[v].push_back( f );
 
 
+                pieces.clear();
+                pieces.reserve( n_pieces );
                 for( uint32_t p = 0; p < n_pieces; p++){
                     PIECE piece;
-                    piece.name = other.pieces.at(p);
+                    piece.name = std::move( other.pieces.at(p) );
                         // Generate interior vertices....
                     std::unordered_set<uint32_t> vert_set;
                     std::vector< uint32_t > vert_queue;
@@ -121,7 +132,7 @@ namespace Geometry
                     }
                     piece.vertices.insert( piece.vertices.begin(), vert_set.begin(), vert_set.end() );
                     std::sort( piece.vertices.begin(), piece.vertices.end() );
-                    pieces.push_back( piece );
+                    pieces.push_back( std::move( piece ) );
                 }
                 return *this;
             }
@@ -235,6 +246,13 @@ namespace Geometry
             }
 
             virtual void Load( std::istream& data )
+            {
+                LoadFrom( data );
+            }
+
+            // Shared by stream and in-memory (BufferReader) decoding
+            template< typename Reader >
+            void LoadFrom( Reader& data )
             {
                     // Read name
                 {
@@ -278,21 +296,13 @@ namespace Geometry
 
                     // Read 3D vertices
                 {
-                    for( uint32_t v = 0; v < n_vertices; v++ ){
-                        VEC3D vertex;
-                        data.read( reinterpret_cast<char*>( vertex.data() ), sizeof(VEC3D) );
-                        vertices_3D.push_back( vertex );
-                    }
+                    read_array( data, vertices_3D, n_vertices );
                 }
 
                     // Read 2D vertices
                 {
                     if( include_2D_coords ){
-                        for( uint32_t v = 0; v < n_vertices; v++ ){
-                            VEC2D vertex;
-                            data.read( reinterpret_cast<char*>( vertex.data() ), sizeof(VEC2D) );
-                            vertices_2D.push_back( vertex );
-                        }
+                        read_array( data, vertices_2D, n_vertices );
                     }
                     else
                         vertices_2D.resize(0);
@@ -301,23 +311,14 @@ namespace Geometry
                     // Read Texture Coords
                 {
                     for( uint32_t c = 0 ; c < n_texture_channels; c++ ){
-                        VERTEX2D_ARRAY tex_channel;
-                        for( uint32_t v = 0; v < n_vertices; v++ ){
-                            VEC2D vertex;
-                            data.read( reinterpret_cast<char*>( vertex.data() ), sizeof(VEC2D) );
-                            tex_channel.push_back( vertex );
-                        }
-                        texture_channels.push_back( tex_channel );
+                        texture_channels.emplace_back();
+                        read_array( data, texture_channels.back(), n_vertices );
                     }
                 }
 
                     // Read Faces
                 {
-                    for( uint32_t v = 0; v < n_faces; v++ ){
-                        TRIANGLE tri;
-                        data.read( reinterpret_cast<char*>( tri.data() ), sizeof(TRIANGLE) );
-                        faces.push_back( tri );
-                    }
+                    read_array( data, faces, n_faces );
                 }
 
                     // Read Pieces (Names Only)
@@ -337,12 +338,8 @@ namespace Geometry
                         data.read( reinterpret_cast<char*>( &(curve.piece_id) ), sizeof( uint32_t ) );
                         uint32_t curve_verts;
                         data.read( reinterpret_cast<char*>( &curve_verts ), sizeof( uint32_t ) );
-                        for( uint32_t v = 0; v < curve_verts; v++ ){
-                            uint32_t vert_idx;
-                            data.read( reinterpret_cast<char*>( &vert_idx ), sizeof( uint32_t ) );
-                            curve.vertices.push_back( vert_idx );
-                        }
-                        curves.push_back( curve );
+                        read_array( data, curve.vertices, curve_verts );
+                        curves.push_back( std::move( curve ) );
                     }
                 }
 
@@ -359,11 +356,7 @@ namespace Geometry
                         PIECE& piece = pieces.at(p);
                         uint32_t piece_verts;
                         data.read( reinterpret_cast<char*>( &piece_verts ), sizeof( uint32_t ) );
-                        for( uint32_t v = 0; v < piece_verts; v++ ){
-                            uint32_t vert_idx;
-                            data.read( reinterpret_cast<char*>( &vert_idx ), sizeof( uint32_t ) );
-                            piece.vertices.push_back( vert_idx );
-                        }
+                        read_array( data, piece.vertices, piece_verts );
                     }
                 }
 
@@ -75,31 +75,42 @@ namespace Geometry
 
             format_0_3& operator=( const CAST_FROM& other )
             {
-                name = other.name;
+                CAST_FROM copy( other );
+                return *this = std::move( copy );
+            }
+
+            // Takes over the buffers of `other` instead of copying them
+            format_0_3& operator=( CAST_FROM&& other )
+            {
+                name = std::move( other.name );
                 n_texture_channels = other.n_texture_channels;
                 include_2D_coords = other.include_2D_coords;
                 n_vertices = other.n_vertices;
                 n_faces = other.n_faces;
                 n_pieces = other.n_pieces;
                 n_curves = other.n_curves;
-                vertices_3D = other.vertices_3D;
-                vertices_2D = other.vertices_2D;
-                texture_channels = other.texture_channels;
-                faces = other.faces;
+                vertices_3D = std::move( other.vertices_3D );
+                vertices_2D = std::move( other.vertices_2D );
+                texture_channels = std::move( other.texture_channels );
+                faces = std::move( other.faces );
+                curves.clear();
+                curves.reserve( n_curves );
                 for( uint32_t c = 0; c < n_curves; c++){
                     CURVE curve;
-                    curve.name = other.curves.at(c).name;
+                    curve.name = std::move( other.curves.at(c).name );
                     curve.piece_id = other.curves.at(c).piece_id;
-                    curve.vertices = other.curves.at(c).vertices;
-                    curves.push_back(curve);
+                    curve.vertices = std::move( other.curves.at(c).vertices );
+                    curves.push_back( std::move( curve ) );
                 }
+                pieces.clear();
+                pieces.reserve( n_pieces );
                 for( uint32_t p = 0; p < n_pieces; p++){
                     PIECE piece;
-                    piece.name = other.pieces.at(p).name;
-                    piece.vertices.resize( other.pieces.at(p).vertices.size() );
-                    std::copy( other.pieces.at(p).vertices.begin(), other.pieces.at(p).vertices.end(), piece.vertices.begin() );
-                    pieces.push_back( piece );
+                    piece.name = std::move( other.pieces.at(p).name );
+                    piece.vertices = std::move( other.pieces.at(p).vertices );
+                    pieces.push_back( std::move( piece ) );
                 }
+                geom_data.clear();
                 return *this;
             }
 
@@ -224,6 +235,13 @@ namespace Geometry
             }
 
             virtual void Load( std::istream& data )
+            {
+                LoadFrom( data );
+            }
+
+            // Shared by stream and in-memory (BufferReader) decoding
+            template< typename Reader >
+            void LoadFrom( Reader& data )
             {
                     // Read name
                 {
@@ -267,21 +285,13 @@ namespace Geometry
 
                     // Read 3D vertices
                 {
-                    for( uint32_t v = 0; v < n_vertices; v++ ){
-                        VEC3D vertex;
-                        data.read( reinterpret_cast<char*>( vertex.data() ), sizeof(VEC3D) );
-                        vertices_3D.push_back( vertex );
-                    }
+                    read_array( data, vertices_3D, n_vertices );
                 }
 
                     // Read 2D vertices
                 {
                     if( include_2D_coords ){
-                        for( uint32_t v = 0; v < n_vertices; v++ ){
-                            VEC2D vertex;
-                            data.read( reinterpret_cast<char*>( vertex.data() ), sizeof(VEC2D) );
-                            vertices_2D.push_back( vertex );
-                        }
+                        read_array( data, vertices_2D, n_vertices );
                     }
                     else
                         vertices_2D.resize(0);
@@ -290,23 +300,14 @@ namespace Geometry
                     // Read Texture Coords
                 {
                     for( uint32_t c = 0 ; c < n_texture_channels; c++ ){
-                        VERTEX2D_ARRAY tex_channel;
-                        for( uint32_t v = 0; v < n_vertices; v++ ){
-                            VEC2D vertex;
-                            data.read( reinterpret_cast<char*>( vertex.data() ), sizeof(VEC2D) );
-                            tex_channel.push_back( vertex );
-                        }
-                        texture_channels.push_back( tex_channel );
+                        texture_channels.emplace_back();
+                        read_array( data, texture_channels.back(), n_vertices );
                     }
                 }
 
                     // Read Faces
                 {
-                    for( uint32_t v = 0; v < n_faces; v++ ){
-                        TRIANGLE tri;
-                        data.read( reinterpret_cast<char*>( tri.data() ), sizeof(TRIANGLE) );
-                        faces.push_back( tri );
-                    }
+                    read_array( data, faces, n_faces );
                 }
 
                     // Read Pieces (Names Only)
@@ -326,12 +327,8 @@ namespace Geometry
                         data.read( reinterpret_cast<char*>( &(curve.piece_id) ), sizeof( uint32_t ) );
                         uint32_t curve_verts;
                         data.read( reinterpret_cast<char*>( &curve_verts ), sizeof( uint32_t ) );
-                        for( uint32_t v = 0; v < curve_verts; v++ ){
-                            uint32_t vert_idx;
-                            data.read( reinterpret_cast<char*>( &vert_idx ), sizeof( uint32_t ) );
-                            curve.vertices.push_back( vert_idx );
-                        }
-                        curves.push_back( curve );
+                        read_array( data, curve.vertices, curve_verts );
+                        curves.push_back( std::move( curve ) );
                     }
                 }
 
@@ -355,11 +352,7 @@ namespace Geometry
                         PIECE& piece = pieces.at(p);
                         uint32_t piece_verts;
                         data.read( reinterpret_cast<char*>( &piece_verts ), sizeof( uint32_t ) );
-                        for( uint32_t v = 0; v < piece_verts; v++ ){
-                            uint32_t vert_idx;
-                            data.read( reinterpret_cast<char*>( &vert_idx ), sizeof( uint32_t ) );
-                            piece.vertices.push_back( vert_idx );
-                        }
+                        read_array( data, piece.vertices, piece_verts );
                     }
                 }
 
@@ -370,15 +363,8 @@ namespace Geometry
                         std::vector< double > data_array;
                         uint32_t is_face_centric;
                         data.read( reinterpret_cast<char*>( &is_face_centric ), sizeof( uint32_t ) );
-                        if( is_face_centric ){
-                            data_array.resize( n_faces );
-                            data.read( reinterpret_cast<char*>( data_array.data() ), sizeof( double )*n_faces );
-                        }
-                        else{
-                            data_array.resize( n_vertices );
-                            data.read( reinterpret_cast<char*>( data_array.data() ), sizeof( double )*n_vertices );
-                        }
-                        auto res = geom_data.insert( {name, {is_face_centric>0, data_array}} );
+                        read_array( data, data_array, is_face_centric ? n_faces : n_vertices );
+                        auto res = geom_data.insert( {name, {is_face_centric>0, std::move( data_array )}} );
                         if( !res.second ){
                             std::stringstream errout;
                             errout << "Error Loading Blob: Duplicate Geometry Data detected - '"<<name<<"' appears more than once.";
@@ -389,7 +375,37 @@ namespace Geometry
 
             }
 
-        virtual void Save( std::ostream& data ) const
+            // Exact number of bytes Save writes for the current contents
+            uint64_t serialized_size() const
+            {
+                uint64_t size = string_size( name );
+                size += 4 * sizeof(uint32_t);                                   // Tex channels, 2D flag, reserved
+                size += 6 * sizeof(uint32_t);                                   // Element counts, reserved
+                size += uint64_t(n_vertices) * sizeof(VEC3D);
+                if( include_2D_coords )
+                    size += uint64_t(n_vertices) * sizeof(VEC2D);
+                size += uint64_t(n_texture_channels) * n_vertices * sizeof(VEC2D);
+                size += uint64_t(n_faces) * sizeof(TRIANGLE);
+                for( uint32_t p = 0; p < n_pieces; p++ )
+                    size += string_size( pieces.at(p).name );
+                for( uint32_t c = 0; c < n_curves; c++ )
+                    size += string_size( curves.at(c).name ) + 2 * sizeof(uint32_t) + curves.at(c).vertices.size() * sizeof(uint32_t);
+                size += 8 * sizeof(uint32_t);                                   // Geometry data count, reserved
+                for( uint32_t p = 0; p < n_pieces; p++ )
+                    size += sizeof(uint32_t) + pieces.at(p).vertices.size() * sizeof(uint32_t);
+                for( const auto& it : geom_data )
+                    size += string_size( it.first ) + sizeof(uint32_t) + uint64_t(it.second.first ? n_faces : n_vertices) * sizeof(double);
+                return size;
+            }
+
+            virtual void Save( std::ostream& data ) const
+            {
+                SaveTo( data );
+            }
+
+            // Shared by stream and in-memory (BufferWriter) encoding
+            template< typename Writer >
+            void SaveTo( Writer& data ) const
             {
                     // Write name
                 {
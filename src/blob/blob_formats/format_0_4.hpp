@@ -0,0 +1,450 @@
+#ifndef GEOMETRY_BLOB_FORMAT_0_4_
+#define GEOMETRY_BLOB_FORMAT_0_4_
+
+
+namespace Geometry
+{
+    namespace blob_formats
+    {
+        // Same contents as 0.3, laid out so every section can be found without
+        // parsing the ones before it. The header carries a table with the file
+        // offset and size of each section, and numeric arrays start on 16-byte
+        // boundaries, so they can be used in place from a mapped file or an
+        // engine BinBlob.
+        //
+        //  [version][counts][section table][name]
+        //  [3D vertices][2D vertices][texture channels][faces]
+        //  [piece names][curves][piece vertices][geometry data]
+        //
+        // Offsets are measured from the start of the file, including the
+        // version that Blob writes ahead of the format data. Each texture
+        // channel starts on an aligned offset, and so does the array of every
+        // geometry data entry.
+        struct format_0_4 : public format_0_3
+        {
+            typedef format_0_3 CAST_FROM;
+
+            enum Section : uint32_t
+            {
+                SECTION_VERTICES_3D = 0,
+                SECTION_VERTICES_2D,
+                SECTION_TEXTURE_CHANNELS,
+                SECTION_FACES,
+                SECTION_PIECE_NAMES,
+                SECTION_CURVES,
+                SECTION_PIECE_VERTICES,
+                SECTION_GEOM_DATA,
+                SECTION_COUNT
+            };
+
+            struct SECTION_ENTRY
+            {
+                uint64_t offset;
+                uint64_t size;
+            };
+
+            typedef std::array< SECTION_ENTRY, SECTION_COUNT > SECTION_TABLE;
+
+            enum : uint64_t
+            {
+                FILE_OFFSET = 2 * sizeof( uint16_t ),   // Bytes Blob writes ahead of the format data (the version)
+                ALIGNMENT = 16,
+                HEADER_FIELDS = 9                       // Counts, geometry data count, section count and reserved space
+            };
+
+            static uint32_t version_major()
+            {
+                return 0;
+            }
+            static uint32_t version_minor()
+            {
+                return 4;
+            }
+
+            static uint64_t align( uint64_t offset )
+            {
+                return ( offset + ALIGNMENT - 1 ) & ~( ALIGNMENT - 1 );
+            }
+
+            // Distance between the starts of consecutive texture channels
+            static uint64_t texture_channel_stride( uint32_t n_vertices )
+            {
+                return align( uint64_t(n_vertices) * sizeof(VEC2D) );
+            }
+
+            format_0_4& operator=( const CAST_FROM& other )
+            {
+                CAST_FROM::operator=( other );
+                return *this;
+            }
+
+            format_0_4& operator=( CAST_FROM&& other )
+            {
+                CAST_FROM::operator=( std::move( other ) );
+                return *this;
+            }
+
+            // Where Save places each section for the current contents
+            SECTION_TABLE section_table() const
+            {
+                SECTION_TABLE table;
+                uint64_t offset = FILE_OFFSET + HEADER_FIELDS * sizeof(uint32_t) + SECTION_COUNT * sizeof(SECTION_ENTRY) + string_size( name );
+                auto place = [&]( Section section, uint64_t size ){
+                    offset = align( offset );
+                    table[section].offset = offset;
+                    table[section].size = size;
+                    offset += size;
+                };
+
+                const uint64_t channel_size = uint64_t(n_vertices) * sizeof(VEC2D);
+                place( SECTION_VERTICES_3D, uint64_t(n_vertices) * sizeof(VEC3D) );
+                place( SECTION_VERTICES_2D, include_2D_coords ? channel_size : 0 );
+                place( SECTION_TEXTURE_CHANNELS, n_texture_channels ? ( n_texture_channels - 1 ) * texture_channel_stride( n_vertices ) + channel_size : 0 );
+                place( SECTION_FACES, uint64_t(n_faces) * sizeof(TRIANGLE) );
+
+                uint64_t size = 0;
+                for( uint32_t p = 0; p < n_pieces; p++ )
+                    size += string_size( pieces.at(p).name );
+                place( SECTION_PIECE_NAMES, size );
+
+                size = 0;
+                for( uint32_t c = 0; c < n_curves; c++ )
+                    size += string_size( curves.at(c).name ) + 2 * sizeof(uint32_t) + curves.at(c).vertices.size() * sizeof(uint32_t);
+                place( SECTION_CURVES, size );
+
+                size = 0;
+                for( uint32_t p = 0; p < n_pieces; p++ )
+                    size += sizeof(uint32_t) + pieces.at(p).vertices.size() * sizeof(uint32_t);
+                place( SECTION_PIECE_VERTICES, size );
+
+                    // Entry arrays are aligned in the file, so the size depends on where the section starts
+                const uint64_t start = align( offset );
+                uint64_t end = start;
+                for( const auto& it : geom_data )
+                    end = align( end + string_size( it.first ) + sizeof(uint32_t) ) + uint64_t(it.second.first ? n_faces : n_vertices) * sizeof(double);
+                place( SECTION_GEOM_DATA, end - start );
+
+                return table;
+            }
+
+            // Reads everything up to and including the section table, leaving
+            // the reader at the start of the name. Shared with BlobView.
+            template< typename Reader >
+            static void read_header( Reader& data, format_0_4& header, SECTION_TABLE& table, uint32_t& geom_data_count )
+            {
+                uint32_t fields[HEADER_FIELDS];
+                data.read( reinterpret_cast<char*>(fields), sizeof( fields ) );
+                header.n_texture_channels = fields[0];
+                header.include_2D_coords = fields[1] > 0;
+                header.n_vertices = fields[2];
+                header.n_faces = fields[3];
+                header.n_pieces = fields[4];
+                header.n_curves = fields[5];
+                geom_data_count = fields[6];
+
+                    // Newer files may append sections; only the known ones are read
+                const uint32_t section_count = fields[7];
+                if( section_count < SECTION_COUNT ){
+                    std::stringstream errout;
+                    errout << "Error Loading Blob: Section table has " << section_count << " entries, expecting at least " << SECTION_COUNT;
+                    throw BlobError::Consistency( errout.str() );
+                }
+                data.read( reinterpret_cast<char*>(table.data()), sizeof( SECTION_TABLE ) );
+                for( uint32_t s = SECTION_COUNT; s < section_count; s++ ){
+                    SECTION_ENTRY unknown;
+                    data.read( reinterpret_cast<char*>(&unknown), sizeof( SECTION_ENTRY ) );
+                }
+            }
+
+            virtual void Load( std::istream& data )
+            {
+                LoadFrom( data );
+            }
+
+            // Shared by stream and in-memory (BufferReader) decoding
+            template< typename Reader >
+            void LoadFrom( Reader& data )
+            {
+                    // Offsets in the file are relative to the version ahead of us
+                const uint64_t base = tell( data ) - FILE_OFFSET;
+                SECTION_TABLE table;
+                uint32_t geom_data_count = 0x0;
+
+                    // Read header and section table
+                {
+                    read_header( data, *this, table, geom_data_count );
+                }
+
+                    // Read name
+                {
+                    name = read_string( data );
+                }
+
+                    // Read 3D vertices
+                {
+                    seek_section( data, base, table[SECTION_VERTICES_3D] );
+                    read_array( data, vertices_3D, n_vertices );
+                    end_section( data, base, table[SECTION_VERTICES_3D] );
+                }
+
+                    // Read 2D vertices
+                {
+                    seek_section( data, base, table[SECTION_VERTICES_2D] );
+                    if( include_2D_coords ){
+                        read_array( data, vertices_2D, n_vertices );
+                    }
+                    else
+                        vertices_2D.resize(0);
+                    end_section( data, base, table[SECTION_VERTICES_2D] );
+                }
+
+                    // Read Texture Coords
+                {
+                    const SECTION_ENTRY& section = table[SECTION_TEXTURE_CHANNELS];
+                    texture_channels.clear();
+                    for( uint32_t c = 0 ; c < n_texture_channels; c++ ){
+                        seek_section( data, base, { section.offset + c * texture_channel_stride( n_vertices ), 0 } );
+                        texture_channels.emplace_back();
+                        read_array( data, texture_channels.back(), n_vertices );
+                    }
+                    if( n_texture_channels )
+                        end_section( data, base, section );
+                }
+
+                    // Read Faces
+                {
+                    seek_section( data, base, table[SECTION_FACES] );
+                    read_array( data, faces, n_faces );
+                    end_section( data, base, table[SECTION_FACES] );
+                }
+
+                    // Read Pieces (Names Only)
+                {
+                    seek_section( data, base, table[SECTION_PIECE_NAMES] );
+                    pieces.clear();
+                    for( uint32_t p = 0; p < n_pieces; p++){
+                        PIECE piece;
+                        piece.name = read_string( data );
+                        pieces.push_back( piece );
+                    }
+                    end_section( data, base, table[SECTION_PIECE_NAMES] );
+                }
+
+                    // Read Curves
+                {
+                    seek_section( data, base, table[SECTION_CURVES] );
+                    curves.clear();
+                    for( uint32_t c = 0; c < n_curves; c++ ){
+                        CURVE curve;
+                        curve.name = read_string(data);
+                        data.read( reinterpret_cast<char*>( &(curve.piece_id) ), sizeof( uint32_t ) );
+                        uint32_t curve_verts;
+                        data.read( reinterpret_cast<char*>( &curve_verts ), sizeof( uint32_t ) );
+                        read_array( data, curve.vertices, curve_verts );
+                        curves.push_back( std::move( curve ) );
+                    }
+                    end_section( data, base, table[SECTION_CURVES] );
+                }
+
+                    // Read Pieces (Vertices)
+                {
+                    seek_section( data, base, table[SECTION_PIECE_VERTICES] );
+                    for( uint32_t p = 0; p < n_pieces; p++){
+                        PIECE& piece = pieces.at(p);
+                        uint32_t piece_verts;
+                        data.read( reinterpret_cast<char*>( &piece_verts ), sizeof( uint32_t ) );
+                        read_array( data, piece.vertices, piece_verts );
+                    }
+                    end_section( data, base, table[SECTION_PIECE_VERTICES] );
+                }
+
+                    // Read Geometry Data
+                {
+                    seek_section( data, base, table[SECTION_GEOM_DATA] );
+                    geom_data.clear();
+                    for( uint32_t d = 0; d < geom_data_count; d++){
+                        std::string name = read_string( data );
+                        std::vector< double > data_array;
+                        uint32_t is_face_centric;
+                        data.read( reinterpret_cast<char*>( &is_face_centric ), sizeof( uint32_t ) );
+                        const uint64_t position = tell( data ) - base;
+                        skip( data, align( position ) - position );
+                        read_array( data, data_array, is_face_centric ? n_faces : n_vertices );
+                        auto res = geom_data.insert( {name, {is_face_centric>0, std::move( data_array )}} );
+                        if( !res.second ){
+                            std::stringstream errout;
+                            errout << "Error Loading Blob: Duplicate Geometry Data detected - '"<<name<<"' appears more than once.";
+                            throw BlobError::Consistency( errout.str() );
+                        }
+                    }
+                    end_section( data, base, table[SECTION_GEOM_DATA] );
+                }
+
+            }
+
+            // Exact number of bytes Save writes for the current contents
+            uint64_t serialized_size() const
+            {
+                const SECTION_ENTRY last = section_table()[SECTION_COUNT - 1];
+                return last.offset + last.size - FILE_OFFSET;
+            }
+
+            virtual void Save( std::ostream& data ) const
+            {
+                SaveTo( data );
+            }
+
+            // Shared by stream and in-memory (BufferWriter) encoding
+            template< typename Writer >
+            void SaveTo( Writer& data ) const
+            {
+                const SECTION_TABLE table = section_table();
+                uint64_t position = FILE_OFFSET;
+
+                    // Write header and section table
+                {
+                    uint32_t fields[HEADER_FIELDS] = { n_texture_channels,
+                                                       include_2D_coords ? 1u : 0u,
+                                                       n_vertices,
+                                                       n_faces,
+                                                       n_pieces,
+                                                       n_curves,
+                                                       static_cast<uint32_t>( geom_data.size() ),
+                                                       SECTION_COUNT,
+                                                       0x0 };
+                    data.write( reinterpret_cast<const char*>(fields), sizeof( fields ) );
+                    data.write( reinterpret_cast<const char*>(table.data()), sizeof( SECTION_TABLE ) );
+                    position += sizeof( fields ) + sizeof( SECTION_TABLE );
+                }
+
+                    // Write name
+                {
+                    write_string( data, name );
+                    position += string_size( name );
+                }
+
+                    // Write 3D vertices
+                {
+                    pad_to( data, position, table[SECTION_VERTICES_3D].offset );
+                    write_array( data, position, vertices_3D, n_vertices );
+                }
+
+                    // Write 2D vertices
+                {
+                    pad_to( data, position, table[SECTION_VERTICES_2D].offset );
+                    if( include_2D_coords )
+                        write_array( data, position, vertices_2D, n_vertices );
+                }
+
+                    // Write Texture Coords
+                {
+                    for( uint32_t c = 0 ; c < n_texture_channels; c++ ){
+                        pad_to( data, position, table[SECTION_TEXTURE_CHANNELS].offset + c * texture_channel_stride( n_vertices ) );
+                        write_array( data, position, texture_channels.at(c), n_vertices );
+                    }
+                }
+
+                    // Write Faces
+                {
+                    pad_to( data, position, table[SECTION_FACES].offset );
+                    write_array( data, position, faces, n_faces );
+                }
+
+                    // Write Pieces (Names Only)
+                {
+                    pad_to( data, position, table[SECTION_PIECE_NAMES].offset );
+                    for( uint32_t p = 0; p < n_pieces; p++)
+                        write_string( data, pieces.at(p).name );
+                    position += table[SECTION_PIECE_NAMES].size;
+                }
+
+                    // Write Curves
+                {
+                    pad_to( data, position, table[SECTION_CURVES].offset );
+                    for( uint32_t c = 0; c < n_curves; c++ ){
+                        const CURVE& curve = curves.at(c);
+                        write_string( data, curve.name );
+                        data.write( reinterpret_cast<const char*>( &(curve.piece_id) ), sizeof( uint32_t ) );
+                        uint32_t curve_verts = static_cast<uint32_t>(curve.vertices.size());
+                        data.write( reinterpret_cast<const char*>( &curve_verts ), sizeof( uint32_t ) );
+                        data.write( reinterpret_cast<const char*>( curve.vertices.data() ), sizeof( uint32_t ) * curve_verts );
+                    }
+                    position += table[SECTION_CURVES].size;
+                }
+
+                    // Write Pieces (Vertices)
+                {
+                    pad_to( data, position, table[SECTION_PIECE_VERTICES].offset );
+                    for( uint32_t p = 0; p < n_pieces; p++){
+                        const PIECE& piece = pieces.at(p);
+                        uint32_t piece_verts = static_cast<uint32_t>(piece.vertices.size());
+                        data.write( reinterpret_cast<const char*>( &piece_verts ), sizeof( uint32_t ) );
+                        data.write( reinterpret_cast<const char*>( piece.vertices.data() ), sizeof( uint32_t ) * piece_verts );
+                    }
+                    position += table[SECTION_PIECE_VERTICES].size;
+                }
+
+                    // Write Geometry Data
+                {
+                    pad_to( data, position, table[SECTION_GEOM_DATA].offset );
+                    for( const auto& it : geom_data ){
+                        write_string( data, it.first );
+                        uint32_t is_face_centric = it.second.first ? 0x1 : 0x0;
+                        data.write( reinterpret_cast<const char*>( &is_face_centric ), sizeof( uint32_t ) );
+                        position += string_size( it.first ) + sizeof( uint32_t );
+                        pad_to( data, position, align( position ) );
+                        write_array( data, position, it.second.second, is_face_centric ? n_faces : n_vertices );
+                    }
+                }
+
+            }
+
+        private:
+            template< typename Reader >
+            static void seek_section( Reader& data, uint64_t base, const SECTION_ENTRY& section )
+            {
+                const uint64_t position = tell( data ) - base;
+                if( section.offset < position ){
+                    std::stringstream errout;
+                    errout << "Error Loading Blob: Section at offset " << section.offset << " overlaps the data before it.";
+                    throw BlobError::Consistency( errout.str() );
+                }
+                skip( data, section.offset - position );
+                require( data, section.size );
+            }
+
+            template< typename Reader >
+            static void end_section( Reader& data, uint64_t base, const SECTION_ENTRY& section )
+            {
+                if( tell( data ) - base != section.offset + section.size ){
+                    std::stringstream errout;
+                    errout << "Error Loading Blob: Section at offset " << section.offset << " does not match its recorded size of " << section.size;
+                    throw BlobError::Consistency( errout.str() );
+                }
+            }
+
+            template< typename Writer >
+            static void pad_to( Writer& data, uint64_t& position, uint64_t offset )
+            {
+                static const char zeros[ALIGNMENT] = {0};
+                while( position < offset ){
+                    const uint64_t n = std::min< uint64_t >( ALIGNMENT, offset - position );
+                    data.write( zeros, n );
+                    position += n;
+                }
+            }
+
+            template< typename Writer, typename T >
+            static void write_array( Writer& data, uint64_t& position, const std::vector< T >& array, uint64_t count )
+            {
+                if( array.size() < count )
+                    throw BlobError::Consistency( "Error Saving Blob: Array is shorter than its recorded count." );
+                data.write( reinterpret_cast<const char*>( array.data() ), sizeof( T ) * count );
+                position += sizeof( T ) * count;
+            }
+        };
+    }
+}
+
+
+#endif // GEOMETRY_BLOB_FORMAT_0_4_
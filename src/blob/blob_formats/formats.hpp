@@ -14,6 +14,10 @@
 #include <unordered_set>
 #include <map>
 #include <algorithm>
+#include <type_traits>
+
+#include <blob/buffer_reader.hpp>
+#include <blob/buffer_writer.hpp>
 
 
 namespace Geometry
@@ -80,12 +84,14 @@ namespace Geometry
                 throw BlobError::IO( "Cannot perform this conversion type." );
             }
 
-            std::string read_string( std::istream& in )
+            template< typename Reader >
+            static std::string read_string( Reader& in )
             {
                 uint32_t string_len;
                 std::string str;
                 std::unique_ptr<char[]> buffer;
                 in.read( reinterpret_cast<char*>(&string_len), sizeof(uint32_t) );
+                require( in, string_len );
                 buffer = std::make_unique<char[]>(string_len+1); // Add one, as the format does not use null terminated strings...
                 memset( buffer.get(), 0, string_len+1); // Make sure our string is zeroed, for safety.
                 in.read( buffer.get(), string_len );
@@ -93,13 +99,78 @@ namespace Geometry
                 return str;
             }
 
-            void write_string( std::ostream& out, std::string data ) const
+            // Checks up front that `bytes` more bytes can be read, before
+            // allocating for them. Streams can't tell, so for those the read
+            // itself fails instead.
+            static void require( std::istream&, uint64_t )
+            {}
+
+            static void require( BufferReader& in, uint64_t bytes )
+            {
+                in.require( bytes );
+            }
+
+            // Position relative to where the reader started. Needs a seekable stream.
+            static uint64_t tell( std::istream& in )
+            {
+                const std::streamoff position = in.tellg();
+                if( position < 0 )
+                    throw BlobError::IO( "Cannot determine the position in the blob stream" );
+                return static_cast<uint64_t>( position );
+            }
+
+            static uint64_t tell( BufferReader& in )
+            {
+                return in.tellg();
+            }
+
+            static void skip( std::istream& in, uint64_t bytes )
+            {
+                if( bytes > 0 )
+                    in.ignore( static_cast<std::streamsize>( bytes ) );
+                if( static_cast<uint64_t>( in.gcount() ) != bytes && bytes > 0 )
+                    throw std::ios_base::failure( "Skipped past the end of the blob stream" );
+            }
+
+            static void skip( BufferReader& in, uint64_t bytes )
+            {
+                in.skip( bytes );
+            }
+
+            // Reads `count` consecutive fixed-size elements with bulk reads straight
+            // into `out`. From a stream the vector grows in bounded chunks, so a
+            // corrupt count runs into the end of the stream before it can force a
+            // huge allocation; from a buffer the size is checked up front.
+            template< typename Reader, typename T >
+            static void read_array( Reader& in, std::vector< T >& out, uint64_t count )
+            {
+                static_assert( std::is_trivially_copyable< T >::value, "read_array requires a trivially copyable element type" );
+                require( in, count * sizeof( T ) );
+                const uint64_t chunk = std::is_base_of< std::istream, Reader >::value ?
+                    std::max< uint64_t >( 1, ( 16u << 20 ) / sizeof( T ) ) : count;
+
+                out.clear();
+                while( out.size() < count && in ){
+                    const size_t offset = out.size();
+                    const size_t n = static_cast< size_t >( std::min< uint64_t >( chunk, count - offset ) );
+                    out.resize( offset + n );
+                    in.read( reinterpret_cast<char*>( out.data() + offset ), sizeof( T ) * n );
+                }
+            }
+
+            template< typename Writer >
+            static void write_string( Writer& out, const std::string& data )
             {
                 uint32_t string_len = static_cast<uint32_t>(data.size());
                 out.write( reinterpret_cast<char*>(&string_len), sizeof(uint32_t) );
                 out.write( data.c_str(), string_len ); // Note! This is simply the number of characters. It does not include a null terminator!
             }
 
+            static uint64_t string_size( const std::string& data )
+            {
+                return sizeof(uint32_t) + data.size();
+            }
+
             static void tokenize(std::string str, std::string del, std::vector<std::string> &token_v) 
             {
                 std::size_t start = str.find_first_not_of(del), end=start;
@@ -124,6 +195,7 @@ namespace Geometry
 #include <blob/blob_formats/format_0_1.hpp>
 #include <blob/blob_formats/format_0_2.hpp>
 #include <blob/blob_formats/format_0_3.hpp>
+#include <blob/blob_formats/format_0_4.hpp>
 
 
 #endif // GEOMETRY_BLOB_FORMATS_
@@ -0,0 +1,541 @@
+#ifndef GEOMETRY_API_BLOB_VIEW
+#define GEOMETRY_API_BLOB_VIEW
+
+#include <blob/blob.hpp>
+#include <blob/mapped_file.hpp>
+
+
+namespace Geometry
+{
+    // Read-only, lazily decoded view of a serialized blob. Opening a view reads
+    // the header and records where every section starts; a section is only
+    // decoded the first time it is accessed. The data comes from a memory
+    // mapped file, or from caller-owned memory that must outlive the view.
+    //
+    // Format 0.4 files are indexed from their section table, 0.3 files by
+    // walking over their sections once. Older files have no layout the view
+    // can index and are decoded in full on open. Lazy decoding is not
+    // synchronized: a view must not be accessed from several threads at once.
+    class BlobView
+    {
+    public:
+        typedef blob_formats::format_0_4 FORMAT;
+
+        enum Section : uint32_t
+        {
+            SECTION_VERTICES_3D      = 1 << 0,
+            SECTION_VERTICES_2D      = 1 << 1,
+            SECTION_TEXTURE_CHANNELS = 1 << 2,
+            SECTION_FACES            = 1 << 3,
+            SECTION_PIECES           = 1 << 4,
+            SECTION_CURVES           = 1 << 5,
+            SECTION_GEOM_DATA        = 1 << 6,
+
+            SECTION_GEOMETRY = SECTION_VERTICES_3D | SECTION_VERTICES_2D | SECTION_TEXTURE_CHANNELS | SECTION_FACES,
+            SECTION_ALL      = 0x7F
+        };
+
+        /*
+        *   Constructors
+        */
+
+        explicit BlobView( const std::string& path )
+            : file_( std::make_shared<MappedFile>( path ) )
+        {
+            Open( file_->data(), file_->size() );
+        }
+
+        BlobView( const char* data, uint64_t len )
+        {
+            Open( data, len );
+        }
+
+        /*
+        *   Header, available without decoding any section
+        */
+
+        uint16_t FileVersionMajor() const
+        {
+            return version_major_;
+        }
+
+        uint16_t FileVersionMinor() const
+        {
+            return version_minor_;
+        }
+
+        const std::string& Name() const
+        {
+            return decoded_.name;
+        }
+
+        uint32_t NumVertices() const
+        {
+            return decoded_.n_vertices;
+        }
+
+        uint32_t NumFaces() const
+        {
+            return decoded_.n_faces;
+        }
+
+        uint32_t NumPieces() const
+        {
+            return decoded_.n_pieces;
+        }
+
+        uint32_t NumCurves() const
+        {
+            return decoded_.n_curves;
+        }
+
+        uint32_t NumTexChannels() const
+        {
+            return decoded_.n_texture_channels;
+        }
+
+        bool Has2DCoordinates() const
+        {
+            return decoded_.include_2D_coords;
+        }
+
+        /*
+        *   Sections, decoded on first access
+        */
+
+        const FORMAT::VERTEX3D_ARRAY& Get3DVertices() const
+        {
+            Decode( SECTION_VERTICES_3D );
+            return decoded_.vertices_3D;
+        }
+
+        const FORMAT::VERTEX2D_ARRAY& Get2DVertices() const
+        {
+            Decode( SECTION_VERTICES_2D );
+            return decoded_.vertices_2D;
+        }
+
+        const FORMAT::VERTEX2D_ARRAY& GetTexChannel( uint32_t channel ) const
+        {
+            Decode( SECTION_TEXTURE_CHANNELS );
+            return decoded_.texture_channels.at( channel );
+        }
+
+        const FORMAT::TRIANGLE_ARRAY& GetFaces() const
+        {
+            Decode( SECTION_FACES );
+            return decoded_.faces;
+        }
+
+        const FORMAT::PIECE_ARRAY& GetPieces() const
+        {
+            Decode( SECTION_PIECES );
+            return decoded_.pieces;
+        }
+
+        const FORMAT::CURVE_ARRAY& GetCurves() const
+        {
+            Decode( SECTION_CURVES );
+            return decoded_.curves;
+        }
+
+        const FORMAT::GEOMETRY_DATA_MAP& GetGeomData() const
+        {
+            Decode( SECTION_GEOM_DATA );
+            return decoded_.geom_data;
+        }
+
+        /*
+        *   In-place access to the numeric arrays of format 0.4 files. These
+        *   point into the mapped data and stay valid as long as the view;
+        *   nullptr when the file has to be decoded instead.
+        */
+
+        const FORMAT::VEC3D* Mapped3DVertices() const
+        {
+            return Mapped<FORMAT::VEC3D>( offsets_.vertices_3D );
+        }
+
+        const FORMAT::VEC2D* Mapped2DVertices() const
+        {
+            return decoded_.include_2D_coords ? Mapped<FORMAT::VEC2D>( offsets_.vertices_2D ) : nullptr;
+        }
+
+        const FORMAT::VEC2D* MappedTexChannel( uint32_t channel ) const
+        {
+            if( channel >= decoded_.n_texture_channels )
+                return nullptr;
+            return Mapped<FORMAT::VEC2D>( offsets_.texture_channels + channel * texture_channel_stride_ );
+        }
+
+        const FORMAT::TRIANGLE* MappedFaces() const
+        {
+            return Mapped<FORMAT::TRIANGLE>( offsets_.faces );
+        }
+
+        // Builds a Blob holding only the requested sections; the others are
+        // left empty with their counts set to zero. 3D vertices are always
+        // included, curves bring their pieces and geometry data its faces.
+        void ToBlob( Blob& blob, uint32_t sections = SECTION_ALL ) const
+        {
+            sections |= SECTION_VERTICES_3D;
+            if( sections & SECTION_CURVES )
+                sections |= SECTION_PIECES;
+            if( sections & SECTION_GEOM_DATA )
+                sections |= SECTION_FACES;
+
+            std::unique_ptr<Blob::CURRENT_FORMAT> target = std::make_unique<Blob::CURRENT_FORMAT>();
+            CopyHeader( decoded_, *target );
+
+                // Reuse what is already decoded, decode the rest straight into the target
+            const uint32_t cached = sections & decoded_mask_;
+            CopySections( decoded_, *target, cached );
+            DecodeInto( *target, sections & ~cached );
+
+            if( !( sections & SECTION_VERTICES_2D ) ){
+                target->include_2D_coords = false;
+                target->vertices_2D.clear();
+            }
+            if( !( sections & SECTION_TEXTURE_CHANNELS ) ){
+                target->n_texture_channels = 0;
+                target->texture_channels.clear();
+            }
+            if( !( sections & SECTION_FACES ) ){
+                target->n_faces = 0;
+                target->faces.clear();
+            }
+            if( !( sections & SECTION_PIECES ) ){
+                target->n_pieces = 0;
+                target->pieces.clear();
+            }
+            if( !( sections & SECTION_CURVES ) ){
+                target->n_curves = 0;
+                target->curves.clear();
+            }
+            if( !( sections & SECTION_GEOM_DATA ) )
+                target->geom_data.clear();
+
+            target->self_check();
+            blob.blob = std::move( target );
+            blob.orig_version_major = version_major_;
+            blob.orig_version_minor = version_minor_;
+        }
+
+    private:
+        struct SectionOffsets
+        {
+            uint64_t vertices_3D = {0};
+            uint64_t vertices_2D = {0};
+            uint64_t texture_channels = {0};
+            uint64_t faces = {0};
+            uint64_t piece_names = {0};
+            uint64_t curves = {0};
+            uint64_t piece_vertices = {0};
+            uint64_t geom_data = {0};
+        };
+
+        void Open( const char* data, uint64_t len )
+        {
+            std::stringstream errout;
+            data_ = data;
+            len_ = len;
+            decoded_mask_ = 0;
+
+            try {
+                BufferReader in( data, len );
+
+                    // Read and check version
+                in.read( reinterpret_cast<char*>(&version_major_), sizeof( uint16_t ) );
+                in.read( reinterpret_cast<char*>(&version_minor_), sizeof( uint16_t ) );
+                if( version_major_ == FORMAT::version_major() &&
+                    version_minor_ == FORMAT::version_minor() ){
+                    OpenIndexed( in );
+                    return;
+                }
+                if( version_major_ != FORMAT::CAST_FROM::version_major() ||
+                    version_minor_ != FORMAT::CAST_FROM::version_minor() ){
+                        // No index for older layouts, decode everything now
+                    Blob legacy;
+                    legacy.Load( Blob::BinBuffer{ len, data } );
+                    decoded_ = std::move( *legacy.blob );
+                    decoded_mask_ = SECTION_ALL;
+                    return;
+                }
+
+                    // Header
+                uint32_t has_2d_data, reserved[2];
+                decoded_.name = FORMAT::read_string( in );
+                in.read( reinterpret_cast<char*>(&decoded_.n_texture_channels), sizeof( uint32_t ) );
+                in.read( reinterpret_cast<char*>(&has_2d_data), sizeof( uint32_t ) );
+                in.read( reinterpret_cast<char*>(reserved), sizeof( reserved ) );
+                decoded_.include_2D_coords = has_2d_data > 0;
+                in.read( reinterpret_cast<char*>(&decoded_.n_vertices), sizeof(uint32_t) );
+                in.read( reinterpret_cast<char*>(&decoded_.n_faces), sizeof(uint32_t) );
+                in.read( reinterpret_cast<char*>(&decoded_.n_pieces), sizeof(uint32_t) );
+                in.read( reinterpret_cast<char*>(&decoded_.n_curves), sizeof(uint32_t) );
+                in.read( reinterpret_cast<char*>(reserved), sizeof( reserved ) );
+
+                    // Fixed-size arrays are skipped over
+                const uint64_t n_vertices = decoded_.n_vertices;
+                texture_channel_stride_ = n_vertices * sizeof(FORMAT::VEC2D);
+                offsets_.vertices_3D = in.tellg();
+                in.skip( n_vertices * sizeof(FORMAT::VEC3D) );
+                offsets_.vertices_2D = in.tellg();
+                if( decoded_.include_2D_coords )
+                    in.skip( n_vertices * sizeof(FORMAT::VEC2D) );
+                offsets_.texture_channels = in.tellg();
+                const uint64_t channel_bytes = n_vertices * sizeof(FORMAT::VEC2D);
+                if( decoded_.n_texture_channels > 0 && channel_bytes > in.remaining() / decoded_.n_texture_channels )
+                    throw std::ios_base::failure( "Texture channels extend past the end of the blob buffer" );
+                in.skip( channel_bytes * decoded_.n_texture_channels );
+                offsets_.faces = in.tellg();
+                in.skip( uint64_t(decoded_.n_faces) * sizeof(FORMAT::TRIANGLE) );
+
+                    // Variable-length sections have to be walked
+                offsets_.piece_names = in.tellg();
+                for( uint32_t p = 0; p < decoded_.n_pieces; p++ )
+                    SkipString( in );
+
+                offsets_.curves = in.tellg();
+                for( uint32_t c = 0; c < decoded_.n_curves; c++ ){
+                    uint32_t piece_id, curve_verts;
+                    SkipString( in );
+                    in.read( reinterpret_cast<char*>(&piece_id), sizeof( uint32_t ) );
+                    in.read( reinterpret_cast<char*>(&curve_verts), sizeof( uint32_t ) );
+                    in.skip( uint64_t(curve_verts) * sizeof( uint32_t ) );
+                }
+
+                uint32_t geom_reserved[7];
+                in.read( reinterpret_cast<char*>(&geom_data_count_), sizeof( uint32_t ) );
+                in.read( reinterpret_cast<char*>(geom_reserved), sizeof( geom_reserved ) );
+
+                offsets_.piece_vertices = in.tellg();
+                for( uint32_t p = 0; p < decoded_.n_pieces; p++ ){
+                    uint32_t piece_verts;
+                    in.read( reinterpret_cast<char*>(&piece_verts), sizeof( uint32_t ) );
+                    in.skip( uint64_t(piece_verts) * sizeof( uint32_t ) );
+                }
+
+                offsets_.geom_data = in.tellg();
+                for( uint32_t d = 0; d < geom_data_count_; d++ ){
+                    uint32_t is_face_centric;
+                    SkipString( in );
+                    in.read( reinterpret_cast<char*>(&is_face_centric), sizeof( uint32_t ) );
+                    in.skip( uint64_t( is_face_centric ? decoded_.n_faces : decoded_.n_vertices ) * sizeof( double ) );
+                }
+            }
+            catch( std::ios_base::failure &fail) {
+                errout << "Failed to open Blob view: " << "Caught an ios_base::failure.\n"
+                        << "Explanatory string: " << fail.what();
+                throw BlobError::IO(errout.str());
+            }
+        }
+
+        // Format 0.4: everything is located through the section table
+        void OpenIndexed( BufferReader& in )
+        {
+            FORMAT::SECTION_TABLE table;
+            FORMAT::read_header( in, decoded_, table, geom_data_count_ );
+            decoded_.name = FORMAT::read_string( in );
+
+            for( const auto& section : table ){
+                if( section.offset > len_ || section.size > len_ - section.offset )
+                    throw std::ios_base::failure( "Blob section extends past the end of the buffer" );
+            }
+
+                // The arrays handed out in place must fit their sections
+            const uint64_t channel_size = uint64_t(decoded_.n_vertices) * sizeof(FORMAT::VEC2D);
+            texture_channel_stride_ = FORMAT::texture_channel_stride( decoded_.n_vertices );
+            RequireSection( table[FORMAT::SECTION_VERTICES_3D], 1, uint64_t(decoded_.n_vertices) * sizeof(FORMAT::VEC3D), 0, "3D vertices" );
+            if( decoded_.include_2D_coords )
+                RequireSection( table[FORMAT::SECTION_VERTICES_2D], 1, channel_size, 0, "2D vertices" );
+            RequireSection( table[FORMAT::SECTION_TEXTURE_CHANNELS], decoded_.n_texture_channels, channel_size, texture_channel_stride_, "Texture channels" );
+            RequireSection( table[FORMAT::SECTION_FACES], 1, uint64_t(decoded_.n_faces) * sizeof(FORMAT::TRIANGLE), 0, "Faces" );
+
+            offsets_.vertices_3D = table[FORMAT::SECTION_VERTICES_3D].offset;
+            offsets_.vertices_2D = table[FORMAT::SECTION_VERTICES_2D].offset;
+            offsets_.texture_channels = table[FORMAT::SECTION_TEXTURE_CHANNELS].offset;
+            offsets_.faces = table[FORMAT::SECTION_FACES].offset;
+            offsets_.piece_names = table[FORMAT::SECTION_PIECE_NAMES].offset;
+            offsets_.curves = table[FORMAT::SECTION_CURVES].offset;
+            offsets_.piece_vertices = table[FORMAT::SECTION_PIECE_VERTICES].offset;
+            offsets_.geom_data = table[FORMAT::SECTION_GEOM_DATA].offset;
+            geom_data_alignment_ = FORMAT::ALIGNMENT;
+            in_place_ = true;
+        }
+
+        // Throws unless `count` arrays of `array_size` bytes, each starting
+        // `stride` bytes after the previous one, fit in the section
+        static void RequireSection( const FORMAT::SECTION_ENTRY& section, uint64_t count, uint64_t array_size,
+                                    uint64_t stride, const char* what )
+        {
+            if( count == 0 || array_size == 0 )
+                return;
+            if( array_size > section.size ||
+                ( count > 1 && ( stride == 0 || count - 1 > ( section.size - array_size ) / stride ) ) )
+                throw std::ios_base::failure( std::string( what ) + " extend past their section" );
+        }
+
+        // Arrays can only be used in place from an aligned 0.4 layout
+        template< typename T >
+        const T* Mapped( uint64_t offset ) const
+        {
+            if( !in_place_ || reinterpret_cast<uintptr_t>( data_ + offset ) % alignof( T ) != 0 )
+                return nullptr;
+            return reinterpret_cast<const T*>( data_ + offset );
+        }
+
+        static void SkipString( BufferReader& in )
+        {
+            uint32_t string_len;
+            in.read( reinterpret_cast<char*>(&string_len), sizeof( uint32_t ) );
+            in.skip( string_len );
+        }
+
+        BufferReader ReaderAt( uint64_t offset ) const
+        {
+            return BufferReader( data_ + offset, len_ - offset );
+        }
+
+        void Decode( uint32_t sections ) const
+        {
+            if( sections & SECTION_CURVES )
+                sections |= SECTION_PIECES;
+            const uint32_t missing = sections & ~decoded_mask_;
+            if( missing ){
+                DecodeInto( decoded_, missing );
+                decoded_mask_ |= missing;
+            }
+        }
+
+        // Decodes the given sections from the buffer, using the offsets
+        // recorded on open
+        template< typename TARGET_FORMAT >
+        void DecodeInto( TARGET_FORMAT& target, uint32_t sections ) const
+        {
+            std::stringstream errout;
+            const uint32_t n_vertices = decoded_.n_vertices;
+
+            try {
+                if( sections & SECTION_VERTICES_3D ){
+                    BufferReader in = ReaderAt( offsets_.vertices_3D );
+                    FORMAT::read_array( in, target.vertices_3D, n_vertices );
+                }
+
+                if( ( sections & SECTION_VERTICES_2D ) && decoded_.include_2D_coords ){
+                    BufferReader in = ReaderAt( offsets_.vertices_2D );
+                    FORMAT::read_array( in, target.vertices_2D, n_vertices );
+                }
+
+                if( sections & SECTION_TEXTURE_CHANNELS ){
+                    target.texture_channels.resize( decoded_.n_texture_channels );
+                    for( uint32_t c = 0; c < decoded_.n_texture_channels; c++ ){
+                        BufferReader in = ReaderAt( offsets_.texture_channels + c * texture_channel_stride_ );
+                        FORMAT::read_array( in, target.texture_channels[c], n_vertices );
+                    }
+                }
+
+                if( sections & SECTION_FACES ){
+                    BufferReader in = ReaderAt( offsets_.faces );
+                    FORMAT::read_array( in, target.faces, decoded_.n_faces );
+                }
+
+                if( sections & SECTION_PIECES ){
+                    BufferReader names = ReaderAt( offsets_.piece_names );
+                    BufferReader vertices = ReaderAt( offsets_.piece_vertices );
+                    target.pieces.resize( decoded_.n_pieces );
+                    for( auto& piece : target.pieces ){
+                        uint32_t piece_verts;
+                        piece.name = FORMAT::read_string( names );
+                        vertices.read( reinterpret_cast<char*>(&piece_verts), sizeof( uint32_t ) );
+                        FORMAT::read_array( vertices, piece.vertices, piece_verts );
+                    }
+                }
+
+                if( sections & SECTION_CURVES ){
+                    BufferReader in = ReaderAt( offsets_.curves );
+                    target.curves.resize( decoded_.n_curves );
+                    for( auto& curve : target.curves ){
+                        uint32_t curve_verts;
+                        curve.name = FORMAT::read_string( in );
+                        in.read( reinterpret_cast<char*>(&curve.piece_id), sizeof( uint32_t ) );
+                        in.read( reinterpret_cast<char*>(&curve_verts), sizeof( uint32_t ) );
+                        FORMAT::read_array( in, curve.vertices, curve_verts );
+                    }
+                }
+
+                if( sections & SECTION_GEOM_DATA ){
+                    BufferReader in = ReaderAt( offsets_.geom_data );
+                    for( uint32_t d = 0; d < geom_data_count_; d++ ){
+                        std::string name = FORMAT::read_string( in );
+                        std::vector< double > data_array;
+                        uint32_t is_face_centric;
+                        in.read( reinterpret_cast<char*>(&is_face_centric), sizeof( uint32_t ) );
+                        const uint64_t position = offsets_.geom_data + in.tellg();
+                        in.skip( ( geom_data_alignment_ - position % geom_data_alignment_ ) % geom_data_alignment_ );
+                        FORMAT::read_array( in, data_array, is_face_centric ? decoded_.n_faces : n_vertices );
+                        auto res = target.geom_data.insert( {name, {is_face_centric>0, std::move( data_array )}} );
+                        if( !res.second ){
+                            errout << "Error Loading Blob: Duplicate Geometry Data detected - '"<<name<<"' appears more than once.";
+                            throw BlobError::Consistency( errout.str() );
+                        }
+                    }
+                }
+            }
+            catch( std::ios_base::failure &fail) {
+                errout << "Failed to read Blob view: " << "Caught an ios_base::failure.\n"
+                        << "Explanatory string: " << fail.what();
+                throw BlobError::IO(errout.str());
+            }
+        }
+
+        template< typename SOURCE_FORMAT, typename TARGET_FORMAT >
+        static void CopyHeader( const SOURCE_FORMAT& source, TARGET_FORMAT& target )
+        {
+            target.name = source.name;
+            target.n_texture_channels = source.n_texture_channels;
+            target.include_2D_coords = source.include_2D_coords;
+            target.n_vertices = source.n_vertices;
+            target.n_faces = source.n_faces;
+            target.n_pieces = source.n_pieces;
+            target.n_curves = source.n_curves;
+        }
+
+        template< typename SOURCE_FORMAT, typename TARGET_FORMAT >
+        static void CopySections( const SOURCE_FORMAT& source, TARGET_FORMAT& target, uint32_t sections )
+        {
+            if( sections & SECTION_VERTICES_3D )
+                target.vertices_3D = source.vertices_3D;
+            if( sections & SECTION_VERTICES_2D )
+                target.vertices_2D = source.vertices_2D;
+            if( sections & SECTION_TEXTURE_CHANNELS )
+                target.texture_channels = source.texture_channels;
+            if( sections & SECTION_FACES )
+                target.faces = source.faces;
+            if( sections & SECTION_PIECES )
+                target.pieces = source.pieces;
+            if( sections & SECTION_CURVES )
+                target.curves = source.curves;
+            if( sections & SECTION_GEOM_DATA )
+                target.geom_data = source.geom_data;
+        }
+
+        std::shared_ptr<MappedFile> file_;
+        const char* data_;
+        uint64_t len_;
+
+        uint16_t version_major_ = {0};
+        uint16_t version_minor_ = {0};
+        SectionOffsets offsets_;
+        uint32_t geom_data_count_ = {0};
+        uint64_t texture_channel_stride_ = {0};
+        uint64_t geom_data_alignment_ = {1};
+        bool in_place_ = {false};
+
+            // Header fields are filled on open, sections as they are decoded
+        mutable FORMAT decoded_;
+        mutable uint32_t decoded_mask_;
+    };
+}
+
+#endif // GEOMETRY_API_BLOB_VIEW
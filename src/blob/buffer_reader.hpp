@@ -0,0 +1,70 @@
+#ifndef GEOMETRY_BLOB_BUFFER_READER_
+#define GEOMETRY_BLOB_BUFFER_READER_
+
+#include <ios>
+#include <cstdint>
+#include <cstring>
+
+
+namespace Geometry
+{
+    // Bounded read cursor over a block of memory. Mirrors the subset of the
+    // std::istream interface the blob formats use, so they can decode straight
+    // from a BinBuffer / BinBlob without copying it into a stream first.
+    // Reading past the end throws std::ios_base::failure, like a stream with
+    // exceptions enabled.
+    class BufferReader
+    {
+    public:
+        BufferReader( const char* data, uint64_t len )
+            : data_( data ),
+              len_( len ),
+              pos_( 0 )
+        {}
+
+        BufferReader& read( char* out, std::streamsize count )
+        {
+            require( static_cast<uint64_t>( count ) );
+            std::memcpy( out, data_ + pos_, static_cast<size_t>( count ) );
+            pos_ += static_cast<uint64_t>( count );
+            return *this;
+        }
+
+        BufferReader& skip( uint64_t count )
+        {
+            require( count );
+            pos_ += count;
+            return *this;
+        }
+
+        // Throws unless at least `count` more bytes are available
+        void require( uint64_t count ) const
+        {
+            if( count > len_ - pos_ )
+                throw std::ios_base::failure( "Read past the end of the blob buffer" );
+        }
+
+        uint64_t tellg() const
+        {
+            return pos_;
+        }
+
+        uint64_t remaining() const
+        {
+            return len_ - pos_;
+        }
+
+        // Failures throw, so a reader that is still usable is always good
+        explicit operator bool() const
+        {
+            return true;
+        }
+
+    private:
+        const char* data_;
+        uint64_t len_;
+        uint64_t pos_;
+    };
+}
+
+#endif // GEOMETRY_BLOB_BUFFER_READER_
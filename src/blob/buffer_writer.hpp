@@ -0,0 +1,44 @@
+#ifndef GEOMETRY_BLOB_BUFFER_WRITER_
+#define GEOMETRY_BLOB_BUFFER_WRITER_
+
+#include <ios>
+#include <cstdint>
+#include <cstring>
+
+
+namespace Geometry
+{
+    // Bounded write cursor over caller-owned memory, the counterpart of
+    // BufferReader. Writing past the end throws std::ios_base::failure,
+    // like a stream with exceptions enabled.
+    class BufferWriter
+    {
+    public:
+        BufferWriter( char* data, uint64_t len )
+            : data_( data ),
+              len_( len ),
+              pos_( 0 )
+        {}
+
+        BufferWriter& write( const char* in, std::streamsize count )
+        {
+            if( static_cast<uint64_t>( count ) > len_ - pos_ )
+                throw std::ios_base::failure( "Write past the end of the blob buffer" );
+            std::memcpy( data_ + pos_, in, static_cast<size_t>( count ) );
+            pos_ += static_cast<uint64_t>( count );
+            return *this;
+        }
+
+        uint64_t tellp() const
+        {
+            return pos_;
+        }
+
+    private:
+        char* data_;
+        uint64_t len_;
+        uint64_t pos_;
+    };
+}
+
+#endif // GEOMETRY_BLOB_BUFFER_WRITER_
@@ -0,0 +1,160 @@
+#ifndef GEOMETRY_BLOB_CONTENT_HASH_
+#define GEOMETRY_BLOB_CONTENT_HASH_
+
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+
+
+namespace Geometry
+{
+    // Streaming 64 bit XXH64 hash, for telling blob contents apart without
+    // keeping a copy of them around. Not a cryptographic hash.
+    class ContentHash
+    {
+    public:
+        explicit ContentHash( uint64_t seed = 0 )
+            : seed_( seed ),
+              total_len_( 0 ),
+              buffered_( 0 )
+        {
+            acc_[0] = seed + PRIME_1 + PRIME_2;
+            acc_[1] = seed + PRIME_2;
+            acc_[2] = seed;
+            acc_[3] = seed - PRIME_1;
+        }
+
+        ContentHash& Update( const void* data, size_t len )
+        {
+            const unsigned char* input = static_cast<const unsigned char*>( data );
+            total_len_ += len;
+
+            if( buffered_ + len < STRIPE ){
+                std::memcpy( buffer_ + buffered_, input, len );
+                buffered_ += len;
+                return *this;
+            }
+
+            if( buffered_ ){
+                const size_t fill = STRIPE - buffered_;
+                std::memcpy( buffer_ + buffered_, input, fill );
+                consume_stripe( buffer_ );
+                input += fill;
+                len -= fill;
+                buffered_ = 0;
+            }
+
+            for( ; len >= STRIPE; input += STRIPE, len -= STRIPE )
+                consume_stripe( input );
+
+            std::memcpy( buffer_, input, len );
+            buffered_ = len;
+            return *this;
+        }
+
+        template< typename T >
+        ContentHash& UpdateValue( const T& value )
+        {
+            return Update( &value, sizeof(T) );
+        }
+
+        uint64_t Digest() const
+        {
+            uint64_t hash;
+            if( total_len_ >= STRIPE ){
+                hash = rotl( acc_[0], 1 ) + rotl( acc_[1], 7 ) + rotl( acc_[2], 12 ) + rotl( acc_[3], 18 );
+                for( int lane = 0; lane < 4; ++lane )
+                    hash = ( hash ^ round( 0, acc_[lane] ) ) * PRIME_1 + PRIME_4;
+            }
+            else
+                hash = seed_ + PRIME_5;
+
+            hash += total_len_;
+
+            const unsigned char* tail = buffer_;
+            size_t len = buffered_;
+            for( ; len >= 8; tail += 8, len -= 8 )
+                hash = rotl( hash ^ round( 0, read64( tail ) ), 27 ) * PRIME_1 + PRIME_4;
+            if( len >= 4 ){
+                hash = rotl( hash ^ ( uint64_t( read32( tail ) ) * PRIME_1 ), 23 ) * PRIME_2 + PRIME_3;
+                tail += 4;
+                len -= 4;
+            }
+            for( ; len; ++tail, --len )
+                hash = rotl( hash ^ ( uint64_t( *tail ) * PRIME_5 ), 11 ) * PRIME_1;
+
+            hash ^= hash >> 33;
+            hash *= PRIME_2;
+            hash ^= hash >> 29;
+            hash *= PRIME_3;
+            hash ^= hash >> 32;
+            return hash;
+        }
+
+    private:
+        static const uint64_t PRIME_1 = 0x9E3779B185EBCA87ULL;
+        static const uint64_t PRIME_2 = 0xC2B2AE3D27D4EB4FULL;
+        static const uint64_t PRIME_3 = 0x165667B19E3779F9ULL;
+        static const uint64_t PRIME_4 = 0x85EBCA77C2B2AE63ULL;
+        static const uint64_t PRIME_5 = 0x27D4EB2F165667C5ULL;
+        enum : size_t { STRIPE = 32 };
+
+        static uint64_t rotl( uint64_t value, int bits )
+        {
+            return ( value << bits ) | ( value >> ( 64 - bits ) );
+        }
+
+        static uint64_t read64( const unsigned char* data )
+        {
+            uint64_t value;
+            std::memcpy( &value, data, sizeof(value) );
+            return value;
+        }
+
+        static uint32_t read32( const unsigned char* data )
+        {
+            uint32_t value;
+            std::memcpy( &value, data, sizeof(value) );
+            return value;
+        }
+
+        static uint64_t round( uint64_t acc, uint64_t input )
+        {
+            acc += input * PRIME_2;
+            acc = rotl( acc, 31 );
+            return acc * PRIME_1;
+        }
+
+        void consume_stripe( const unsigned char* stripe )
+        {
+            for( int lane = 0; lane < 4; ++lane )
+                acc_[lane] = round( acc_[lane], read64( stripe + 8 * lane ) );
+        }
+
+        uint64_t seed_;
+        uint64_t acc_[4];
+        uint64_t total_len_;
+        unsigned char buffer_[STRIPE];
+        size_t buffered_;
+    };
+
+    // 128 bit key, as 32 hex digits: feed is called with two differently
+    // seeded hashes and updates both with the same contents
+    template< typename Feed >
+    std::string ContentKey( Feed feed )
+    {
+        uint64_t digests[2];
+        for( int i = 0; i < 2; ++i ){
+            ContentHash hash( i );
+            feed( hash );
+            digests[i] = hash.Digest();
+        }
+        char key[33];
+        snprintf( key, sizeof(key), "%016llx%016llx", (unsigned long long) digests[0], (unsigned long long) digests[1] );
+        return key;
+    }
+}
+
+#endif // GEOMETRY_BLOB_CONTENT_HASH_
@@ -0,0 +1,127 @@
+#ifndef GEOMETRY_BLOB_MAPPED_FILE_
+#define GEOMETRY_BLOB_MAPPED_FILE_
+
+#include <string>
+#include <stdexcept>
+#include <cstdint>
+
+#if defined(PLATFORM_WINDOWS)
+#define WIN32_LEAN_AND_MEAN
+#define VC_EXTRALEAN
+#include <windows.h>
+#elif defined(PLATFORM_LINUX) || defined(PLATFORM_OSX)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#error Please implement the memory mapped file functions for your system
+#endif
+
+
+namespace Geometry
+{
+    // Copy-on-write memory mapping of a whole file. Pages are only read from
+    // disk once they are touched, so sections of a blob that are never
+    // accessed cost no I/O. Pages written to are copied first, the file
+    // itself never changes.
+    class MappedFile
+    {
+    public:
+        explicit MappedFile( const std::string& path )
+            : data_( nullptr ),
+              size_( 0 )
+        {
+#if defined(PLATFORM_WINDOWS)
+            file_ = ::CreateFileA( path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                                   OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+            if( file_ == INVALID_HANDLE_VALUE )
+                throw std::runtime_error( "Could not open file " + path );
+
+            LARGE_INTEGER file_size;
+            if( !::GetFileSizeEx( file_, &file_size ) ){
+                ::CloseHandle( file_ );
+                throw std::runtime_error( "Could not read the size of file " + path );
+            }
+            size_ = static_cast<uint64_t>( file_size.QuadPart );
+
+            mapping_ = NULL;
+            if( size_ > 0 ){
+                mapping_ = ::CreateFileMappingA( file_, NULL, PAGE_WRITECOPY, 0, 0, NULL );
+                if( mapping_ != NULL )
+                    data_ = static_cast<char*>( ::MapViewOfFile( mapping_, FILE_MAP_COPY, 0, 0, 0 ) );
+                if( data_ == nullptr ){
+                    if( mapping_ != NULL )
+                        ::CloseHandle( mapping_ );
+                    ::CloseHandle( file_ );
+                    throw std::runtime_error( "Could not map file " + path );
+                }
+            }
+#else
+            int fd = ::open( path.c_str(), O_RDONLY );
+            if( fd < 0 )
+                throw std::runtime_error( "Could not open file " + path );
+
+            struct stat file_info;
+            if( ::fstat( fd, &file_info ) != 0 ){
+                ::close( fd );
+                throw std::runtime_error( "Could not read the size of file " + path );
+            }
+            size_ = static_cast<uint64_t>( file_info.st_size );
+
+            if( size_ > 0 ){
+                void* mapped = ::mmap( nullptr, static_cast<size_t>( size_ ), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0 );
+                if( mapped == MAP_FAILED ){
+                    ::close( fd );
+                    throw std::runtime_error( "Could not map file " + path );
+                }
+                data_ = static_cast<char*>( mapped );
+            }
+                // The mapping stays valid after the descriptor is closed
+            ::close( fd );
+#endif
+        }
+
+        ~MappedFile()
+        {
+#if defined(PLATFORM_WINDOWS)
+            if( data_ )
+                ::UnmapViewOfFile( data_ );
+            if( mapping_ != NULL )
+                ::CloseHandle( mapping_ );
+            ::CloseHandle( file_ );
+#else
+            if( data_ )
+                ::munmap( data_, static_cast<size_t>( size_ ) );
+#endif
+        }
+
+        MappedFile( const MappedFile& ) = delete;
+        MappedFile& operator=( const MappedFile& ) = delete;
+
+        const char* data() const
+        {
+            return data_;
+        }
+
+        char* data()
+        {
+            return data_;
+        }
+
+        uint64_t size() const
+        {
+            return size_;
+        }
+
+    private:
+        char* data_;
+        uint64_t size_;
+#if defined(PLATFORM_WINDOWS)
+        HANDLE file_;
+        HANDLE mapping_;
+#endif
+    };
+}
+
+#endif // GEOMETRY_BLOB_MAPPED_FILE_
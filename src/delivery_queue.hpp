@@ -0,0 +1,131 @@
+#ifndef DELIVERY_QUEUE_HPP_
+#define DELIVERY_QUEUE_HPP_
+
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+
+// What a full DeliveryQueue does with a new value
+enum class DeliveryPolicy
+{
+    Block,          // the producer waits for the consumer
+    DropOldest,     // the oldest droppable value makes room
+    Latest          // every droppable value replaces the pending one
+};
+
+// Bounded queue of values on their way to a slower consumer, with
+// counters for its depth and for what the policy dropped. Values pushed as
+// not droppable are always queued, whatever the policy; they may take the
+// queue past its capacity. Safe for one producer and any number of
+// consumers.
+template< typename T >
+class DeliveryQueue
+{
+public:
+    enum PushResult
+    {
+        PUSHED,         // queued, one more value to pop
+        REPLACED,       // queued in place of a dropped value
+        DROPPED         // the pushed value itself was dropped
+    };
+
+    DeliveryQueue( std::size_t capacity, DeliveryPolicy policy ) :
+        capacity_( capacity < 1 ? 1 : capacity ),
+        policy_( policy ),
+        dropped_( 0 ),
+        closed_( false )
+    {}
+
+    DeliveryQueue( const DeliveryQueue& ) = delete;
+    DeliveryQueue& operator=( const DeliveryQueue& ) = delete;
+
+    PushResult Push( T&& value, bool droppable )
+    {
+        std::unique_lock<std::mutex> lock( mutex_ );
+        if( policy_ == DeliveryPolicy::Block || !droppable ){
+            if( policy_ == DeliveryPolicy::Block )
+                space_.wait( lock, [&]{ return closed_ || items_.size() < capacity_; } );
+            items_.emplace_back( std::move( value ), droppable );
+            return PUSHED;
+        }
+
+        if( policy_ == DeliveryPolicy::DropOldest && items_.size() < capacity_ ){
+            items_.emplace_back( std::move( value ), droppable );
+            return PUSHED;
+        }
+
+        for( auto it = items_.begin(); it != items_.end(); ++it ){
+            if( it->second ){
+                items_.erase( it );
+                items_.emplace_back( std::move( value ), droppable );
+                ++dropped_;
+                return REPLACED;
+            }
+        }
+
+        // Nothing queued may be dropped
+        if( policy_ == DeliveryPolicy::Latest ){
+            items_.emplace_back( std::move( value ), droppable );
+            return PUSHED;
+        }
+        ++dropped_;
+        return DROPPED;
+    }
+
+    // Returns false if the queue is empty
+    bool TryPop( T& value )
+    {
+        {
+            std::lock_guard<std::mutex> lock( mutex_ );
+            if( items_.empty() )
+                return false;
+            value = std::move( items_.front().first );
+            items_.pop_front();
+        }
+        space_.notify_one();
+        return true;
+    }
+
+    // Stops Push from waiting for space, for shutting down a producer that
+    // may be blocked on a consumer that is going away
+    void Close()
+    {
+        {
+            std::lock_guard<std::mutex> lock( mutex_ );
+            closed_ = true;
+        }
+        space_.notify_all();
+    }
+
+    std::size_t Depth() const
+    {
+        std::lock_guard<std::mutex> lock( mutex_ );
+        return items_.size();
+    }
+
+    uint64_t Dropped() const
+    {
+        std::lock_guard<std::mutex> lock( mutex_ );
+        return dropped_;
+    }
+
+    DeliveryPolicy Policy() const { return policy_; }
+    std::size_t Capacity() const { return capacity_; }
+
+private:
+    const std::size_t capacity_;
+    const DeliveryPolicy policy_;
+    // Values with whether they may be dropped
+    std::deque< std::pair<T, bool> > items_;
+    uint64_t dropped_;
+    bool closed_;
+    mutable std::mutex mutex_;
+    std::condition_variable space_;
+};
+
+#endif
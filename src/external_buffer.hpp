@@ -0,0 +1,54 @@
+#ifndef EXTERNAL_BUFFER_HPP_
+#define EXTERNAL_BUFFER_HPP_
+
+#pragma once
+
+#include <napi.h>
+#include <translation/flatbuffer_utils.hpp>
+#include <blob/mapped_file.hpp>
+
+#include <memory>
+#include <vector>
+
+// Packed buffers waiting to cross into JS. Shared so they can be captured by
+// the (copyable) ThreadSafeCallback functor while staying move-only.
+typedef std::shared_ptr< std::vector<PackedBuffer> > PackedBufferList;
+
+// Hands a packed buffer over to JS without copying it: the returned array
+// views the buffer's memory through an external ArrayBuffer, and the buffer
+// is released by the finalizer once JS has dropped the last reference.
+inline Napi::Uint8Array ToExternalByteArray( Napi::Env env, PackedBuffer&& buffer )
+{
+    if( !buffer.data() || buffer.size() == 0 )
+        return Napi::Uint8Array::New( env, 0 );
+
+    std::unique_ptr<PackedBuffer> owned( new PackedBuffer( std::move(buffer) ) );
+    const size_t size = owned->size();
+    Napi::ArrayBuffer array_buffer = Napi::ArrayBuffer::New( env, owned->data(), size,
+                                                             [](Napi::Env, void*, PackedBuffer* hint){
+                                                                 delete hint;
+                                                             },
+                                                             owned.get() );
+    // The finalizer owns the buffer from here on
+    owned.release();
+    return Napi::Uint8Array::New( env, size, array_buffer, 0 );
+}
+
+// Same for a mapped file, which is unmapped by the finalizer. JS may write
+// to the array, the mapping copies the pages it changes.
+inline Napi::Uint8Array ToExternalByteArray( Napi::Env env, std::unique_ptr<Geometry::MappedFile>&& file )
+{
+    if( !file || file->size() == 0 )
+        return Napi::Uint8Array::New( env, 0 );
+
+    const size_t size = static_cast<size_t>( file->size() );
+    Napi::ArrayBuffer array_buffer = Napi::ArrayBuffer::New( env, file->data(), size,
+                                                             [](Napi::Env, void*, Geometry::MappedFile* hint){
+                                                                 delete hint;
+                                                             },
+                                                             file.get() );
+    file.release();
+    return Napi::Uint8Array::New( env, size, array_buffer, 0 );
+}
+
+#endif
@@ -0,0 +1,184 @@
+#ifndef FRAME_RING_HPP_
+#define FRAME_RING_HPP_
+
+#pragma once
+
+#include <atomic>
+#include <stdexcept>
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+
+// Writes session status and garment positions into memory shared with JS
+// (a SharedArrayBuffer), where any thread can read them with Atomics and
+// without going through the event loop. FrameRingReader in src/index.js is
+// the reading side; both must agree on the layout below.
+//
+// Header, HEADER_SIZE bytes of int32 words:
+//   MAGIC, VERSION, slots, max_vertices, max_garments, slot_size,
+//   frames written, incomplete frames, status sequence, status type,
+//   state, frame, steps, padding, time (float64)
+// followed by `slots` slots of slot_size bytes, each holding:
+//   sequence, type, frame, steps, time (float64), garment count,
+//   vertex count, flags, padding,
+//   max_garments entries of { handle, first vertex, vertex count, padding },
+//   max_vertices xyz float32 positions.
+//
+// Status and slots are seqlocks: the sequence is odd while being written,
+// so a reader retries when it changes or is odd. Frames go to the slots in
+// turn, readers use the most recent one. There must only be one thread
+// writing the status, and one writing frames.
+class FrameRingWriter
+{
+public:
+    enum : uint32_t {
+        MAGIC = 0x41524652,
+        VERSION = 1,
+        HEADER_SIZE = 64,
+        SLOT_HEADER_SIZE = 48,
+        GARMENT_ENTRY_SIZE = 16,
+        SLOT_ALIGNMENT = 64,
+        FLAG_INCOMPLETE = 1
+    };
+
+    static size_t SlotSize( uint32_t max_vertices, uint32_t max_garments )
+    {
+        const size_t size = SLOT_HEADER_SIZE + size_t( max_garments ) * GARMENT_ENTRY_SIZE + size_t( max_vertices ) * 3 * sizeof(float);
+        return ( size + SLOT_ALIGNMENT - 1 ) / SLOT_ALIGNMENT * SLOT_ALIGNMENT;
+    }
+
+    static size_t ByteLength( uint32_t slots, uint32_t max_vertices, uint32_t max_garments )
+    {
+        return HEADER_SIZE + size_t( slots ) * SlotSize( max_vertices, max_garments );
+    }
+
+    // The memory must stay valid for as long as the writer is used
+    FrameRingWriter( char* data, size_t size, uint32_t slots, uint32_t max_vertices, uint32_t max_garments ) :
+        data_( data ),
+        slots_( slots ),
+        max_vertices_( max_vertices ),
+        max_garments_( max_garments ),
+        slot_size_( SlotSize( max_vertices, max_garments ) ),
+        frames_( 0 ),
+        slot_( nullptr )
+    {
+        if( slots == 0 )
+            throw std::invalid_argument( "A frame ring needs at least one slot" );
+        if( size < ByteLength( slots, max_vertices, max_garments ) )
+            throw std::invalid_argument( "Frame ring buffer is too small for its slots" );
+        if( reinterpret_cast<uintptr_t>( data ) % sizeof(double) != 0 )
+            throw std::invalid_argument( "Frame ring buffer is not aligned" );
+
+        std::memset( data_, 0, ByteLength( slots, max_vertices, max_garments ) );
+        const int32_t header[] = { int32_t( MAGIC ), int32_t( VERSION ), int32_t( slots ), int32_t( max_vertices ),
+                                   int32_t( max_garments ), int32_t( slot_size_ ) };
+        std::memcpy( data_, header, sizeof(header) );
+    }
+
+    FrameRingWriter( const FrameRingWriter& ) = delete;
+    FrameRingWriter& operator=( const FrameRingWriter& ) = delete;
+
+    void WriteStatus( int32_t type, int32_t state, int32_t frame, int32_t steps, double time )
+    {
+        std::atomic<int32_t>& sequence = Word( data_, STATUS_SEQUENCE );
+        const int32_t value = sequence.load( std::memory_order_relaxed );
+        sequence.store( value + 1, std::memory_order_relaxed );
+        std::atomic_thread_fence( std::memory_order_release );
+
+        const int32_t status[] = { type, state, frame, steps };
+        std::memcpy( data_ + STATUS_TYPE, status, sizeof(status) );
+        std::memcpy( data_ + STATUS_TIME, &time, sizeof(time) );
+
+        sequence.store( value + 2, std::memory_order_release );
+    }
+
+    // Starts writing a frame into the next slot, to be filled with
+    // AddGarment and published with EndFrame
+    void BeginFrame( int32_t type, int32_t frame, int32_t steps, double time )
+    {
+        slot_ = data_ + HEADER_SIZE + size_t( frames_ % slots_ ) * slot_size_;
+        std::atomic<int32_t>& sequence = Word( slot_, SLOT_SEQUENCE );
+        slot_sequence_ = sequence.load( std::memory_order_relaxed );
+        sequence.store( slot_sequence_ + 1, std::memory_order_relaxed );
+        std::atomic_thread_fence( std::memory_order_release );
+
+        const int32_t info[] = { type, frame, steps };
+        std::memcpy( slot_ + SLOT_TYPE, info, sizeof(info) );
+        std::memcpy( slot_ + SLOT_TIME, &time, sizeof(time) );
+        garments_ = 0;
+        vertices_ = 0;
+        flags_ = 0;
+    }
+
+    // Garments that don't fit the slot mark the frame incomplete
+    void AddGarment( int32_t handle, const float* positions, uint32_t n_vertices )
+    {
+        if( garments_ >= max_garments_ || n_vertices > max_vertices_ - vertices_ ){
+            flags_ |= FLAG_INCOMPLETE;
+            return;
+        }
+        const int32_t entry[] = { handle, int32_t( vertices_ ), int32_t( n_vertices ), 0 };
+        std::memcpy( slot_ + SLOT_HEADER_SIZE + size_t( garments_ ) * GARMENT_ENTRY_SIZE, entry, sizeof(entry) );
+        if( n_vertices )
+            std::memcpy( slot_ + PositionsOffset() + size_t( vertices_ ) * 3 * sizeof(float), positions, size_t( n_vertices ) * 3 * sizeof(float) );
+        garments_++;
+        vertices_ += n_vertices;
+    }
+
+    void EndFrame( bool complete = true )
+    {
+        if( !complete )
+            flags_ |= FLAG_INCOMPLETE;
+        const int32_t counts[] = { int32_t( garments_ ), int32_t( vertices_ ), int32_t( flags_ ) };
+        std::memcpy( slot_ + SLOT_GARMENTS, counts, sizeof(counts) );
+        Word( slot_, SLOT_SEQUENCE ).store( slot_sequence_ + 2, std::memory_order_release );
+
+        if( flags_ & FLAG_INCOMPLETE )
+            Word( data_, INCOMPLETE_FRAMES ).fetch_add( 1, std::memory_order_relaxed );
+        Word( data_, FRAMES_WRITTEN ).store( int32_t( ++frames_ ), std::memory_order_release );
+        slot_ = nullptr;
+    }
+
+private:
+    // Byte offsets of the header and slot fields
+    enum : size_t {
+        FRAMES_WRITTEN = 24,
+        INCOMPLETE_FRAMES = 28,
+        STATUS_SEQUENCE = 32,
+        STATUS_TYPE = 36,
+        STATUS_TIME = 56,
+        SLOT_SEQUENCE = 0,
+        SLOT_TYPE = 4,
+        SLOT_TIME = 16,
+        SLOT_GARMENTS = 24
+    };
+
+    static_assert( sizeof(std::atomic<int32_t>) == sizeof(int32_t) && ATOMIC_INT_LOCK_FREE == 2,
+                   "Shared memory words need lock free 32 bit atomics" );
+
+    static std::atomic<int32_t>& Word( char* base, size_t offset )
+    {
+        return *reinterpret_cast<std::atomic<int32_t>*>( base + offset );
+    }
+
+    size_t PositionsOffset() const
+    {
+        return SLOT_HEADER_SIZE + size_t( max_garments_ ) * GARMENT_ENTRY_SIZE;
+    }
+
+    char* data_;
+    const uint32_t slots_;
+    const uint32_t max_vertices_;
+    const uint32_t max_garments_;
+    const size_t slot_size_;
+    uint32_t frames_;
+
+    // The frame being written
+    char* slot_;
+    int32_t slot_sequence_;
+    uint32_t garments_;
+    uint32_t vertices_;
+    int32_t flags_;
+};
+
+#endif
@@ -1,5 +1,19 @@
 const arcsim_native = require('bindings')('arcsim-binding-native')
 
+// Engine event types passed to the session callback. They are also the bits
+// of the event_mask create_session option, ( 1 << type ), and the keys of its
+// mesh_interval option.
+export const CallbackType = Object.freeze({
+    Initialize: 0,
+    CollisionStep: 1,
+    OptimizationStep: 2,
+    RemeshingStep: 3,
+    SimulationFrame: 4,
+    Paused: 5,
+    Finished: 6,
+    Error: 7
+});
+
 export class ArcsimTranslator {
     constructor() {
         this._addonInstance = new arcsim_native.ArcsimTranslator();
@@ -60,8 +74,12 @@ export class ArcsimTranslator {
 }
 
 export class ArcsimBinding {
-    constructor(shared_library_path){
-        this._addonInstance = new arcsim_native.ArcsimBinding(shared_library_path);
+    // options.session_pool = { simulation, meshing } creates that many
+    // sessions of each type upfront, see warm_sessions. options.mesh_cache
+    // enables the mesh cache, see set_mesh_cache.
+    constructor(shared_library_path, options){
+        this._addonInstance = new arcsim_native.ArcsimBinding(shared_library_path, options || {});
+        this._frameRings = new Map();
     }
     
     version = () =>
@@ -80,18 +98,42 @@ export class ArcsimBinding {
         {
             return new Promise((resolve, reject) => {
                 try{
-                    resolve(this._addonInstance.create_session(config));
+                    // The shared memory of a frame_ring is allocated here,
+                    // the native side only writes to it
+                    let ring = null;
+                    if( config && config.frame_ring ){
+                        const options = config.frame_ring;
+                        const buffer = new SharedArrayBuffer(FrameRingReader.byteLength(options.slots || 3,
+                                                                                        options.max_vertices,
+                                                                                        options.max_garments || 16));
+                        config = Object.assign({}, config, {
+                            frame_ring: Object.assign({}, options, { buffer: new Int32Array(buffer) })
+                        });
+                        ring = new FrameRingReader(buffer);
+                    }
+                    const session_handle = this._addonInstance.create_session(config);
+                    if( ring )
+                        this._frameRings.set(session_handle, ring);
+                    resolve(session_handle);
                 }
                 catch( error ){
                     reject(error);
                 }
             });
         }
+
+    // FrameRingReader of a session created with a frame_ring. Its buffer can
+    // be posted to worker threads, which read it with their own reader.
+    frame_ring = (session_handle) =>
+        {
+            return this._frameRings.get(session_handle);
+        }
     
     destroy_session = (session_handle) =>
         {
             return new Promise((resolve, reject) => {
                 try{
+                    this._frameRings.delete(session_handle);
                     resolve(this._addonInstance.destroy_session(session_handle));
                 }
                 catch( error ){
@@ -104,7 +146,12 @@ export class ArcsimBinding {
         {
             return new Promise((resolve, reject) => {
                 try{
-                    resolve(this._addonInstance.add_obstacle(session_handle, obstacle_data));
+                    this._addonInstance.add_obstacle(session_handle, obstacle_data, (handle, error) => {
+                        if( error == undefined )
+                            resolve( handle );
+                        else
+                            reject( error );
+                    });
                 }
                 catch( error ){
                     reject(error);
@@ -116,7 +163,12 @@ export class ArcsimBinding {
         {
             return new Promise((resolve, reject) => {
                 try{
-                    resolve(this._addonInstance.add_garment(session_handle,garment_data));
+                    this._addonInstance.add_garment(session_handle, garment_data, (handle, error) => {
+                        if( error == undefined )
+                            resolve( handle );
+                        else
+                            reject( error );
+                    });
                 }
                 catch( error ){
                     reject(error);
@@ -148,7 +200,152 @@ export class ArcsimBinding {
             });
         }
 
-    generate_mesh = (garment_json) =>
+    // Meshes every garment JSON of the array with at most
+    // options.concurrency engine sessions at once (default: the number of
+    // cores), all with the same options.meshing_params overrides. Each result
+    // is { index, data, error, timings } with timings in milliseconds;
+    // options.on_result receives them as they complete. Resolves with all of
+    // them in input order, failed garments included.
+    generate_mesh_batch = (garment_jsons, options) =>
+        {
+            return new Promise((resolve, reject) => {
+                try{
+                    options = options || {};
+                    const results = new Array(garment_jsons.length);
+                    const native_options = {};
+                    if( options.concurrency != undefined )
+                        native_options.concurrency = options.concurrency;
+                    if( options.meshing_params != undefined )
+                        native_options.meshing_params = options.meshing_params;
+                    this._addonInstance.generate_mesh_batch(garment_jsons, native_options, (result) => {
+                        if( result == null ){
+                            resolve(results);
+                            return;
+                        }
+                        results[result.index] = result;
+                        if( options.on_result )
+                            options.on_result(result);
+                    });
+                }
+                catch( error ){
+                    reject(error);
+                }
+            });
+        }
+
+    // { directory, max_bytes } keeps the results of generate_mesh and
+    // generate_mesh_batch on disk, keyed by the garment JSON, the meshing
+    // parameters and the engine version, and trimmed to max_bytes (1 GB by
+    // default) least recently used first. Cached results are memory mapped
+    // copy-on-write, writing to them leaves the cache intact. null disables
+    // the cache.
+    set_mesh_cache = (options) =>
+        {
+            return new Promise((resolve, reject) => {
+                try{
+                    resolve(this._addonInstance.set_mesh_cache(options));
+                }
+                catch( error ){
+                    reject(error);
+                }
+            });
+        }
+
+    // { hits, misses, stores, evictions, entries, bytes, max_bytes }, or null
+    // without a cache
+    mesh_cache_stats = () =>
+        {
+            return this._addonInstance.mesh_cache_stats();
+        }
+
+    // Obstacles added to any session are kept converted, so adding the same
+    // body again, to this session or another, skips the conversion and the
+    // validation. { max_bytes } bounds the cache (512 MB by default); it is
+    // shared by every binding of the process.
+    set_obstacle_cache = (options) =>
+        {
+            return new Promise((resolve, reject) => {
+                try{
+                    resolve(this._addonInstance.set_obstacle_cache(options));
+                }
+                catch( error ){
+                    reject(error);
+                }
+            });
+        }
+
+    // { hits, misses, evictions, entries, in_use, bytes, max_bytes }, in_use
+    // counting the entries some session is still adding
+    obstacle_cache_stats = () =>
+        {
+            return this._addonInstance.obstacle_cache_stats();
+        }
+
+    // Resolves with the packed ObstacleFrame with its sdf_parts filled in:
+    // one narrow band SDF per connected part of the geometry, sampled every
+    // dx and kept innerband deep and outerband out (4 samples by default).
+    // Unless sparse is false, parts only store the bricks of samples near
+    // the surface, when that is smaller than the whole grid.
+    // options: { dx, innerband, outerband, threads, sparse }
+    generate_obstacle_sdf = (obstacle_data, options) =>
+        {
+            return new Promise((resolve, reject) => {
+                try{
+                    this._addonInstance.generate_obstacle_sdf(obstacle_data, options, (data, error) => {
+                        if( error == undefined )
+                            resolve( data );
+                        else
+                            reject( error );
+                    });
+                }
+                catch( error ){
+                    reject(error);
+                }
+            });
+        }
+
+    // { directory, max_bytes } keeps the SDFs of generate_obstacle_sdf on
+    // disk, keyed by the obstacle mesh and the sampling options. Takes a
+    // directory of its own, not the mesh cache's. null disables the cache.
+    set_sdf_cache = (options) =>
+        {
+            return new Promise((resolve, reject) => {
+                try{
+                    resolve(this._addonInstance.set_sdf_cache(options));
+                }
+                catch( error ){
+                    reject(error);
+                }
+            });
+        }
+
+    // Same as mesh_cache_stats, for the SDF cache
+    sdf_cache_stats = () =>
+        {
+            return this._addonInstance.sdf_cache_stats();
+        }
+
+    // Keeps { simulation, meshing } idle sessions ready for create_session and
+    // generate_mesh, which otherwise wait for the engine to build one.
+    // Destroyed and finished sessions are reset and go back to the pool.
+    // Resolves with the number of idle sessions of each type.
+    warm_sessions = (counts) =>
+        {
+            return new Promise((resolve, reject) => {
+                try{
+                    resolve(this._addonInstance.warm_sessions(counts));
+                }
+                catch( error ){
+                    reject(error);
+                }
+            });
+        }
+
+    // options.per_piece meshes every part of the garment, the pieces sewn to
+    // each other, in a session of its own, up to options.concurrency at once,
+    // and caches parts one by one with the mesh cache. Seams are always
+    // meshed with both of their pieces.
+    generate_mesh = (garment_json, options) =>
         {
             return new Promise((resolve, reject) => {                   
                 try{
@@ -157,7 +354,7 @@ export class ArcsimBinding {
                             resolve( data );
                         else
                             reject( error );
-                    });
+                    }, options || {});
                 }
                 catch( error ){
                     reject(error);
@@ -166,3 +363,176 @@ export class ArcsimBinding {
         }
         
 }
+
+
+// Decodes the garment_positions buffers delivered by sessions created with
+// quantize_positions. The last values of every garment are kept for
+// delta_positions, so buffers must be decoded in the order they arrive.
+export class QuantizedPositionDecoder {
+    static HEADER_SIZE = 40;
+    static FLAG_DELTA = 1;
+
+    constructor() {
+        this._previous = new Map();
+    }
+
+    // Returns { garment_handle, positions }, positions being a Float32Array
+    // of xyz triples
+    decode = (bytes) =>
+        {
+            const header = new DataView(bytes.buffer, bytes.byteOffset, QuantizedPositionDecoder.HEADER_SIZE);
+            const version = header.getUint16(0, true);
+            if( version != 1 )
+                throw new Error("Unsupported quantized positions version " + version);
+            const flags = header.getUint16(2, true);
+            const garment_handle = header.getInt32(4, true);
+            const count = header.getUint32(8, true) * 3;
+            const min = [ header.getFloat32(16, true), header.getFloat32(20, true), header.getFloat32(24, true) ];
+            const step = [ header.getFloat32(28, true), header.getFloat32(32, true), header.getFloat32(36, true) ];
+
+            let values = new Uint16Array(bytes.buffer.slice(bytes.byteOffset + QuantizedPositionDecoder.HEADER_SIZE,
+                                                           bytes.byteOffset + QuantizedPositionDecoder.HEADER_SIZE + count * 2));
+            if( flags & QuantizedPositionDecoder.FLAG_DELTA ){
+                const previous = this._previous.get(garment_handle);
+                if( previous == undefined || previous.length != count )
+                    throw new Error("Missing previous positions for garment " + garment_handle);
+                for( let i = 0; i < count; ++i )
+                    values[i] = previous[i] + values[i];
+            }
+            this._previous.set(garment_handle, values);
+
+            const positions = new Float32Array(count);
+            for( let i = 0; i < count; i += 3 ){
+                positions[i] = min[0] + values[i] * step[0];
+                positions[i + 1] = min[1] + values[i + 1] * step[1];
+                positions[i + 2] = min[2] + values[i + 2] * step[2];
+            }
+            return { garment_handle, positions };
+        }
+
+    reset = () =>
+        {
+            this._previous.clear();
+        }
+}
+
+
+// Reads the status and garment positions a session with a frame_ring writes
+// into shared memory, without going through the event loop. Works on any
+// thread given the SharedArrayBuffer; the layout is described in
+// src/frame_ring.hpp.
+export class FrameRingReader {
+    static MAGIC = 0x41524652;
+    static HEADER_SIZE = 64;
+    static SLOT_HEADER_SIZE = 48;
+    static GARMENT_ENTRY_SIZE = 16;
+    static SLOT_ALIGNMENT = 64;
+    static FLAG_INCOMPLETE = 1;
+    // Attempts at reading a seqlock before giving up on a busy writer
+    static MAX_RETRIES = 64;
+
+    static slotSize = (max_vertices, max_garments) =>
+        {
+            const size = FrameRingReader.SLOT_HEADER_SIZE + max_garments * FrameRingReader.GARMENT_ENTRY_SIZE + max_vertices * 12;
+            return Math.ceil(size / FrameRingReader.SLOT_ALIGNMENT) * FrameRingReader.SLOT_ALIGNMENT;
+        }
+
+    static byteLength = (slots, max_vertices, max_garments) =>
+        {
+            return FrameRingReader.HEADER_SIZE + slots * FrameRingReader.slotSize(max_vertices, max_garments);
+        }
+
+    constructor(buffer) {
+        this.buffer = buffer;
+        this._words = new Int32Array(buffer);
+        this._view = new DataView(buffer);
+    }
+
+    // Header fields are written once the session is created
+    _layout = () =>
+        {
+            if( this._words[0] != FrameRingReader.MAGIC )
+                return null;
+            return { slots: this._words[2], max_garments: this._words[4], slot_size: this._words[5] };
+        }
+
+    frames_written = () => Atomics.load(this._words, 6) >>> 0;
+    incomplete_frames = () => Atomics.load(this._words, 7) >>> 0;
+
+    // Latest { type, state, frame, steps, time } the engine reported, or
+    // null if there is none yet or the writer kept it busy
+    status = () =>
+        {
+            for( let attempt = 0; attempt < FrameRingReader.MAX_RETRIES; ++attempt ){
+                const sequence = Atomics.load(this._words, 8);
+                if( sequence == 0 )
+                    return null;
+                if( sequence & 1 )
+                    continue;
+                const status = {
+                    type: this._words[9],
+                    state: this._words[10],
+                    frame: this._words[11],
+                    steps: this._words[12],
+                    time: this._view.getFloat64(56, true)
+                };
+                if( Atomics.load(this._words, 8) == sequence )
+                    return status;
+            }
+            return null;
+        }
+
+    // Copy of the most recent frame: { sequence, type, frame,
+    // steps, time, garments: [{ handle, first_vertex, vertex_count }],
+    // positions }, positions being xyz triples of all garments in a
+    // Float32Array. Passing the previous result's positions reuses them when
+    // they are large enough. Null if there is no frame yet, or the most
+    // recent one is incomplete because it didn't fit its slot.
+    latest_frame = (positions) =>
+        {
+            const layout = this._layout();
+            if( !layout )
+                return null;
+            for( let attempt = 0; attempt < FrameRingReader.MAX_RETRIES; ++attempt ){
+                const written = Atomics.load(this._words, 6) >>> 0;
+                if( written == 0 )
+                    return null;
+                const slot = FrameRingReader.HEADER_SIZE + ( ( written - 1 ) % layout.slots ) * layout.slot_size;
+                const sequence_index = slot / 4;
+                const sequence = Atomics.load(this._words, sequence_index);
+                if( sequence & 1 )
+                    continue;
+
+                const flags = this._words[sequence_index + 8];
+                const garment_count = Math.min(this._words[sequence_index + 6], layout.max_garments);
+                const vertex_count = this._words[sequence_index + 7];
+                const frame = {
+                    sequence: written,
+                    type: this._words[sequence_index + 1],
+                    frame: this._words[sequence_index + 2],
+                    steps: this._words[sequence_index + 3],
+                    time: this._view.getFloat64(slot + 16, true),
+                    garments: [],
+                    positions: null
+                };
+                for( let i = 0; i < garment_count; ++i ){
+                    const entry = sequence_index + ( FrameRingReader.SLOT_HEADER_SIZE + i * FrameRingReader.GARMENT_ENTRY_SIZE ) / 4;
+                    frame.garments.push({ handle: this._words[entry],
+                                          first_vertex: this._words[entry + 1],
+                                          vertex_count: this._words[entry + 2] });
+                }
+                const count = vertex_count * 3;
+                if( !positions || positions.length < count )
+                    positions = new Float32Array(count);
+                const offset = slot + FrameRingReader.SLOT_HEADER_SIZE + layout.max_garments * FrameRingReader.GARMENT_ENTRY_SIZE;
+                if( count <= ( layout.slot_size - offset + slot ) / 4 )
+                    positions.set(new Float32Array(this.buffer, offset, count));
+                frame.positions = positions.subarray(0, count);
+
+                if( Atomics.load(this._words, sequence_index) != sequence )
+                    continue;
+                return ( flags & FrameRingReader.FLAG_INCOMPLETE ) ? null : frame;
+            }
+            return null;
+        }
+}
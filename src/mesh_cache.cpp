@@ -0,0 +1,282 @@
+#include "mesh_cache.hpp"
+#include <blob/content_hash.hpp>
+
+#include <json/json.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include <algorithm>
+#include <tuple>
+#include <vector>
+
+#if defined(PLATFORM_WINDOWS)
+#include <direct.h>
+#include <process.h>
+#include <sys/types.h>
+#include <sys/utime.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+#endif
+
+
+namespace {
+
+bool MakeDirectory( const std::string& path )
+{
+#if defined(PLATFORM_WINDOWS)
+    return ::_mkdir( path.c_str() ) == 0 || errno == EEXIST;
+#else
+    return ::mkdir( path.c_str(), 0755 ) == 0 || errno == EEXIST;
+#endif
+}
+
+struct DirectoryEntry {
+    std::string name;
+    uint64_t size;
+    int64_t modified;
+};
+
+// Regular files directly in the directory
+std::vector<DirectoryEntry> ListDirectory( const std::string& directory )
+{
+    std::vector<DirectoryEntry> files;
+#if defined(PLATFORM_WINDOWS)
+    WIN32_FIND_DATAA data;
+    HANDLE find = ::FindFirstFileA( ( directory + "/*" ).c_str(), &data );
+    if( find == INVALID_HANDLE_VALUE )
+        return files;
+    do{
+        if( data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY )
+            continue;
+        const uint64_t size = ( uint64_t( data.nFileSizeHigh ) << 32 ) | data.nFileSizeLow;
+        const int64_t modified = int64_t( ( uint64_t( data.ftLastWriteTime.dwHighDateTime ) << 32 ) | data.ftLastWriteTime.dwLowDateTime );
+        files.push_back( DirectoryEntry{ data.cFileName, size, modified } );
+    } while( ::FindNextFileA( find, &data ) );
+    ::FindClose( find );
+#else
+    DIR* dir = ::opendir( directory.c_str() );
+    if( !dir )
+        return files;
+    while( struct dirent* entry = ::readdir( dir ) ){
+        struct stat info;
+        if( ::stat( ( directory + "/" + entry->d_name ).c_str(), &info ) != 0 || !S_ISREG( info.st_mode ) )
+            continue;
+        files.push_back( DirectoryEntry{ entry->d_name, uint64_t( info.st_size ), int64_t( info.st_mtime ) } );
+    }
+    ::closedir( dir );
+#endif
+    return files;
+}
+
+// Bumps the modification time, which orders the entries between processes
+void TouchFile( const std::string& path )
+{
+#if defined(PLATFORM_WINDOWS)
+    ::_utime( path.c_str(), nullptr );
+#else
+    ::utime( path.c_str(), nullptr );
+#endif
+}
+
+// Unique to the calling thread among every process sharing the directory
+std::string WriterId()
+{
+#if defined(PLATFORM_WINDOWS)
+    const int pid = ::_getpid();
+#else
+    const int pid = ::getpid();
+#endif
+    return std::to_string( pid ) + "-" + std::to_string( std::hash<std::thread::id>()( std::this_thread::get_id() ) );
+}
+
+// The same garment with its keys reordered or reformatted meshes the same
+std::string CanonicalJson( const std::string& json )
+{
+    Json::Value json_root;
+    std::stringstream json_stream;
+    json_stream.str( json );
+    try{
+        json_stream >> json_root;
+    }
+    catch( std::exception& ){
+        return json;
+    }
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "";
+    return Json::writeString( builder, json_root );
+}
+
+}
+
+
+MeshCache::MeshCache( const std::string& directory, uint64_t max_bytes, const std::string& engine_version,
+                      const std::string& extension ) :
+    directory_( directory ),
+    max_bytes_( max_bytes ),
+    engine_version_( engine_version ),
+    extension_( extension )
+{
+    if( directory_.empty() || !MakeDirectory( directory_ ) )
+        throw std::runtime_error( "Could not create mesh cache directory " + directory_ );
+    stats_.max_bytes = max_bytes_;
+
+    std::lock_guard<std::mutex> lock( mutex_ );
+    ScanDirectory();
+    Evict();
+}
+
+std::string MeshCache::Key( const std::string& garment_json, const MeshingParams& params,
+                            const std::string& kind ) const
+{
+    const std::string json = CanonicalJson( garment_json );
+    return Geometry::ContentKey( [&]( Geometry::ContentHash& hash ){
+        hash.Update( engine_version_.data(), engine_version_.size() );
+        hash.UpdateValue( uint64_t( kind.size() ) );
+        hash.Update( kind.data(), kind.size() );
+        hash.UpdateValue( uint64_t( json.size() ) );
+        hash.Update( json.data(), json.size() );
+        hash.UpdateValue( params.edge_length );
+        hash.UpdateValue( params.max_deviation );
+        hash.UpdateValue( params.min_subdiv );
+    } );
+}
+
+std::unique_ptr<Geometry::MappedFile> MeshCache::Find( const std::string& key, const Verifier& verify )
+{
+    // Entries stored by other processes since the scan are found too. The
+    // file is checked unlocked, other lookups needn't wait for it.
+    const std::string path = EntryPath( key );
+    std::unique_ptr<Geometry::MappedFile> file;
+    try{
+        file.reset( new Geometry::MappedFile( path ) );
+    }
+    catch( std::exception& ){
+    }
+    if( file && ( file->size() == 0 || !verify( file->data(), file->size() ) ) ){
+        // Truncated or corrupt, the next Store replaces it
+        file.reset();
+        std::remove( path.c_str() );
+    }
+
+    std::lock_guard<std::mutex> lock( mutex_ );
+    if( !file ){
+        // Removed behind our back, or just now
+        Remove( key );
+        ++stats_.misses;
+        return nullptr;
+    }
+    ++stats_.hits;
+    if( index_.count( key ) )
+        Touch( key );
+    else
+        Insert( key, file->size() );
+    TouchFile( path );
+    return file;
+}
+
+void MeshCache::Store( const std::string& key, const void* data, size_t size )
+{
+    if( size == 0 || size > max_bytes_ )
+        return;
+
+    // Written aside and renamed, so readers never see a partial entry
+    const std::string path = EntryPath( key );
+    const std::string temp_path = path + "." + WriterId() + ".tmp";
+    {
+        std::ofstream out( temp_path.c_str(), std::ios::binary | std::ios::trunc );
+        if( !out.write( static_cast<const char*>( data ), size ) ){
+            out.close();
+            std::remove( temp_path.c_str() );
+            return;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock( mutex_ );
+    std::remove( path.c_str() );
+    if( std::rename( temp_path.c_str(), path.c_str() ) != 0 ){
+        std::remove( temp_path.c_str() );
+        return;
+    }
+
+    Insert( key, size );
+    ++stats_.stores;
+    Evict();
+}
+
+MeshCache::Stats MeshCache::GetStats() const
+{
+    std::lock_guard<std::mutex> lock( mutex_ );
+    Stats stats = stats_;
+    stats.entries = entries_.size();
+    return stats;
+}
+
+std::string MeshCache::EntryPath( const std::string& key ) const
+{
+    return directory_ + "/" + key + extension_;
+}
+
+void MeshCache::ScanDirectory()
+{
+    // Oldest modification first; hits bump it, so it is the use order
+    std::vector< std::tuple<int64_t, std::string, uint64_t> > found;
+    for( const DirectoryEntry& file : ListDirectory( directory_ ) ){
+        if( file.size == 0 || file.name.size() <= extension_.size() ||
+            file.name.compare( file.name.size() - extension_.size(), extension_.size(), extension_ ) != 0 )
+            continue;
+        found.emplace_back( file.modified, file.name.substr( 0, file.name.size() - extension_.size() ), file.size );
+    }
+    std::sort( found.begin(), found.end() );
+    for( const auto& entry : found )
+        Insert( std::get<1>( entry ), std::get<2>( entry ) );
+}
+
+void MeshCache::Insert( const std::string& key, uint64_t size )
+{
+    auto it = index_.find( key );
+    if( it != index_.end() ){
+        stats_.bytes -= it->second->second;
+        entries_.erase( it->second );
+    }
+    entries_.emplace_back( key, size );
+    index_[key] = std::prev( entries_.end() );
+    stats_.bytes += size;
+}
+
+void MeshCache::Remove( const std::string& key )
+{
+    auto it = index_.find( key );
+    if( it == index_.end() )
+        return;
+    stats_.bytes -= it->second->second;
+    entries_.erase( it->second );
+    index_.erase( it );
+}
+
+void MeshCache::Touch( const std::string& key )
+{
+    auto it = index_.find( key );
+    if( it != index_.end() )
+        entries_.splice( entries_.end(), entries_, it->second );
+}
+
+void MeshCache::Evict()
+{
+    while( stats_.bytes > max_bytes_ && !entries_.empty() ){
+        const auto& oldest = entries_.front();
+        std::remove( EntryPath( oldest.first ).c_str() );
+        stats_.bytes -= oldest.second;
+        ++stats_.evictions;
+        index_.erase( oldest.first );
+        entries_.pop_front();
+    }
+}
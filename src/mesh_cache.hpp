@@ -0,0 +1,91 @@
+#ifndef MESH_CACHE_HPP_
+#define MESH_CACHE_HPP_
+
+#pragma once
+
+#include "interface.hpp"
+#include <blob/mapped_file.hpp>
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+
+// Persistent cache of meshing results, as packed Scene bytes. Entries are
+// addressed by a hash of what the result depends on: the garment JSON,
+// canonicalized so key order and whitespace don't matter, the meshing
+// parameters and the engine version. Hits are memory mapped.
+//
+// Every entry is a <key>.scene file of the cache directory. The least
+// recently used order is kept in memory and in the files' modification
+// times, which hits bump; it is rebuilt from a scan of the directory on
+// construction. Each process trims to max_bytes the entries it knows of,
+// so processes sharing a directory may together hold more until they are
+// restarted. Entries are checked on every hit, since another process may
+// have left them corrupt. Safe to use from any thread. Other results keyed
+// elsewhere can be kept the same way, under another extension.
+class MeshCache
+{
+public:
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t stores = 0;
+        uint64_t evictions = 0;
+        size_t entries = 0;
+        uint64_t bytes = 0;
+        uint64_t max_bytes = 0;
+    };
+
+    // Throws if the directory can't be created. engine_version takes part
+    // in every key, so results of another engine build are never returned.
+    MeshCache( const std::string& directory, uint64_t max_bytes, const std::string& engine_version,
+               const std::string& extension = ".scene" );
+
+    MeshCache( const MeshCache& ) = delete;
+    MeshCache& operator=( const MeshCache& ) = delete;
+
+    // Results of different kinds (whole garments, single pieces...) of the
+    // same JSON get different keys
+    std::string Key( const std::string& garment_json, const MeshingParams& params,
+                     const std::string& kind = std::string() ) const;
+
+    // Whether the bytes of an entry can be used
+    typedef std::function<bool( const char* data, uint64_t size )> Verifier;
+
+    // Returns null on a miss. An entry the verifier rejects is removed and
+    // counts as a miss.
+    std::unique_ptr<Geometry::MappedFile> Find( const std::string& key, const Verifier& verify );
+
+    // Failures to write are not errors, the entry is just not cached
+    void Store( const std::string& key, const void* data, size_t size );
+
+    Stats GetStats() const;
+
+private:
+    std::string EntryPath( const std::string& key ) const;
+    void ScanDirectory();
+    void Insert( const std::string& key, uint64_t size );
+    void Remove( const std::string& key );
+    void Touch( const std::string& key );
+    void Evict();
+
+    const std::string directory_;
+    const uint64_t max_bytes_;
+    const std::string engine_version_;
+    const std::string extension_;
+
+    // Least recently used first, with the size of every entry
+    std::list< std::pair<std::string, uint64_t> > entries_;
+    std::map< std::string, std::list< std::pair<std::string, uint64_t> >::iterator > index_;
+    Stats stats_;
+    mutable std::mutex mutex_;
+};
+
+
+#endif
@@ -0,0 +1,453 @@
+#include "mesh_generation.hpp"
+#include <translation/arcsim_translation.hpp>
+
+#include <json/json.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+
+
+namespace {
+
+double MillisecondsSince( std::chrono::steady_clock::time_point start )
+{
+    return std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+}
+
+// Signalled by the engine's callback once a meshing session is done
+struct MeshingCompletion {
+    std::mutex mutex;
+    std::condition_variable finished;
+    bool done = {false};
+    CallbackType type = {CT_Finished};
+};
+
+void OnMeshingEvent( CallbackData data )
+{
+    if( !data.data_passthrough || !( data.type == CT_Finished || data.type == CT_Error ) )
+        return;
+    MeshingCompletion& completion = *reinterpret_cast<MeshingCompletion*>( data.data_passthrough );
+    // Notified under the lock: the waiter returns and frees the completion
+    // as soon as it sees done, which it can't before the lock is released
+    std::lock_guard<std::mutex> lock( completion.mutex );
+    completion.done = true;
+    completion.type = data.type;
+    completion.finished.notify_all();
+}
+
+// Parts of a garment shared out between the meshing threads
+struct PartWork {
+    std::function<void( size_t part )> mesh_part;
+    size_t count = {0};
+    std::atomic<size_t> next = {0};
+    size_t done = {0};
+    std::mutex mutex;
+    std::condition_variable finished;
+};
+
+// Checks mesh cache hits of whole garments
+bool IsPackedScene( const char* data, uint64_t size )
+{
+    flatbuffers::Verifier verifier( reinterpret_cast<const uint8_t*>( data ), static_cast<size_t>( size ) );
+    return ARCSim::VerifySceneBuffer( verifier );
+}
+
+std::string EngineError( const char* call, ErrorCode code )
+{
+    return std::string( "ARCSim Error: " ) + call + " failed with code " + std::to_string( code );
+}
+
+}
+
+
+Geometry::Blob FetchMeshedGarment( const ArcsimApi& api, int session_handle, int garment_handle )
+{
+    if( !api.get_garment_mesh || !api.free_garment_mesh )
+        throw std::runtime_error( "Binding Error: ARCSim library does not export get_garment_mesh" );
+
+    BinBlob* garment_data = nullptr;
+    const ErrorCode code = api.get_garment_mesh( session_handle, garment_handle, &garment_data, false );
+    if( code != ARC_OK || !garment_data )
+        throw std::runtime_error( EngineError( "get_garment_mesh", code ) );
+
+    Geometry::Blob blob;
+    try{
+        blob.Load( *garment_data );
+    }
+    catch( ... ){
+        api.free_garment_mesh( garment_data );
+        throw;
+    }
+    api.free_garment_mesh( garment_data );
+    return blob;
+}
+
+PackedBuffer PackMeshedBlob( Geometry::Blob& blob, const std::string& garment_json )
+{
+    // Meshing works in material space, the 3D vertices are its 2D vertices
+    const auto& vertices_2d = blob.Get2DVertices();
+    std::vector< std::array< float, 3 > > vertices_3d;
+    vertices_3d.resize( vertices_2d.size() );
+    for( size_t v = 0; v < vertices_2d.size(); ++v )
+        vertices_3d.at(v) = { vertices_2d.at(v)[0], vertices_2d.at(v)[1], 0.0 };
+    blob.Set3DVertices( std::move( vertices_3d ) );
+
+    ARCSim::SceneT fb_scene;
+    fb_scene.garments.emplace_back( std::make_unique<ARCSim::GarmentT>() );
+    ARCSimTranslation::ConvertToFB( blob, garment_json, *(fb_scene.garments.at(0)) );
+    ARCSimTranslation::ConvertToFB( blob, garment_json, fb_scene.constraints );
+
+    return PackToBuffer( &fb_scene, ARCSim::SceneIdentifier() );
+}
+
+PackedBuffer PackMeshedGarment( const ArcsimApi& api, int session_handle, int garment_handle,
+                                const std::string& garment_json )
+{
+    Geometry::Blob blob = FetchMeshedGarment( api, session_handle, garment_handle );
+    return PackMeshedBlob( blob, garment_json );
+}
+
+namespace {
+
+// Meshes a garment in a session of the pool and calls on_finished with the
+// session and garment handles once the engine is done, before the session
+// is handed back. Returns false with the result's error set on failure.
+bool MeshInSession( const ArcsimApi& api, SessionPool& pool, const MeshingParams& params,
+                    const std::string& garment_json, MeshingResult& result,
+                    const std::function<void( int session_handle, int garment_handle )>& on_finished )
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    int session_handle;
+    ErrorCode code = pool.Acquire( ST_Meshing, &session_handle );
+    if( code != ARC_OK ){
+        result.has_error = true;
+        result.error_msg = EngineError( "create_session", code );
+        return false;
+    }
+
+    MeshingCompletion completion;
+    MeshingParams session_params = params;
+    session_params.callback.func_ptr = &OnMeshingEvent;
+    session_params.callback.data_passthrough_ptr = &completion;
+
+    int garment_handle;
+    if( !api.add_garment || !api.prepare_meshing || !api.start_session )
+        code = ARC_InternalError;
+    else if( ( code = api.add_garment( session_handle, "data_garment", garment_json.c_str(), nullptr, &garment_handle ) ) != ARC_OK )
+        result.error_msg = EngineError( "add_garment", code );
+    else if( ( code = api.prepare_meshing( session_handle, &session_params ) ) != ARC_OK )
+        result.error_msg = EngineError( "prepare_meshing", code );
+    else if( ( code = api.start_session( session_handle ) ) != ARC_OK )
+        result.error_msg = EngineError( "start_session", code );
+    result.timings.session += MillisecondsSince( start );
+
+    if( code == ARC_OK ){
+        const auto meshing_start = std::chrono::steady_clock::now();
+        {
+            std::unique_lock<std::mutex> lock( completion.mutex );
+            completion.finished.wait( lock, [&]{ return completion.done; } );
+        }
+        result.timings.meshing += MillisecondsSince( meshing_start );
+
+        if( completion.type == CT_Error ){
+            const char* error_msg = nullptr;
+            if( api.get_error_message )
+                api.get_error_message( session_handle, error_msg );
+            result.error_msg = error_msg ? error_msg : "ARCSim Error: meshing failed";
+        }
+        else{
+            const auto convert_start = std::chrono::steady_clock::now();
+            try{
+                on_finished( session_handle, garment_handle );
+            }
+            catch( std::exception& err ){
+                result.error_msg = std::string( "Failed to convert garment: " ) + err.what();
+            }
+            result.timings.convert += MillisecondsSince( convert_start );
+        }
+    }
+    else if( result.error_msg.empty() )
+        result.error_msg = "Binding Error: ARCSim library does not export the meshing functions";
+
+    result.has_error = !result.error_msg.empty();
+    pool.Release( ST_Meshing, session_handle );
+    return !result.has_error;
+}
+
+}
+
+MeshingResult MeshGarment( const ArcsimApi& api, SessionPool& pool, const MeshingParams& params,
+                           const std::string& garment_json, MeshCache* cache )
+{
+    MeshingResult result;
+    const auto start = std::chrono::steady_clock::now();
+
+    std::string cache_key;
+    if( cache ){
+        cache_key = cache->Key( garment_json, params );
+        result.cached_scene = cache->Find( cache_key, IsPackedScene );
+        if( result.cached_scene ){
+            result.timings.total = MillisecondsSince( start );
+            return result;
+        }
+    }
+
+    MeshInSession( api, pool, params, garment_json, result, [&]( int session_handle, int garment_handle ){
+        result.scene = PackMeshedGarment( api, session_handle, garment_handle, garment_json );
+        if( cache )
+            cache->Store( cache_key, result.scene.data(), result.scene.size() );
+    } );
+    result.timings.total = MillisecondsSince( start );
+    return result;
+}
+
+
+std::vector<std::string> SplitGarmentBySewing( const std::string& garment_json,
+                                               std::vector<std::string>* part_keys )
+{
+    Json::Value json_root;
+    std::stringstream json_stream;
+    json_stream.str( garment_json );
+    json_stream >> json_root;
+
+    const Json::Value pieces = json_root["pieces"];
+    const Json::Value sewing = json_root["sewing"];
+    json_root.removeMember( "handles" );
+
+    // Pieces sewn to each other, directly or through other pieces, share a
+    // part; a seam belongs to the part of its pieces. Seams naming unknown
+    // pieces go to the first part, for the engine to reject.
+    const Json::ArrayIndex no_piece = pieces.size();
+    std::map<std::string, Json::ArrayIndex> piece_names;
+    for( Json::ArrayIndex p = 0; p < pieces.size(); ++p ){
+        if( pieces[p]["name"].isString() )
+            piece_names[ pieces[p]["name"].asString() ] = p;
+    }
+    auto piece_of = [&]( const Json::Value& side ){
+        const Json::Value& name = side["piece"];
+        auto it = name.isString() ? piece_names.find( name.asString() ) : piece_names.end();
+        return it != piece_names.end() ? it->second : no_piece;
+    };
+    std::vector<Json::ArrayIndex> parent( pieces.size() );
+    for( Json::ArrayIndex p = 0; p < pieces.size(); ++p )
+        parent[p] = p;
+    auto root_of = [&]( Json::ArrayIndex p ){
+        while( parent[p] != p )
+            p = parent[p] = parent[parent[p]];
+        return p;
+    };
+    for( Json::ArrayIndex seam = 0; seam < sewing.size(); ++seam ){
+        const Json::ArrayIndex first = piece_of( sewing[seam]["first"] );
+        const Json::ArrayIndex second = piece_of( sewing[seam]["second"] );
+        if( first != no_piece && second != no_piece )
+            parent[ root_of( first ) ] = root_of( second );
+    }
+
+    // Parts in the order of their first piece, pieces in garment order
+    std::map<Json::ArrayIndex, size_t> part_of_root;
+    std::vector<Json::Value> part_pieces, part_seams;
+    for( Json::ArrayIndex p = 0; p < pieces.size(); ++p ){
+        auto part = part_of_root.insert( { root_of( p ), part_pieces.size() } );
+        if( part.second ){
+            part_pieces.push_back( Json::Value( Json::arrayValue ) );
+            part_seams.push_back( Json::Value( Json::arrayValue ) );
+        }
+        part_pieces[ part.first->second ].append( pieces[p] );
+    }
+    for( Json::ArrayIndex seam = 0; seam < sewing.size() && !part_seams.empty(); ++seam ){
+        Json::ArrayIndex piece = piece_of( sewing[seam]["first"] );
+        if( piece == no_piece )
+            piece = piece_of( sewing[seam]["second"] );
+        part_seams[ piece == no_piece ? 0 : part_of_root[ root_of( piece ) ] ].append( sewing[seam] );
+    }
+
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "";
+
+    std::vector<std::string> part_jsons;
+    if( part_keys )
+        part_keys->clear();
+    for( size_t part = 0; part < part_pieces.size(); ++part ){
+        Json::Value part_root = json_root;
+        part_root["pieces"] = part_pieces[part];
+        part_root["sewing"] = part_seams[part];
+        part_jsons.push_back( Json::writeString( builder, part_root ) );
+
+        if( part_keys ){
+            Json::Value key_root;
+            key_root["pieces"] = part_pieces[part];
+            key_root["sewing"] = part_seams[part];
+            part_keys->push_back( Json::writeString( builder, key_root ) );
+        }
+    }
+    return part_jsons;
+}
+
+MeshingResult MeshGarmentByPiece( const ArcsimApi& api, SessionPool& pool, const MeshingParams& params,
+                                  const std::string& garment_json, unsigned concurrency,
+                                  WorkerPool& workers, MeshCache* cache )
+{
+    MeshingResult result;
+    const auto start = std::chrono::steady_clock::now();
+
+    std::string cache_key;
+    if( cache ){
+        cache_key = cache->Key( garment_json, params, "pieces" );
+        result.cached_scene = cache->Find( cache_key, IsPackedScene );
+        if( result.cached_scene ){
+            result.timings.total = MillisecondsSince( start );
+            return result;
+        }
+    }
+
+    std::vector<std::string> part_jsons, part_keys;
+    try{
+        part_jsons = SplitGarmentBySewing( garment_json, &part_keys );
+    }
+    catch( std::exception& err ){
+        result.has_error = true;
+        result.error_msg = std::string( "Failed to split garment: " ) + err.what();
+        return result;
+    }
+
+    // Every part is meshed into its own slot
+    std::vector< std::unique_ptr<Geometry::Blob> > part_blobs( part_jsons.size() );
+    std::vector<MeshingResult> part_results( part_jsons.size() );
+    auto mesh_part = [&]( size_t p ){
+        MeshingResult& part_result = part_results[p];
+        std::string part_key;
+        if( cache ){
+            part_key = cache->Key( part_keys[p], params, "part" );
+            // Loading the blob checks the entry; an unreadable one is dropped
+            // and the part meshed again
+            auto load_part = [&]( const char* data, uint64_t size ){
+                Geometry::Blob::BinBuffer buffer;
+                buffer.buffer = data;
+                buffer.len = size;
+                try{
+                    part_blobs[p].reset( new Geometry::Blob() );
+                    part_blobs[p]->Load( buffer );
+                    return true;
+                }
+                catch( std::exception& ){
+                    part_blobs[p].reset();
+                    return false;
+                }
+            };
+            if( cache->Find( part_key, load_part ) )
+                return;
+        }
+
+        MeshInSession( api, pool, params, part_jsons[p], part_result, [&]( int session_handle, int garment_handle ){
+            part_blobs[p].reset( new Geometry::Blob( FetchMeshedGarment( api, session_handle, garment_handle ) ) );
+            if( cache ){
+                Geometry::Blob::BinBlob_UniquePtr saved = part_blobs[p]->Save();
+                cache->Store( part_key, saved->buffer, saved->len );
+            }
+        } );
+    };
+
+    // Parts are taken by this thread and by helper jobs. Helpers that only
+    // start once every part is taken do nothing, so this thread waits for
+    // the parts, never for the jobs, and the state they share outlives it.
+    auto work = std::make_shared<PartWork>();
+    work->count = part_jsons.size();
+    work->mesh_part = mesh_part;
+    auto take_parts = [work]{
+        for( size_t p = work->next++; p < work->count; p = work->next++ ){
+            work->mesh_part( p );
+            std::lock_guard<std::mutex> lock( work->mutex );
+            if( ++work->done == work->count )
+                work->finished.notify_all();
+        }
+    };
+
+    const auto meshing_start = std::chrono::steady_clock::now();
+    const size_t helpers = std::min<size_t>( std::max( 1u, concurrency ), part_jsons.size() );
+    for( size_t h = 1; h < helpers; ++h )
+        workers.Post( take_parts );
+    take_parts();
+    {
+        std::unique_lock<std::mutex> lock( work->mutex );
+        work->finished.wait( lock, [&]{ return work->done == work->count; } );
+    }
+
+    for( const MeshingResult& part_result : part_results ){
+        result.timings.session += part_result.timings.session;
+        if( part_result.has_error && !result.has_error ){
+            result.has_error = true;
+            result.error_msg = part_result.error_msg;
+        }
+    }
+    // Wall clock time, the parts overlap
+    result.timings.meshing = MillisecondsSince( meshing_start );
+
+    if( !result.has_error ){
+        const auto convert_start = std::chrono::steady_clock::now();
+        try{
+            // Pieces are matched to the JSON by name, their order doesn't matter
+            Geometry::Blob garment;
+            for( const auto& part_blob : part_blobs )
+                garment.Append( *part_blob );
+            result.scene = PackMeshedBlob( garment, garment_json );
+            if( cache )
+                cache->Store( cache_key, result.scene.data(), result.scene.size() );
+        }
+        catch( std::exception& err ){
+            result.has_error = true;
+            result.error_msg = std::string( "Failed to convert garment: " ) + err.what();
+        }
+        result.timings.convert = MillisecondsSince( convert_start );
+    }
+
+    result.timings.total = MillisecondsSince( start );
+    return result;
+}
+
+
+MeshBatch::MeshBatch( std::shared_ptr<const ArcsimApi> api, std::shared_ptr<SessionPool> pool, const MeshingParams& params,
+                      std::vector<std::string> garment_jsons, unsigned concurrency,
+                      ResultHandler on_result, DoneHandler on_done,
+                      std::shared_ptr<MeshCache> cache ) :
+    api_( std::move( api ) ),
+    pool_( std::move( pool ) ),
+    cache_( std::move( cache ) ),
+    params_( params ),
+    garment_jsons_( std::move( garment_jsons ) ),
+    concurrency_( std::max( 1u, std::min<unsigned>( concurrency, unsigned( std::max<size_t>( garment_jsons_.size(), 1 ) ) ) ) ),
+    on_result_( std::move( on_result ) ),
+    on_done_( std::move( on_done ) ),
+    next_( 0 ),
+    remaining_( garment_jsons_.size() )
+{}
+
+void MeshBatch::Start( WorkerPool& workers )
+{
+    started_ = std::chrono::steady_clock::now();
+    if( garment_jsons_.empty() ){
+        on_done_();
+        return;
+    }
+    std::shared_ptr<MeshBatch> self = shared_from_this();
+    for( unsigned w = 0; w < concurrency_; ++w )
+        workers.Post( [self]{ self->Work(); } );
+}
+
+void MeshBatch::Work()
+{
+    for( size_t index = next_++; index < garment_jsons_.size(); index = next_++ ){
+        const double queued = MillisecondsSince( started_ );
+        MeshingResult result = MeshGarment( *api_, *pool_, params_, garment_jsons_[index], cache_.get() );
+        result.timings.queued = queued;
+        result.timings.total += queued;
+        on_result_( index, std::move( result ) );
+
+        if( --remaining_ == 0 )
+            on_done_();
+    }
+}
@@ -0,0 +1,115 @@
+#ifndef MESH_GENERATION_HPP_
+#define MESH_GENERATION_HPP_
+
+#pragma once
+
+#include <translation/flatbuffer_utils.hpp>
+#include "arcsim_api.hpp"
+#include "session_pool.hpp"
+#include "mesh_cache.hpp"
+#include "worker_pool.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+// Milliseconds spent on each stage of meshing a garment
+struct MeshingTimings {
+    double queued = 0;      // waiting for a free worker
+    double session = 0;     // taking a session and adding the garment
+    double meshing = 0;     // in the engine
+    double convert = 0;     // translating the mesh to a Scene
+    double total = 0;
+};
+
+struct MeshingResult {
+    PackedBuffer scene;
+    // Set instead of scene when the result came from the mesh cache
+    std::unique_ptr<Geometry::MappedFile> cached_scene;
+    bool has_error = {false};
+    std::string error_msg;
+    MeshingTimings timings;
+};
+
+// Converts the garment meshed by a finished ST_Meshing session into a packed
+// Scene holding the garment and its constraints. Throws on failure.
+PackedBuffer PackMeshedGarment( const ArcsimApi& api, int session_handle, int garment_handle,
+                                const std::string& garment_json );
+
+// Meshes a garment on the calling thread, in a session taken from the pool
+// and handed back when done. Engine and conversion errors are reported in
+// the result. With a cache, results are looked up there first and stored
+// there after meshing.
+MeshingResult MeshGarment( const ArcsimApi& api, SessionPool& pool, const MeshingParams& params,
+                           const std::string& garment_json, MeshCache* cache = nullptr );
+
+// Splits a garment JSON into one garment JSON per part: the pieces sewn to
+// each other, directly or through other pieces, and the seams between them.
+// Handles are left out. With part_keys, also returns for every part the
+// JSON its mesh depends on: its pieces, with their boundary and internal
+// curves, and its seams.
+std::vector<std::string> SplitGarmentBySewing( const std::string& garment_json,
+                                               std::vector<std::string>* part_keys = nullptr );
+
+// Meshes every part of a garment, as split by SplitGarmentBySewing, in a
+// session of its own, up to `concurrency` at once on the calling thread and
+// jobs of `workers`, and merges the parts back into one garment before the
+// conversion. Every seam is meshed with both of its pieces, so only garments
+// made of several separate parts mesh in parallel. The calling thread may be
+// one of the pool's: it never waits for a job that hasn't started. With a
+// cache, every part is looked up and stored on its own, so an edit re-meshes
+// only the parts it changed.
+MeshingResult MeshGarmentByPiece( const ArcsimApi& api, SessionPool& pool, const MeshingParams& params,
+                                  const std::string& garment_json, unsigned concurrency,
+                                  WorkerPool& workers, MeshCache* cache = nullptr );
+
+
+// Meshes a list of garments with at most `concurrency` engine sessions at
+// once, on the threads of a worker pool, which other requests may be using
+// too. Every garment is meshed with the same parameters. Results are handed
+// to on_result as they complete, from the pool's threads, and on_done is
+// called once after the last one.
+class MeshBatch : public std::enable_shared_from_this<MeshBatch>
+{
+public:
+    typedef std::function<void( size_t index, MeshingResult&& result )> ResultHandler;
+    typedef std::function<void()> DoneHandler;
+
+    MeshBatch( std::shared_ptr<const ArcsimApi> api, std::shared_ptr<SessionPool> pool, const MeshingParams& params,
+               std::vector<std::string> garment_jsons, unsigned concurrency,
+               ResultHandler on_result, DoneHandler on_done,
+               std::shared_ptr<MeshCache> cache = nullptr );
+
+    MeshBatch( const MeshBatch& ) = delete;
+    MeshBatch& operator=( const MeshBatch& ) = delete;
+
+    // The batch stays alive until its jobs are done. Jobs the pool drops
+    // when shut down leave the batch unfinished, on_done isn't called.
+    void Start( WorkerPool& workers );
+
+    size_t Size() const { return garment_jsons_.size(); }
+    unsigned Concurrency() const { return concurrency_; }
+
+private:
+    void Work();
+
+    const std::shared_ptr<const ArcsimApi> api_;
+    const std::shared_ptr<SessionPool> pool_;
+    const std::shared_ptr<MeshCache> cache_;
+    const MeshingParams params_;
+    const std::vector<std::string> garment_jsons_;
+    const unsigned concurrency_;
+    ResultHandler on_result_;
+    DoneHandler on_done_;
+
+    std::chrono::steady_clock::time_point started_;
+    std::atomic<size_t> next_;
+    std::atomic<size_t> remaining_;
+};
+
+
+#endif
@@ -4,6 +4,9 @@
 #include "arcsim_translator.hpp"
 
 Napi::Object Init(Napi::Env env, Napi::Object exports) {
+
+    // Sessions are per environment, so worker threads can each load the addon
+    ArcsimBinding::RegisterEnvironment(env);
     
     Napi::String binding_name = Napi::String::New(env, "ArcsimBinding");
     exports.Set(binding_name, ArcsimBinding::GetClass(env));
@@ -0,0 +1,202 @@
+#ifndef OBSTACLE_CACHE_HPP_
+#define OBSTACLE_CACHE_HPP_
+
+#pragma once
+
+#include "interface.hpp"
+#include "arcsim_api.hpp"
+#include <blob/content_hash.hpp>
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+
+// Obstacles converted for the engine, shared by every session of the
+// process. The same body is often added to many sessions: its packed bytes
+// are hashed, and a body seen before skips straight to add_obstacle with the
+// converted JSON and blob, and the validation result, of the first time.
+//
+// Entries are reference counted: sessions adding a body hold on to it, and
+// eviction only drops the cache's own reference. Least recently used entries
+// are evicted past max_bytes. Bodies being converted are tracked too, so
+// concurrent additions of a new body convert it once.
+class ObstacleCache
+{
+public:
+    struct Entry
+    {
+        std::string json;
+        std::unique_ptr<char[]> bytes;
+        uint64_t len = {0};
+
+        // Validates the obstacle with the given library once, later calls
+        // return the first result
+        ErrorCode Validate( const ArcsimApi& api ) const
+        {
+            std::lock_guard<std::mutex> lock( validation_mutex );
+            if( validated_by != api.validate_body ){
+                BinBlob blob;
+                blob.buffer = bytes.get();
+                blob.len = len;
+                validation = api.validate_body( json.c_str(), &blob );
+                validated_by = api.validate_body;
+            }
+            return validation;
+        }
+
+    private:
+        mutable std::mutex validation_mutex;
+        mutable api_functions::validate_body* validated_by = {nullptr};
+        mutable ErrorCode validation = {ARC_OK};
+    };
+    typedef std::shared_ptr<const Entry> EntryPtr;
+
+    struct Key
+    {
+        uint64_t hash[2];
+        uint64_t length;
+
+        bool operator<( const Key& other ) const
+        {
+            if( length != other.length )
+                return length < other.length;
+            if( hash[0] != other.hash[0] )
+                return hash[0] < other.hash[0];
+            return hash[1] < other.hash[1];
+        }
+    };
+
+    struct Stats
+    {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        size_t entries = 0;
+        size_t in_use = 0;
+        uint64_t bytes = 0;
+        uint64_t max_bytes = 0;
+    };
+
+    enum : uint64_t { DEFAULT_MAX_BYTES = uint64_t( 512 ) << 20 };
+
+    static ObstacleCache& Instance()
+    {
+        static ObstacleCache cache;
+        return cache;
+    }
+
+    ObstacleCache( const ObstacleCache& ) = delete;
+    ObstacleCache& operator=( const ObstacleCache& ) = delete;
+
+    // Two differently seeded 64 bit hashes and the length
+    static Key KeyOf( const uint8_t* data, size_t length )
+    {
+        Key key;
+        for( int i = 0; i < 2; ++i )
+            key.hash[i] = Geometry::ContentHash( i ).Update( data, length ).Digest();
+        key.length = length;
+        return key;
+    }
+
+    // Returns the entry of the key, made by convert on a miss. Throws what
+    // convert throws; a failed conversion is not cached.
+    EntryPtr Get( const Key& key, const std::function<EntryPtr()>& convert )
+    {
+        std::shared_future<EntryPtr> pending;
+        std::promise<EntryPtr> promise;
+        bool converting = false;
+        {
+            std::lock_guard<std::mutex> lock( mutex_ );
+            auto it = index_.find( key );
+            if( it != index_.end() ){
+                ++stats_.hits;
+                lru_.splice( lru_.end(), lru_, it->second );
+                return it->second->second;
+            }
+            auto in_flight = pending_.find( key );
+            if( in_flight != pending_.end() ){
+                ++stats_.hits;
+                pending = in_flight->second;
+            }
+            else{
+                ++stats_.misses;
+                pending = promise.get_future().share();
+                pending_.emplace( key, pending );
+                converting = true;
+            }
+        }
+        if( !converting )
+            return pending.get();
+
+        EntryPtr entry;
+        try{
+            entry = convert();
+        }
+        catch( ... ){
+            promise.set_exception( std::current_exception() );
+            std::lock_guard<std::mutex> lock( mutex_ );
+            pending_.erase( key );
+            throw;
+        }
+
+        promise.set_value( entry );
+        std::lock_guard<std::mutex> lock( mutex_ );
+        pending_.erase( key );
+        if( entry && entry->len <= max_bytes_ ){
+            lru_.emplace_back( key, entry );
+            index_[key] = std::prev( lru_.end() );
+            stats_.bytes += entry->len;
+            Evict();
+        }
+        return entry;
+    }
+
+    void SetMaxBytes( uint64_t max_bytes )
+    {
+        std::lock_guard<std::mutex> lock( mutex_ );
+        max_bytes_ = max_bytes;
+        Evict();
+    }
+
+    Stats GetStats() const
+    {
+        std::lock_guard<std::mutex> lock( mutex_ );
+        Stats stats = stats_;
+        stats.entries = lru_.size();
+        stats.max_bytes = max_bytes_;
+        for( const auto& entry : lru_ )
+            if( entry.second.use_count() > 1 )
+                ++stats.in_use;
+        return stats;
+    }
+
+private:
+    ObstacleCache() : max_bytes_( DEFAULT_MAX_BYTES ) {}
+
+    void Evict()
+    {
+        while( stats_.bytes > max_bytes_ && !lru_.empty() ){
+            stats_.bytes -= lru_.front().second->len;
+            ++stats_.evictions;
+            index_.erase( lru_.front().first );
+            lru_.pop_front();
+        }
+    }
+
+    // Least recently used first
+    std::list< std::pair<Key, EntryPtr> > lru_;
+    std::map< Key, std::list< std::pair<Key, EntryPtr> >::iterator > index_;
+    std::map< Key, std::shared_future<EntryPtr> > pending_;
+    uint64_t max_bytes_;
+    Stats stats_;
+    mutable std::mutex mutex_;
+};
+
+#endif
@@ -0,0 +1,90 @@
+#include "obstacle_sdf.hpp"
+#include "sdf/sdf_codec.hpp"
+#include <translation/flatbuffer_utils.hpp>
+#include <blob/content_hash.hpp>
+
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+
+namespace {
+
+// Changes whenever the builder or SdfT::data layouts do
+const char* SDF_LAYOUT = "sdf-1";
+
+void ReadMesh( const ARCSim::GeometryT& geometry, std::vector<Sdf::Vec3f>& vertices, std::vector<Sdf::Triangle>& triangles )
+{
+    if( !geometry.vertices_ws )
+        throw std::runtime_error( "Obstacle geometry has no world space vertices" );
+    vertices.reserve( geometry.vertices_ws->vertices.size() );
+    for( const auto& vertex : geometry.vertices_ws->vertices )
+        vertices.push_back( Sdf::Vec3f{{ vertex.x(), vertex.y(), vertex.z() }} );
+
+    triangles.reserve( geometry.faces.size() );
+    for( const auto& face : geometry.faces ){
+        if( !face || !face->tri_ws )
+            throw std::runtime_error( "Obstacle face has no world space triangle" );
+        triangles.push_back( Sdf::Triangle{{ face->tri_ws->a(), face->tri_ws->b(), face->tri_ws->c() }} );
+    }
+}
+
+// A hash of the world space mesh, the sampling options and the SDF layout.
+// Thread count doesn't take part.
+std::string KeyOf( const std::vector<Sdf::Vec3f>& vertices, const std::vector<Sdf::Triangle>& triangles,
+                   const Sdf::SdfOptions& options, bool sparse )
+{
+    return Geometry::ContentKey( [&]( Geometry::ContentHash& hash ){
+        hash.Update( SDF_LAYOUT, std::char_traits<char>::length( SDF_LAYOUT ) );
+        hash.UpdateValue( uint64_t( vertices.size() ) );
+        hash.Update( vertices.data(), vertices.size() * sizeof( Sdf::Vec3f ) );
+        hash.UpdateValue( uint64_t( triangles.size() ) );
+        hash.Update( triangles.data(), triangles.size() * sizeof( Sdf::Triangle ) );
+        hash.UpdateValue( options.dx );
+        hash.UpdateValue( options.innerband );
+        hash.UpdateValue( options.outerband );
+        hash.UpdateValue( uint8_t( sparse ) );
+    } );
+}
+
+}
+
+bool BuildObstacleSdf( ARCSim::ObstacleFrameT& body, const Sdf::SdfOptions& options, bool sparse, MeshCache* cache )
+{
+    if( !body.geometry )
+        throw std::runtime_error( "Obstacle has no geometry" );
+    std::vector<Sdf::Vec3f> vertices;
+    std::vector<Sdf::Triangle> triangles;
+    ReadMesh( *body.geometry, vertices, triangles );
+
+    std::string key;
+    if( cache ){
+        key = KeyOf( vertices, triangles, options, sparse );
+        // Unpacking checks the entry, the cache drops it if that fails
+        std::unique_ptr<ARCSim::ObstacleFrameT> cached;
+        auto unpack = [&]( const char* data, uint64_t size ){
+            cached.reset( UnPackFromBytestream<ARCSim::ObstacleFrameT>( reinterpret_cast<const uint8_t*>( data ), size, nullptr ) );
+            return cached != nullptr;
+        };
+        if( cache->Find( key, unpack ) ){
+            body.sdf_parts = std::move( cached->sdf_parts );
+            return true;
+        }
+    }
+
+    // Separate parts, like shoes on an avatar, get grids of their own
+    // instead of one spanning the space between them
+    ARCSim::ObstacleFrameT parts;
+    for( const auto& part : Sdf::ConnectedParts( triangles ) ){
+        std::unique_ptr<ARCSim::SdfT> sdf = Sdf::PackDense( Sdf::BuildGrid( vertices, part, options ),
+                                                            options.innerband, options.outerband );
+        parts.sdf_parts.push_back( sparse ? Sdf::ToSparse( *sdf ) : std::move( sdf ) );
+    }
+
+    if( cache ){
+        PackedBuffer packed = PackToBuffer( &parts, nullptr );
+        cache->Store( key, packed.data(), packed.size() );
+    }
+    body.sdf_parts = std::move( parts.sdf_parts );
+    return false;
+}
@@ -0,0 +1,20 @@
+#ifndef OBSTACLE_SDF_HPP_
+#define OBSTACLE_SDF_HPP_
+
+#pragma once
+
+#include <translation/arcsim_serializers.hpp>
+#include "sdf/sdf_builder.hpp"
+#include "mesh_cache.hpp"
+
+
+// Replaces the sdf_parts of the obstacle with one SDF per connected part of
+// its geometry, stored in bricks if sparse and that makes them smaller. With
+// a cache, parts are looked up there first and stored there after building;
+// returns whether they came from the cache. Throws if the obstacle has no
+// geometry or the SDF can't be built.
+bool BuildObstacleSdf( ARCSim::ObstacleFrameT& body, const Sdf::SdfOptions& options, bool sparse,
+                       MeshCache* cache = nullptr );
+
+
+#endif
@@ -0,0 +1,364 @@
+#include "sdf_builder.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+
+namespace {
+
+// 256M samples, 1 GB of distances while building
+const size_t MAX_SAMPLES = size_t( 1 ) << 28;
+
+const float FAR = std::numeric_limits<float>::max();
+
+unsigned WorkerCount( unsigned requested )
+{
+    if( requested > 0 )
+        return requested;
+    return std::max( 1u, std::thread::hardware_concurrency() );
+}
+
+// Calls work(begin, end) on ranges of [0, count) from several threads
+template<typename TWork>
+void ParallelFor( size_t count, unsigned threads, const TWork& work )
+{
+    threads = unsigned( std::min<size_t>( threads, count ) );
+    if( threads <= 1 ){
+        if( count > 0 )
+            work( size_t( 0 ), count );
+        return;
+    }
+
+    // Small ranges, taken in turn, even out slices of uneven cost
+    const size_t chunk = std::max<size_t>( 1, count / ( size_t( threads ) * 8 ) );
+    std::atomic<size_t> next( 0 );
+    auto worker = [&](){
+        for( size_t begin = next.fetch_add( chunk ); begin < count; begin = next.fetch_add( chunk ) )
+            work( begin, std::min( count, begin + chunk ) );
+    };
+    std::vector<std::thread> pool;
+    for( unsigned t = 1; t < threads; ++t )
+        pool.emplace_back( worker );
+    worker();
+    for( auto& thread : pool )
+        thread.join();
+}
+
+// Sign of the doubled area of the triangle (0, 1, 2), with exact zeros
+// broken consistently (simulation of simplicity) so a ray through an edge
+// or vertex crosses exactly one of the triangles sharing it
+int Orientation( double x1, double y1, double x2, double y2, double& twice_signed_area )
+{
+    twice_signed_area = y1 * x2 - x1 * y2;
+    if( twice_signed_area > 0 ) return 1;
+    if( twice_signed_area < 0 ) return -1;
+    if( y2 > y1 ) return 1;
+    if( y2 < y1 ) return -1;
+    if( x1 > x2 ) return 1;
+    if( x1 < x2 ) return -1;
+    return 0;
+}
+
+// Whether (x0, y0) is in the 2D triangle, with its barycentric coordinates
+bool PointInTriangle2D( double x0, double y0,
+                        double x1, double y1, double x2, double y2, double x3, double y3,
+                        double& a, double& b, double& c )
+{
+    x1 -= x0; x2 -= x0; x3 -= x0;
+    y1 -= y0; y2 -= y0; y3 -= y0;
+    const int signa = Orientation( x2, y2, x3, y3, a );
+    if( signa == 0 ) return false;
+    const int signb = Orientation( x3, y3, x1, y1, b );
+    if( signb != signa ) return false;
+    const int signc = Orientation( x1, y1, x2, y2, c );
+    if( signc != signa ) return false;
+    const double sum = a + b + c;
+    if( sum == 0 ) return false;
+    a /= sum;
+    b /= sum;
+    c /= sum;
+    return true;
+}
+
+uint32_t FindRoot( std::vector<uint32_t>& parents, uint32_t v )
+{
+    while( parents[v] != v ){
+        parents[v] = parents[parents[v]];
+        v = parents[v];
+    }
+    return v;
+}
+
+class GridBuilder
+{
+public:
+    GridBuilder( const std::vector<Sdf::Vec3f>& vertices, const std::vector<Sdf::Triangle>& triangles,
+                 const Sdf::SdfOptions& options, Sdf::Grid& grid ) :
+        vertices_( vertices ),
+        triangles_( triangles ),
+        options_( options ),
+        threads_( WorkerCount( options.threads ) ),
+        grid_( grid ),
+        bvh_( vertices, triangles ),
+        band_limit_( std::max( options.innerband, options.outerband ) + options.dx ),
+        diagonal_( std::sqrt( 3.0f ) * options.dx )
+    {}
+
+    void Build()
+    {
+        Allocate();
+        Seed();
+        // Two rounds of the eight sweep directions settle the bands
+        for( uint8_t sweep = 1; sweep <= 16; ++sweep ){
+            const int direction = ( sweep - 1 ) % 8;
+            Sweep( sweep, direction & 1 ? -1 : 1, direction & 2 ? -1 : 1, direction & 4 ? -1 : 1 );
+        }
+        Sign();
+    }
+
+private:
+    Sdf::Vec3f Position( uint32_t i, uint32_t j, uint32_t k ) const
+    {
+        return Sdf::Vec3f{{ grid_.origin[0] + i * grid_.dx, grid_.origin[1] + j * grid_.dx, grid_.origin[2] + k * grid_.dx }};
+    }
+
+    void Allocate()
+    {
+        Sdf::Vec3f lo = {{ FAR, FAR, FAR }};
+        Sdf::Vec3f hi = {{ -FAR, -FAR, -FAR }};
+        for( const auto& triangle : triangles_ )
+            for( uint32_t corner : triangle )
+                for( int axis = 0; axis < 3; ++axis ){
+                    lo[axis] = std::min( lo[axis], vertices_[corner][axis] );
+                    hi[axis] = std::max( hi[axis], vertices_[corner][axis] );
+                }
+
+        // Room for the outer band, and a sample past it
+        const float padding = options_.outerband + 2 * options_.dx;
+        double samples = 1;
+        for( int axis = 0; axis < 3; ++axis ){
+            grid_.origin[axis] = lo[axis] - padding;
+            const double extent = std::ceil( ( hi[axis] + padding - grid_.origin[axis] ) / options_.dx ) + 1;
+            samples *= extent;
+            grid_.size[axis] = uint32_t( std::min( extent, double( MAX_SAMPLES ) ) );
+        }
+        grid_.dx = options_.dx;
+        if( samples > double( MAX_SAMPLES ) )
+            throw std::runtime_error( "SDF grid of " + std::to_string( grid_.size[0] ) + "x" + std::to_string( grid_.size[1] ) +
+                                      "x" + std::to_string( grid_.size[2] ) + " samples is too large, increase dx" );
+
+        grid_.values.assign( grid_.NumSamples(), FAR );
+        closest_.assign( grid_.NumSamples(), -1 );
+        exact_.assign( grid_.NumSamples(), 0 );
+        changed_in_.assign( grid_.NumSamples(), 0 );
+    }
+
+    // Exact distances for the samples around every triangle
+    void Seed()
+    {
+        std::vector<uint8_t> near( grid_.NumSamples(), 0 );
+        for( const auto& triangle : triangles_ ){
+            uint32_t from[3], to[3];
+            for( int axis = 0; axis < 3; ++axis ){
+                float lo = FAR, hi = -FAR;
+                for( uint32_t corner : triangle ){
+                    lo = std::min( lo, vertices_[corner][axis] );
+                    hi = std::max( hi, vertices_[corner][axis] );
+                }
+                const int first = int( std::floor( ( lo - grid_.origin[axis] ) / grid_.dx ) ) - 1;
+                const int last = int( std::ceil( ( hi - grid_.origin[axis] ) / grid_.dx ) ) + 1;
+                from[axis] = uint32_t( std::max( first, 0 ) );
+                to[axis] = uint32_t( std::min( last, int( grid_.size[axis] ) - 1 ) );
+            }
+            for( uint32_t k = from[2]; k <= to[2]; ++k )
+                for( uint32_t j = from[1]; j <= to[1]; ++j )
+                    std::fill( near.begin() + grid_.Index( from[0], j, k ), near.begin() + grid_.Index( to[0], j, k ) + 1, 1 );
+        }
+
+        // Anything closer than the seed radius is found, so seeds are exact
+        const float seed_radius = 2 * grid_.dx;
+        ParallelFor( grid_.size[2], threads_, [&]( size_t k_begin, size_t k_end ){
+            for( uint32_t k = uint32_t( k_begin ); k < k_end; ++k )
+                for( uint32_t j = 0; j < grid_.size[1]; ++j )
+                    for( uint32_t i = 0; i < grid_.size[0]; ++i ){
+                        const size_t index = grid_.Index( i, j, k );
+                        if( !near[index] )
+                            continue;
+                        const Sdf::TriangleBvh::Hit hit = bvh_.Closest( Position( i, j, k ), seed_radius );
+                        if( hit.triangle >= 0 ){
+                            grid_.values[index] = std::sqrt( hit.distance_squared );
+                            closest_[index] = hit.triangle;
+                            exact_[index] = 1;
+                        }
+                    }
+        });
+    }
+
+    void Propagate( uint8_t sweep, const Sdf::Vec3f& position, size_t index, size_t neighbour )
+    {
+        const int triangle = closest_[neighbour];
+        if( triangle < 0 || triangle == closest_[index] || grid_.values[neighbour] > band_limit_ )
+            return;
+        // The same sweep of the first round saw what hasn't changed since
+        if( sweep > 8 && changed_in_[neighbour] <= sweep - 8 )
+            return;
+        // Neighbours are at most a sample diagonal apart, so a triangle that
+        // far behind the current one can't win
+        if( grid_.values[neighbour] - diagonal_ >= grid_.values[index] )
+            return;
+        const float distance = std::sqrt( bvh_.DistanceSquaredTo( position, uint32_t( triangle ) ) );
+        if( distance < grid_.values[index] ){
+            grid_.values[index] = distance;
+            closest_[index] = triangle;
+            changed_in_[index] = sweep;
+        }
+    }
+
+    // Hands the closest triangle of the samples behind each sample, in one
+    // of the eight diagonal directions, on to it
+    void Sweep( uint8_t sweep, int di, int dj, int dk )
+    {
+        const int ni = int( grid_.size[0] ), nj = int( grid_.size[1] ), nk = int( grid_.size[2] );
+        const int i0 = di > 0 ? 1 : ni - 2, i1 = di > 0 ? ni : -1;
+        const int j0 = dj > 0 ? 1 : nj - 2, j1 = dj > 0 ? nj : -1;
+        const int k0 = dk > 0 ? 1 : nk - 2, k1 = dk > 0 ? nk : -1;
+        for( int k = k0; k != k1; k += dk )
+            for( int j = j0; j != j1; j += dj )
+                for( int i = i0; i != i1; i += di ){
+                    const size_t index = grid_.Index( i, j, k );
+                    if( exact_[index] )
+                        continue;
+                    const Sdf::Vec3f position = Position( i, j, k );
+                    Propagate( sweep, position, index, grid_.Index( i - di, j, k ) );
+                    Propagate( sweep, position, index, grid_.Index( i, j - dj, k ) );
+                    Propagate( sweep, position, index, grid_.Index( i - di, j - dj, k ) );
+                    Propagate( sweep, position, index, grid_.Index( i, j, k - dk ) );
+                    Propagate( sweep, position, index, grid_.Index( i - di, j, k - dk ) );
+                    Propagate( sweep, position, index, grid_.Index( i, j - dj, k - dk ) );
+                    Propagate( sweep, position, index, grid_.Index( i - di, j - dj, k - dk ) );
+                }
+    }
+
+    // Counts the crossings of the mesh along +x up to every sample; an odd
+    // count is inside. Every thread owns some z slices of the grid.
+    void Sign()
+    {
+        ParallelFor( grid_.size[2], threads_, [&]( size_t k_begin, size_t k_end ){
+            std::vector<uint8_t> parity( grid_.size[0] * grid_.size[1] * ( k_end - k_begin ), 0 );
+            auto parity_index = [&]( uint32_t i, uint32_t j, uint32_t k ){
+                return ( size_t( k - k_begin ) * grid_.size[1] + j ) * grid_.size[0] + i;
+            };
+
+            for( const auto& triangle : triangles_ ){
+                double x[3], y[3], z[3];
+                for( int corner = 0; corner < 3; ++corner ){
+                    const Sdf::Vec3f& v = vertices_[triangle[corner]];
+                    x[corner] = double( v[0] - grid_.origin[0] ) / grid_.dx;
+                    y[corner] = double( v[1] - grid_.origin[1] ) / grid_.dx;
+                    z[corner] = double( v[2] - grid_.origin[2] ) / grid_.dx;
+                }
+                const int j_from = std::max( 0, int( std::ceil( std::min( { y[0], y[1], y[2] } ) ) ) );
+                const int j_to = std::min( int( grid_.size[1] ) - 1, int( std::floor( std::max( { y[0], y[1], y[2] } ) ) ) );
+                const int k_from = std::max( int( k_begin ), int( std::ceil( std::min( { z[0], z[1], z[2] } ) ) ) );
+                const int k_to = std::min( int( k_end ) - 1, int( std::floor( std::max( { z[0], z[1], z[2] } ) ) ) );
+                for( int k = k_from; k <= k_to; ++k )
+                    for( int j = j_from; j <= j_to; ++j ){
+                        double a, b, c;
+                        if( !PointInTriangle2D( j, k, y[0], z[0], y[1], z[1], y[2], z[2], a, b, c ) )
+                            continue;
+                        // Samples from the crossing on are past it
+                        const double crossing = a * x[0] + b * x[1] + c * x[2];
+                        const int i = std::max( 0, int( std::ceil( crossing ) ) );
+                        if( i < int( grid_.size[0] ) )
+                            parity[parity_index( i, j, k )] ^= 1;
+                    }
+            }
+
+            for( uint32_t k = uint32_t( k_begin ); k < k_end; ++k )
+                for( uint32_t j = 0; j < grid_.size[1]; ++j ){
+                    uint8_t inside = 0;
+                    for( uint32_t i = 0; i < grid_.size[0]; ++i ){
+                        inside ^= parity[parity_index( i, j, k )];
+                        if( inside )
+                            grid_.values[grid_.Index( i, j, k )] = -grid_.values[grid_.Index( i, j, k )];
+                    }
+                }
+        });
+    }
+
+    const std::vector<Sdf::Vec3f>& vertices_;
+    const std::vector<Sdf::Triangle>& triangles_;
+    const Sdf::SdfOptions& options_;
+    const unsigned threads_;
+    Sdf::Grid& grid_;
+    const Sdf::TriangleBvh bvh_;
+    const float band_limit_;
+    const float diagonal_;
+    std::vector<int32_t> closest_;
+    // Seeded samples, which sweeps can't improve
+    std::vector<uint8_t> exact_;
+    // Last sweep that improved each sample, 0 for none
+    std::vector<uint8_t> changed_in_;
+};
+
+}
+
+
+namespace Sdf
+{
+
+std::vector< std::vector<Triangle> > ConnectedParts( const std::vector<Triangle>& triangles )
+{
+    uint32_t num_vertices = 0;
+    for( const auto& triangle : triangles )
+        for( uint32_t corner : triangle )
+            num_vertices = std::max( num_vertices, corner + 1 );
+
+    std::vector<uint32_t> parents( num_vertices );
+    std::iota( parents.begin(), parents.end(), 0u );
+    for( const auto& triangle : triangles )
+        for( int corner = 1; corner < 3; ++corner ){
+            const uint32_t a = FindRoot( parents, triangle[0] );
+            const uint32_t b = FindRoot( parents, triangle[corner] );
+            if( a != b )
+                parents[std::max( a, b )] = std::min( a, b );
+        }
+
+    // Parts in the order of their first triangle
+    std::vector<int> part_of_root( num_vertices, -1 );
+    std::vector< std::vector<Triangle> > parts;
+    for( const auto& triangle : triangles ){
+        const uint32_t root = FindRoot( parents, triangle[0] );
+        if( part_of_root[root] < 0 ){
+            part_of_root[root] = int( parts.size() );
+            parts.emplace_back();
+        }
+        parts[part_of_root[root]].push_back( triangle );
+    }
+    return parts;
+}
+
+Grid BuildGrid( const std::vector<Vec3f>& vertices, const std::vector<Triangle>& triangles,
+                const SdfOptions& options )
+{
+    if( !( options.dx > 0 ) || !( options.innerband >= 0 ) || !( options.outerband >= 0 ) )
+        throw std::invalid_argument( "SDF options need dx > 0 and non negative bands" );
+    if( triangles.empty() )
+        throw std::invalid_argument( "SDF of a mesh without triangles" );
+    for( const auto& triangle : triangles )
+        for( uint32_t corner : triangle )
+            if( corner >= vertices.size() )
+                throw std::invalid_argument( "SDF mesh triangle refers to a missing vertex" );
+
+    Grid grid;
+    GridBuilder( vertices, triangles, options, grid ).Build();
+    return grid;
+}
+
+}
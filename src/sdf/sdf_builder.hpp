@@ -0,0 +1,54 @@
+#ifndef SDF_BUILDER_HPP_
+#define SDF_BUILDER_HPP_
+
+#pragma once
+
+#include "triangle_bvh.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+namespace Sdf
+{
+    struct SdfOptions {
+        float dx = 0;           // sample spacing
+        float innerband = 0;    // depth inside the surface distances are kept to
+        float outerband = 0;    // distance outside the surface they are kept to
+        unsigned threads = 0;   // 0 for one per core
+    };
+
+    // Signed distances sampled on a regular grid, negative inside. Samples
+    // past the bands only carry the sign.
+    struct Grid {
+        uint32_t size[3] = {0, 0, 0};
+        Vec3f origin = {{0, 0, 0}};     // position of sample (0,0,0)
+        float dx = 0;
+        std::vector<float> values;      // x varies fastest
+
+        size_t Index( uint32_t i, uint32_t j, uint32_t k ) const
+        {
+            return ( size_t( k ) * size[1] + j ) * size[0] + i;
+        }
+        size_t NumSamples() const
+        {
+            return size_t( size[0] ) * size[1] * size[2];
+        }
+    };
+
+    // Groups triangles sharing vertices, one list per connected part
+    std::vector< std::vector<Triangle> > ConnectedParts( const std::vector<Triangle>& triangles );
+
+    // Narrow band signed distance of a closed mesh. Distances are exact
+    // within a couple of samples of the surface, from closest triangle
+    // queries, and propagated across the bands by fast sweeping; signs come
+    // from ray parity, so holes in the mesh make them unreliable. The grid
+    // covers the mesh and the outer band. Throws std::invalid_argument for
+    // bad options and std::runtime_error if the grid would be too large.
+    Grid BuildGrid( const std::vector<Vec3f>& vertices, const std::vector<Triangle>& triangles,
+                    const SdfOptions& options );
+}
+
+
+#endif
@@ -0,0 +1,286 @@
+#include "sdf_codec.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+
+namespace {
+
+const char DENSE_MAGIC[4] = { 'S', 'D', 'F', 'D' };
+const char SPARSE_MAGIC[4] = { 'S', 'D', 'F', 'B' };
+const size_t HEADER_SIZE = sizeof( DENSE_MAGIC ) + 3 * sizeof( uint32_t ) + 3 * sizeof( float );
+const size_t SPARSE_HEADER_SIZE = HEADER_SIZE + 2 * sizeof( uint32_t );
+
+bool HasMagic( const ARCSim::SdfT& sdf, const char* magic )
+{
+    return sdf.data.size() >= HEADER_SIZE && std::memcmp( sdf.data.data(), magic, 4 ) == 0;
+}
+
+void WriteHeader( uint8_t* out, const char* magic, const uint32_t size[3], const float origin[3] )
+{
+    std::memcpy( out, magic, 4 );
+    std::memcpy( out + 4, size, 3 * sizeof( uint32_t ) );
+    std::memcpy( out + 16, origin, 3 * sizeof( float ) );
+}
+
+void ReadHeader( const ARCSim::SdfT& sdf, uint32_t size[3], float origin[3] )
+{
+    std::memcpy( size, sdf.data.data() + 4, 3 * sizeof( uint32_t ) );
+    std::memcpy( origin, sdf.data.data() + 16, 3 * sizeof( float ) );
+}
+
+double Volume( const uint32_t size[3] )
+{
+    return double( size[0] ) * size[1] * size[2];
+}
+
+// Header fields of sparse data, checked against its size
+struct SparseLayout {
+    uint32_t size[3];
+    float origin[3];
+    uint32_t brick_size;
+    uint32_t num_bricks;
+    uint32_t bricks[3];
+    size_t num_slots;
+    size_t brick_volume;
+};
+
+SparseLayout ReadSparseLayout( const ARCSim::SdfT& sdf )
+{
+    if( !HasMagic( sdf, SPARSE_MAGIC ) || sdf.data.size() < SPARSE_HEADER_SIZE )
+        throw std::invalid_argument( "SDF data is not a sparse grid" );
+
+    SparseLayout layout;
+    ReadHeader( sdf, layout.size, layout.origin );
+    std::memcpy( &layout.brick_size, sdf.data.data() + HEADER_SIZE, sizeof( uint32_t ) );
+    std::memcpy( &layout.num_bricks, sdf.data.data() + HEADER_SIZE + sizeof( uint32_t ), sizeof( uint32_t ) );
+    if( layout.brick_size == 0 || layout.brick_size > 64 )
+        throw std::invalid_argument( "SDF brick size is out of range" );
+
+    double slots = 1;
+    for( int axis = 0; axis < 3; ++axis ){
+        layout.bricks[axis] = ( layout.size[axis] + layout.brick_size - 1 ) / layout.brick_size;
+        slots *= layout.bricks[axis];
+    }
+    layout.brick_volume = size_t( layout.brick_size ) * layout.brick_size * layout.brick_size;
+    const double expected = SPARSE_HEADER_SIZE + slots * sizeof( uint32_t ) + double( layout.num_bricks ) * layout.brick_volume;
+    if( double( sdf.data.size() ) != expected )
+        throw std::invalid_argument( "SDF data size does not match its bricks" );
+    layout.num_slots = size_t( slots );
+    return layout;
+}
+
+std::unique_ptr<ARCSim::SdfT> WithBandsOf( const ARCSim::SdfT& sdf )
+{
+    std::unique_ptr<ARCSim::SdfT> copy( new ARCSim::SdfT() );
+    copy->dx = sdf.dx;
+    copy->innerband = sdf.innerband;
+    copy->outerband = sdf.outerband;
+    return copy;
+}
+
+}
+
+
+namespace Sdf
+{
+
+std::unique_ptr<ARCSim::SdfT> PackDense( const Grid& grid, float innerband, float outerband )
+{
+    const float range = innerband + outerband;
+    if( !( range > 0 ) )
+        throw std::invalid_argument( "SDF bands must not both be empty" );
+
+    std::unique_ptr<ARCSim::SdfT> sdf( new ARCSim::SdfT() );
+    sdf->dx = grid.dx;
+    sdf->innerband = innerband;
+    sdf->outerband = outerband;
+    sdf->data.resize( HEADER_SIZE + grid.NumSamples() );
+    WriteHeader( sdf->data.data(), DENSE_MAGIC, grid.size, grid.origin.data() );
+    uint8_t* out = sdf->data.data() + HEADER_SIZE;
+
+    const float scale = 255.0f / range;
+    for( size_t s = 0; s < grid.NumSamples(); ++s ){
+        const float level = ( std::min( std::max( grid.values[s], -innerband ), outerband ) + innerband ) * scale;
+        out[s] = uint8_t( std::lround( level ) );
+    }
+    return sdf;
+}
+
+bool IsDense( const ARCSim::SdfT& sdf )
+{
+    return HasMagic( sdf, DENSE_MAGIC );
+}
+
+bool IsSparse( const ARCSim::SdfT& sdf )
+{
+    return HasMagic( sdf, SPARSE_MAGIC );
+}
+
+Grid UnpackDense( const ARCSim::SdfT& sdf )
+{
+    if( !IsDense( sdf ) )
+        throw std::invalid_argument( "SDF data is not a dense grid" );
+
+    Grid grid;
+    ReadHeader( sdf, grid.size, grid.origin.data() );
+    grid.dx = sdf.dx;
+    if( double( sdf.data.size() - HEADER_SIZE ) != Volume( grid.size ) )
+        throw std::invalid_argument( "SDF data size does not match its grid" );
+    const uint8_t* in = sdf.data.data() + HEADER_SIZE;
+
+    const float step = ( sdf.innerband + sdf.outerband ) / 255.0f;
+    grid.values.resize( grid.NumSamples() );
+    for( size_t s = 0; s < grid.NumSamples(); ++s )
+        grid.values[s] = -sdf.innerband + in[s] * step;
+    return grid;
+}
+
+std::unique_ptr<ARCSim::SdfT> ToSparse( const ARCSim::SdfT& sdf )
+{
+    if( IsSparse( sdf ) ){
+        // Only copied, but checked through a view down to its slots
+        const SdfView sparse( sdf );
+        std::unique_ptr<ARCSim::SdfT> copy = WithBandsOf( sdf );
+        copy->data = sdf.data;
+        return copy;
+    }
+
+    // Read through a view, which checks the dense data
+    const SdfView dense( sdf );
+    uint32_t size[3];
+    float origin[3];
+    ReadHeader( sdf, size, origin );
+
+    const uint32_t brick_size = SPARSE_BRICK_SIZE;
+    const size_t brick_volume = size_t( brick_size ) * brick_size * brick_size;
+    uint32_t bricks[3];
+    for( int axis = 0; axis < 3; ++axis )
+        bricks[axis] = ( size[axis] + brick_size - 1 ) / brick_size;
+
+    std::vector<uint32_t> slots( size_t( bricks[0] ) * bricks[1] * bricks[2] );
+    std::vector<uint8_t> samples;
+    std::vector<uint8_t> brick( brick_volume );
+    size_t slot = 0;
+    for( uint32_t bk = 0; bk < bricks[2]; ++bk )
+        for( uint32_t bj = 0; bj < bricks[1]; ++bj )
+            for( uint32_t bi = 0; bi < bricks[0]; ++bi, ++slot ){
+                size_t s = 0;
+                for( uint32_t k = 0; k < brick_size; ++k )
+                    for( uint32_t j = 0; j < brick_size; ++j )
+                        for( uint32_t i = 0; i < brick_size; ++i, ++s )
+                            brick[s] = dense.Sample( std::min( bi * brick_size + i, size[0] - 1 ),
+                                                     std::min( bj * brick_size + j, size[1] - 1 ),
+                                                     std::min( bk * brick_size + k, size[2] - 1 ) );
+
+                // Bricks wholly inside or outside the bands come out uniform
+                if( std::all_of( brick.begin(), brick.end(), [&]( uint8_t v ){ return v == brick[0]; } ) ){
+                    slots[slot] = UNIFORM_SLOT + brick[0];
+                    continue;
+                }
+                slots[slot] = uint32_t( samples.size() / brick_volume );
+                samples.insert( samples.end(), brick.begin(), brick.end() );
+            }
+
+    const size_t sparse_size = SPARSE_HEADER_SIZE + slots.size() * sizeof( uint32_t ) + samples.size();
+    std::unique_ptr<ARCSim::SdfT> sparse = WithBandsOf( sdf );
+    if( sparse_size >= sdf.data.size() ){
+        sparse->data = sdf.data;
+        return sparse;
+    }
+
+    const uint32_t num_bricks = uint32_t( samples.size() / brick_volume );
+    sparse->data.resize( sparse_size );
+    uint8_t* out = sparse->data.data();
+    WriteHeader( out, SPARSE_MAGIC, size, origin );
+    std::memcpy( out + HEADER_SIZE, &brick_size, sizeof( uint32_t ) );
+    std::memcpy( out + HEADER_SIZE + sizeof( uint32_t ), &num_bricks, sizeof( uint32_t ) );
+    out += SPARSE_HEADER_SIZE;
+    std::memcpy( out, slots.data(), slots.size() * sizeof( uint32_t ) );
+    out += slots.size() * sizeof( uint32_t );
+    if( !samples.empty() )
+        std::memcpy( out, samples.data(), samples.size() );
+    return sparse;
+}
+
+std::unique_ptr<ARCSim::SdfT> ToDense( const ARCSim::SdfT& sdf )
+{
+    const SdfView view( sdf );
+    std::unique_ptr<ARCSim::SdfT> dense = WithBandsOf( sdf );
+    if( IsDense( sdf ) ){
+        dense->data = sdf.data;
+        return dense;
+    }
+
+    uint32_t size[3];
+    float origin[3];
+    ReadHeader( sdf, size, origin );
+    dense->data.resize( HEADER_SIZE + size_t( Volume( size ) ) );
+    WriteHeader( dense->data.data(), DENSE_MAGIC, size, origin );
+    uint8_t* out = dense->data.data() + HEADER_SIZE;
+    for( uint32_t k = 0; k < size[2]; ++k )
+        for( uint32_t j = 0; j < size[1]; ++j )
+            for( uint32_t i = 0; i < size[0]; ++i )
+                *out++ = view.Sample( i, j, k );
+    return dense;
+}
+
+
+SdfView::SdfView( const ARCSim::SdfT& sdf ) :
+    dx_( sdf.dx ),
+    innerband_( sdf.innerband ),
+    step_( ( sdf.innerband + sdf.outerband ) / 255.0f )
+{
+    if( IsDense( sdf ) ){
+        ReadHeader( sdf, size_, origin_.data() );
+        if( double( sdf.data.size() - HEADER_SIZE ) != Volume( size_ ) )
+            throw std::invalid_argument( "SDF data size does not match its grid" );
+        dense_ = sdf.data.data() + HEADER_SIZE;
+        return;
+    }
+
+    const SparseLayout layout = ReadSparseLayout( sdf );
+    std::copy( layout.size, layout.size + 3, size_ );
+    std::copy( layout.origin, layout.origin + 3, origin_.begin() );
+    brick_size_ = layout.brick_size;
+    brick_volume_ = layout.brick_volume;
+    std::copy( layout.bricks, layout.bricks + 3, bricks_ );
+
+    // Copied out, the slots in data may not be aligned
+    slots_.resize( layout.num_slots );
+    std::memcpy( slots_.data(), sdf.data.data() + SPARSE_HEADER_SIZE, layout.num_slots * sizeof( uint32_t ) );
+    for( uint32_t slot : slots_ )
+        if( slot < UNIFORM_SLOT && slot >= layout.num_bricks )
+            throw std::invalid_argument( "SDF slot refers to a missing brick" );
+    samples_ = sdf.data.data() + SPARSE_HEADER_SIZE + layout.num_slots * sizeof( uint32_t );
+}
+
+float SdfView::Distance( const Vec3f& position ) const
+{
+    float cell[3];
+    uint32_t lo[3];
+    for( int axis = 0; axis < 3; ++axis ){
+        const float x = ( position[axis] - origin_[axis] ) / dx_;
+        if( size_[axis] == 0 || !( x >= 0 ) || x > float( size_[axis] - 1 ) )
+            return -innerband_ + 255 * step_;
+        lo[axis] = std::min( uint32_t( x ), size_[axis] > 1 ? size_[axis] - 2 : 0 );
+        cell[axis] = x - lo[axis];
+    }
+    const uint32_t hi[3] = { std::min( lo[0] + 1, size_[0] - 1 ),
+                             std::min( lo[1] + 1, size_[1] - 1 ),
+                             std::min( lo[2] + 1, size_[2] - 1 ) };
+
+    float value = 0;
+    for( int corner = 0; corner < 8; ++corner ){
+        const float weight = ( corner & 1 ? cell[0] : 1 - cell[0] ) *
+                             ( corner & 2 ? cell[1] : 1 - cell[1] ) *
+                             ( corner & 4 ? cell[2] : 1 - cell[2] );
+        if( weight > 0 )
+            value += weight * Distance( corner & 1 ? hi[0] : lo[0], corner & 2 ? hi[1] : lo[1], corner & 4 ? hi[2] : lo[2] );
+    }
+    return value;
+}
+
+}
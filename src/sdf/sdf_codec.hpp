@@ -0,0 +1,106 @@
+#ifndef SDF_CODEC_HPP_
+#define SDF_CODEC_HPP_
+
+#pragma once
+
+#include "sdf_builder.hpp"
+#include <translation/arcsim_serializers.hpp>
+
+#include <memory>
+#include <vector>
+
+
+// Layouts of SdfT::data. Both start with a header of
+//
+//     char     magic[4]    "SDFD" for dense, "SDFB" for sparse
+//     uint32_t size[3]     samples along x, y and z
+//     float    origin[3]   position of the first sample
+//
+// Samples are bytes mapping linearly onto distances, 0 to -innerband and 255
+// to outerband; samples past the bands are clamped. Everything is little
+// endian; the spacing is SdfT::dx.
+//
+// Dense data follows the header with one byte per sample, x varying fastest.
+//
+// Sparse data cuts the grid into bricks of brick_size^3 samples and only
+// stores those the surface bands go through:
+//
+//     uint32_t brick_size
+//     uint32_t num_bricks
+//     uint32_t slots[]     one per brick of the grid, x varying fastest
+//     uint8_t  bricks[]    num_bricks * brick_size^3 samples
+//
+// A slot is either the index of a stored brick or UNIFORM_SLOT plus the
+// value every sample of the brick has. Bricks on the far sides of the grid
+// repeat its last samples.
+namespace Sdf
+{
+    enum : uint32_t {
+        SPARSE_BRICK_SIZE = 8,
+        UNIFORM_SLOT = 0xffffff00
+    };
+
+    // Throws std::invalid_argument if both bands are empty
+    std::unique_ptr<ARCSim::SdfT> PackDense( const Grid& grid, float innerband, float outerband );
+
+    // Dequantized distances. Throws std::invalid_argument if data isn't laid
+    // out as above.
+    Grid UnpackDense( const ARCSim::SdfT& sdf );
+
+    bool IsDense( const ARCSim::SdfT& sdf );
+    bool IsSparse( const ARCSim::SdfT& sdf );
+
+    // Lossless conversions between the layouts, which take either one.
+    // ToSparse keeps the dense layout when bricks wouldn't make it smaller.
+    // Throw std::invalid_argument for malformed data.
+    std::unique_ptr<ARCSim::SdfT> ToSparse( const ARCSim::SdfT& sdf );
+    std::unique_ptr<ARCSim::SdfT> ToDense( const ARCSim::SdfT& sdf );
+
+    // Sample lookups in either layout without expanding it. The SdfT is
+    // referenced and must outlive the view.
+    class SdfView
+    {
+    public:
+        // Throws std::invalid_argument for malformed data
+        explicit SdfView( const ARCSim::SdfT& sdf );
+
+        uint32_t Size( int axis ) const { return size_[axis]; }
+        const Vec3f& Origin() const { return origin_; }
+
+        uint8_t Sample( uint32_t i, uint32_t j, uint32_t k ) const
+        {
+            if( dense_ )
+                return dense_[ ( size_t( k ) * size_[1] + j ) * size_[0] + i ];
+            const uint32_t slot = slots_[ ( size_t( k / brick_size_ ) * bricks_[1] + j / brick_size_ ) * bricks_[0] + i / brick_size_ ];
+            if( slot >= UNIFORM_SLOT )
+                return uint8_t( slot - UNIFORM_SLOT );
+            return samples_[ size_t( slot ) * brick_volume_ +
+                             ( ( k % brick_size_ ) * brick_size_ + j % brick_size_ ) * brick_size_ + i % brick_size_ ];
+        }
+
+        float Distance( uint32_t i, uint32_t j, uint32_t k ) const
+        {
+            return -innerband_ + Sample( i, j, k ) * step_;
+        }
+
+        // Trilinear interpolation; outerband outside the grid
+        float Distance( const Vec3f& position ) const;
+
+    private:
+        uint32_t size_[3];
+        Vec3f origin_;
+        float dx_;
+        float innerband_;
+        float step_;
+
+        const uint8_t* dense_ = {nullptr};
+        uint32_t brick_size_ = {0};
+        size_t brick_volume_ = {0};
+        uint32_t bricks_[3] = {0, 0, 0};
+        std::vector<uint32_t> slots_;
+        const uint8_t* samples_ = {nullptr};
+    };
+}
+
+
+#endif
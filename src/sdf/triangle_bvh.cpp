@@ -0,0 +1,209 @@
+#include "triangle_bvh.hpp"
+
+#include <algorithm>
+#include <limits>
+
+
+namespace {
+
+const uint32_t LEAF_SIZE = 4;
+
+inline Sdf::Vec3f Sub( const Sdf::Vec3f& a, const Sdf::Vec3f& b )
+{
+    return Sdf::Vec3f{{ a[0] - b[0], a[1] - b[1], a[2] - b[2] }};
+}
+
+inline float Dot( const Sdf::Vec3f& a, const Sdf::Vec3f& b )
+{
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+inline Sdf::Vec3f Along( const Sdf::Vec3f& a, const Sdf::Vec3f& ab, float t )
+{
+    return Sdf::Vec3f{{ a[0] + ab[0] * t, a[1] + ab[1] * t, a[2] + ab[2] * t }};
+}
+
+}
+
+
+namespace Sdf
+{
+
+// Ericson, Real-Time Collision Detection 5.1.5: find the Voronoi region of
+// the triangle p falls in and project onto that feature
+Vec3f ClosestPointOnTriangle( const Vec3f& p, const Vec3f& a, const Vec3f& b, const Vec3f& c )
+{
+    const Vec3f ab = Sub( b, a );
+    const Vec3f ac = Sub( c, a );
+    const Vec3f ap = Sub( p, a );
+    const float d1 = Dot( ab, ap );
+    const float d2 = Dot( ac, ap );
+    if( d1 <= 0 && d2 <= 0 )
+        return a;
+
+    const Vec3f bp = Sub( p, b );
+    const float d3 = Dot( ab, bp );
+    const float d4 = Dot( ac, bp );
+    if( d3 >= 0 && d4 <= d3 )
+        return b;
+
+    const float vc = d1 * d4 - d3 * d2;
+    if( vc <= 0 && d1 >= 0 && d3 <= 0 )
+        return Along( a, ab, d1 / ( d1 - d3 ) );
+
+    const Vec3f cp = Sub( p, c );
+    const float d5 = Dot( ab, cp );
+    const float d6 = Dot( ac, cp );
+    if( d6 >= 0 && d5 <= d6 )
+        return c;
+
+    const float vb = d5 * d2 - d1 * d6;
+    if( vb <= 0 && d2 >= 0 && d6 <= 0 )
+        return Along( a, ac, d2 / ( d2 - d6 ) );
+
+    const float va = d3 * d6 - d5 * d4;
+    if( va <= 0 && ( d4 - d3 ) >= 0 && ( d5 - d6 ) >= 0 )
+        return Along( b, Sub( c, b ), ( d4 - d3 ) / ( ( d4 - d3 ) + ( d5 - d6 ) ) );
+
+    // Inside the face; degenerate triangles end up on an edge above
+    const float denom = 1.0f / ( va + vb + vc );
+    const float v = vb * denom;
+    const float w = vc * denom;
+    return Vec3f{{ a[0] + ab[0] * v + ac[0] * w,
+                   a[1] + ab[1] * v + ac[1] * w,
+                   a[2] + ab[2] * v + ac[2] * w }};
+}
+
+TriangleBvh::TriangleBvh( const std::vector<Vec3f>& vertices, const std::vector<Triangle>& triangles ) :
+    vertices_( vertices ),
+    triangles_( triangles )
+{
+    if( triangles_.empty() )
+        return;
+
+    order_.resize( triangles_.size() );
+    centroids_.resize( triangles_.size() );
+    for( uint32_t t = 0; t < triangles_.size(); ++t ){
+        order_[t] = t;
+        for( int axis = 0; axis < 3; ++axis )
+            centroids_[t][axis] = ( vertices_[triangles_[t][0]][axis] +
+                                    vertices_[triangles_[t][1]][axis] +
+                                    vertices_[triangles_[t][2]][axis] ) / 3.0f;
+    }
+    nodes_.reserve( 2 * ( triangles_.size() / LEAF_SIZE + 1 ) );
+    Build( 0, uint32_t( triangles_.size() ) );
+}
+
+uint32_t TriangleBvh::Build( uint32_t begin, uint32_t end )
+{
+    const uint32_t index = uint32_t( nodes_.size() );
+    nodes_.emplace_back();
+
+    Node node;
+    float centroid_lo[3], centroid_hi[3];
+    for( int axis = 0; axis < 3; ++axis ){
+        node.lo[axis] = centroid_lo[axis] = std::numeric_limits<float>::max();
+        node.hi[axis] = centroid_hi[axis] = std::numeric_limits<float>::lowest();
+    }
+    for( uint32_t i = begin; i < end; ++i ){
+        const Triangle& triangle = triangles_[order_[i]];
+        for( int axis = 0; axis < 3; ++axis ){
+            for( int corner = 0; corner < 3; ++corner ){
+                node.lo[axis] = std::min( node.lo[axis], vertices_[triangle[corner]][axis] );
+                node.hi[axis] = std::max( node.hi[axis], vertices_[triangle[corner]][axis] );
+            }
+            centroid_lo[axis] = std::min( centroid_lo[axis], centroids_[order_[i]][axis] );
+            centroid_hi[axis] = std::max( centroid_hi[axis], centroids_[order_[i]][axis] );
+        }
+    }
+
+    if( end - begin <= LEAF_SIZE ){
+        node.first = begin;
+        node.count = end - begin;
+        nodes_[index] = node;
+        return index;
+    }
+
+    // Median split along the widest extent of the centroids
+    int split_axis = 0;
+    for( int axis = 1; axis < 3; ++axis )
+        if( centroid_hi[axis] - centroid_lo[axis] > centroid_hi[split_axis] - centroid_lo[split_axis] )
+            split_axis = axis;
+    const uint32_t middle = begin + ( end - begin ) / 2;
+    std::nth_element( order_.begin() + begin, order_.begin() + middle, order_.begin() + end,
+                      [this, split_axis]( uint32_t a, uint32_t b ){
+                          return centroids_[a][split_axis] < centroids_[b][split_axis];
+                      });
+
+    Build( begin, middle );
+    node.first = Build( middle, end );
+    node.count = 0;
+    nodes_[index] = node;
+    return index;
+}
+
+float TriangleBvh::BoxDistanceSquared( const Node& node, const Vec3f& p ) const
+{
+    float distance_squared = 0;
+    for( int axis = 0; axis < 3; ++axis ){
+        const float outside = std::max( std::max( node.lo[axis] - p[axis], p[axis] - node.hi[axis] ), 0.0f );
+        distance_squared += outside * outside;
+    }
+    return distance_squared;
+}
+
+float TriangleBvh::DistanceSquaredTo( const Vec3f& p, uint32_t triangle ) const
+{
+    const Triangle& corners = triangles_[triangle];
+    return DistanceSquared( p, ClosestPointOnTriangle( p, vertices_[corners[0]], vertices_[corners[1]], vertices_[corners[2]] ) );
+}
+
+TriangleBvh::Hit TriangleBvh::Closest( const Vec3f& p, float max_distance ) const
+{
+    Hit hit;
+    if( nodes_.empty() )
+        return hit;
+
+    float best = max_distance * max_distance;
+    // Median splits keep the depth logarithmic
+    uint32_t stack[128];
+    int top = 0;
+    stack[top++] = 0;
+    while( top > 0 ){
+        const Node& node = nodes_[stack[--top]];
+        if( BoxDistanceSquared( node, p ) > best )
+            continue;
+
+        if( node.count > 0 ){
+            for( uint32_t i = node.first; i < node.first + node.count; ++i ){
+                const Triangle& corners = triangles_[order_[i]];
+                const Vec3f point = ClosestPointOnTriangle( p, vertices_[corners[0]], vertices_[corners[1]], vertices_[corners[2]] );
+                const float distance_squared = DistanceSquared( p, point );
+                if( distance_squared <= best ){
+                    best = distance_squared;
+                    hit.triangle = int( order_[i] );
+                    hit.distance_squared = distance_squared;
+                    hit.point = point;
+                }
+            }
+            continue;
+        }
+
+        // Nearer child on top of the stack
+        const uint32_t left = uint32_t( &node - nodes_.data() ) + 1;
+        const uint32_t right = node.first;
+        const float left_distance = BoxDistanceSquared( nodes_[left], p );
+        const float right_distance = BoxDistanceSquared( nodes_[right], p );
+        if( left_distance < right_distance ){
+            stack[top++] = right;
+            stack[top++] = left;
+        }
+        else{
+            stack[top++] = left;
+            stack[top++] = right;
+        }
+    }
+    return hit;
+}
+
+}
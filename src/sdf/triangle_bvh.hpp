@@ -0,0 +1,70 @@
+#ifndef SDF_TRIANGLE_BVH_HPP_
+#define SDF_TRIANGLE_BVH_HPP_
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+
+namespace Sdf
+{
+    typedef std::array<float, 3> Vec3f;
+    typedef std::array<uint32_t, 3> Triangle;
+
+    // Closest point on the triangle abc to p
+    Vec3f ClosestPointOnTriangle( const Vec3f& p, const Vec3f& a, const Vec3f& b, const Vec3f& c );
+
+    inline float DistanceSquared( const Vec3f& a, const Vec3f& b )
+    {
+        const float dx = a[0] - b[0], dy = a[1] - b[1], dz = a[2] - b[2];
+        return dx * dx + dy * dy + dz * dz;
+    }
+
+    // Bounding volume hierarchy over the triangles of a mesh, for closest
+    // triangle queries. The mesh is referenced, not copied, and must outlive
+    // the hierarchy. Queries are read only and safe from any thread.
+    class TriangleBvh
+    {
+    public:
+        struct Hit {
+            int triangle = -1;      // -1 when nothing is in range
+            float distance_squared = 0;
+            Vec3f point = {{0, 0, 0}};
+        };
+
+        TriangleBvh( const std::vector<Vec3f>& vertices, const std::vector<Triangle>& triangles );
+
+        TriangleBvh( const TriangleBvh& ) = delete;
+        TriangleBvh& operator=( const TriangleBvh& ) = delete;
+
+        // Closest triangle to p no further than max_distance
+        Hit Closest( const Vec3f& p, float max_distance ) const;
+
+        // Distance squared from p to a single triangle of the mesh
+        float DistanceSquaredTo( const Vec3f& p, uint32_t triangle ) const;
+
+    private:
+        // Leaves hold count triangles from first on; inner nodes have their
+        // left child right after them and the right one at first
+        struct Node {
+            float lo[3];
+            float hi[3];
+            uint32_t first;
+            uint32_t count;
+        };
+
+        uint32_t Build( uint32_t begin, uint32_t end );
+        float BoxDistanceSquared( const Node& node, const Vec3f& p ) const;
+
+        const std::vector<Vec3f>& vertices_;
+        const std::vector<Triangle>& triangles_;
+        std::vector<uint32_t> order_;
+        std::vector<Vec3f> centroids_;
+        std::vector<Node> nodes_;
+    };
+}
+
+
+#endif
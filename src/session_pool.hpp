@@ -0,0 +1,178 @@
+#ifndef SESSION_POOL_HPP_
+#define SESSION_POOL_HPP_
+
+#pragma once
+
+#include "arcsim_api.hpp"
+
+#include <array>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cstddef>
+
+// Engine sessions created ahead of the requests that need them, and
+// recycled through reset_session once a request is done with them, so a
+// request doesn't pay for session construction. Also caches the engine's
+// default parameters, which never change for a loaded library.
+//
+// Returned sessions are reset and kept up to each type's capacity; past it,
+// or when the reset fails, they are destroyed. Safe to use from any thread.
+class SessionPool
+{
+public:
+    enum : std::size_t { DEFAULT_CAPACITY = 2 };
+
+    explicit SessionPool( std::shared_ptr<const ArcsimApi> api ) :
+        api_( std::move( api ) ),
+        has_sim_params_( false ),
+        has_meshing_params_( false )
+    {
+        capacity_.fill( DEFAULT_CAPACITY );
+    }
+
+    SessionPool( const SessionPool& ) = delete;
+    SessionPool& operator=( const SessionPool& ) = delete;
+
+    ~SessionPool() { Clear(); }
+
+    // Takes an idle session of the given type, or creates one if none is left
+    ErrorCode Acquire( SessionType type, int* out_handle )
+    {
+        {
+            std::lock_guard<std::mutex> lock( mutex_ );
+            std::deque<int>& idle = idle_.at( type );
+            if( !idle.empty() ){
+                *out_handle = idle.front();
+                idle.pop_front();
+                return ARC_OK;
+            }
+        }
+        if( !api_ || !api_->create_session )
+            return ARC_InternalError;
+        return api_->create_session( api_->api_major, api_->api_minor, type, out_handle );
+    }
+
+    // Hands a session back once nothing refers to it anymore
+    void Release( SessionType type, int handle )
+    {
+        if( api_ && api_->reset_session && api_->reset_session( handle ) == ARC_OK ){
+            std::lock_guard<std::mutex> lock( mutex_ );
+            std::deque<int>& idle = idle_.at( type );
+            if( idle.size() < capacity_.at( type ) ){
+                idle.push_back( handle );
+                return;
+            }
+        }
+        Destroy( handle );
+    }
+
+    // Sets how many idle sessions of a type are kept, and creates them now
+    ErrorCode Warm( SessionType type, std::size_t count )
+    {
+        std::vector<int> surplus;
+        std::size_t missing = 0;
+        {
+            std::lock_guard<std::mutex> lock( mutex_ );
+            capacity_.at( type ) = count;
+            std::deque<int>& idle = idle_.at( type );
+            while( idle.size() > count ){
+                surplus.push_back( idle.back() );
+                idle.pop_back();
+            }
+            missing = count - idle.size();
+        }
+        for( int handle : surplus )
+            Destroy( handle );
+
+        for( ; missing > 0; --missing ){
+            int handle;
+            if( !api_ || !api_->create_session )
+                return ARC_InternalError;
+            const ErrorCode code = api_->create_session( api_->api_major, api_->api_minor, type, &handle );
+            if( code != ARC_OK )
+                return code;
+            std::lock_guard<std::mutex> lock( mutex_ );
+            idle_.at( type ).push_back( handle );
+        }
+        return ARC_OK;
+    }
+
+    std::size_t Idle( SessionType type ) const
+    {
+        std::lock_guard<std::mutex> lock( mutex_ );
+        return idle_.at( type ).size();
+    }
+
+    std::size_t Capacity( SessionType type ) const
+    {
+        std::lock_guard<std::mutex> lock( mutex_ );
+        return capacity_.at( type );
+    }
+
+    // Destroys every idle session
+    void Clear()
+    {
+        std::vector<int> handles;
+        {
+            std::lock_guard<std::mutex> lock( mutex_ );
+            for( std::deque<int>& idle : idle_ ){
+                handles.insert( handles.end(), idle.begin(), idle.end() );
+                idle.clear();
+            }
+        }
+        for( int handle : handles )
+            Destroy( handle );
+    }
+
+    ErrorCode DefaultSimulationParameters( SimParams* params )
+    {
+        std::lock_guard<std::mutex> lock( mutex_ );
+        if( !has_sim_params_ ){
+            if( !api_ || !api_->get_default_simulation_parameters )
+                return ARC_InternalError;
+            const ErrorCode code = api_->get_default_simulation_parameters( &sim_params_ );
+            if( code != ARC_OK )
+                return code;
+            has_sim_params_ = true;
+        }
+        *params = sim_params_;
+        return ARC_OK;
+    }
+
+    ErrorCode DefaultMeshingParameters( MeshingParams* params )
+    {
+        std::lock_guard<std::mutex> lock( mutex_ );
+        if( !has_meshing_params_ ){
+            if( !api_ || !api_->get_default_meshing_parameters )
+                return ARC_InternalError;
+            const ErrorCode code = api_->get_default_meshing_parameters( &meshing_params_ );
+            if( code != ARC_OK )
+                return code;
+            has_meshing_params_ = true;
+        }
+        *params = meshing_params_;
+        return ARC_OK;
+    }
+
+private:
+    void Destroy( int handle )
+    {
+        if( api_ && api_->destroy_session )
+            api_->destroy_session( handle );
+    }
+
+    const std::shared_ptr<const ArcsimApi> api_;
+    // Indexed by SessionType
+    std::array< std::deque<int>, ST_Meshing + 1 > idle_;
+    std::array< std::size_t, ST_Meshing + 1 > capacity_;
+
+    bool has_sim_params_;
+    bool has_meshing_params_;
+    SimParams sim_params_;
+    MeshingParams meshing_params_;
+    mutable std::mutex mutex_;
+};
+
+#endif
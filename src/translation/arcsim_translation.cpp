@@ -6,23 +6,13 @@
 void fillMaps( std::map<std::string, uint32_t>& piece_map,
                std::vector< std::map< std::string, uint32_t> >& curve_map,
                const Geometry::Blob& blob){
-  {      
-      std::string name;
-      std::vector<uint32_t> vertices_ms;
-      for( uint32_t nPiece = 0; nPiece < blob.NumPieces(); ++nPiece ){
-          blob.GetPiece( nPiece, name, vertices_ms );
-          piece_map.insert( std::make_pair( name, nPiece ) );
-      }
-  }
+  for( uint32_t nPiece = 0; nPiece < blob.NumPieces(); ++nPiece )
+      piece_map.insert( std::make_pair( blob.GetPieceName( nPiece ), nPiece ) );
+
   curve_map.resize( blob.NumPieces() );
-  {
-      std::string name;
-      std::vector<uint32_t> vertices_ms;
-      uint32_t piece_id;
-      for( uint32_t nCurve = 0; nCurve < blob.NumCurves(); ++nCurve){
-          blob.GetCurve( nCurve, name, piece_id, vertices_ms );
-          curve_map.at( piece_id ).insert( std::make_pair( name, curve_map.at( piece_id ).size() ));
-      }
+  for( uint32_t nCurve = 0; nCurve < blob.NumCurves(); ++nCurve){
+      const uint32_t piece_id = blob.GetCurvePiece( nCurve );
+      curve_map.at( piece_id ).insert( std::make_pair( blob.GetCurveName( nCurve ), curve_map.at( piece_id ).size() ));
   }
 }
 
@@ -70,28 +60,34 @@ void SaveGeometry( const ARCSim::GeometryT* geometry, Geometry::Blob& blob)
     std::vector< std::array< float, 2 > > materialspace_vertices;
     std::vector< std::array< uint32_t, 3 > > worldspace_faces;
     
-    if( geometry->vertices_ws )
+    if( geometry->vertices_ws ){
+        worldspace_vertices.reserve( geometry->vertices_ws->vertices.size() );
         for( const auto& ws_vert: geometry->vertices_ws->vertices )
-            worldspace_vertices.emplace_back( std::array< float, 3 > { ws_vert.x(), ws_vert.y(), ws_vert.z() } );            
-    if( geometry->vertices_ms )
+            worldspace_vertices.emplace_back( std::array< float, 3 > { ws_vert.x(), ws_vert.y(), ws_vert.z() } );
+    }
+    if( geometry->vertices_ms ){
+        materialspace_vertices.reserve( geometry->vertices_ms->vertices.size() );
         for( const auto& ms_vert: geometry->vertices_ms->vertices )
-            materialspace_vertices.emplace_back( std::array< float, 2 > { ms_vert.u(), ms_vert.v() } );            
-    blob.Set3DVertices( worldspace_vertices );
-    blob.Set2DVertices( materialspace_vertices );
+            materialspace_vertices.emplace_back( std::array< float, 2 > { ms_vert.u(), ms_vert.v() } );
+    }
+    blob.Set3DVertices( std::move( worldspace_vertices ) );
+    blob.Set2DVertices( std::move( materialspace_vertices ) );
     blob.SetNumTexChannels( geometry->texture_channels.size() );
     for( int channel = 0; channel < geometry->texture_channels.size(); ++channel ){
-        materialspace_vertices.clear();
+        std::vector< std::array< float, 2 > > texture_vertices;
+        texture_vertices.reserve( geometry->texture_channels.at(channel)->vertices.size() );
         for( const auto& ms_vert: geometry->texture_channels.at(channel)->vertices )
-            materialspace_vertices.emplace_back( std::array< float, 2 > { ms_vert.u(), ms_vert.v() } );
-        blob.SetTexChannel( channel, materialspace_vertices );
+            texture_vertices.emplace_back( std::array< float, 2 > { ms_vert.u(), ms_vert.v() } );
+        blob.SetTexChannel( channel, std::move( texture_vertices ) );
     }
 
     // Geometry has a richer face description, so we'll just use the worldspace ones..
+    worldspace_faces.reserve( geometry->faces.size() );
     for( const auto& face : geometry->faces ){
         worldspace_faces.emplace_back( std::array< uint32_t, 3 > { face->tri_ws->a(), face->tri_ws->b(), face->tri_ws->c() } );
     }
     
-    blob.SetFaces( worldspace_faces );        
+    blob.SetFaces( std::move( worldspace_faces ) );
 }
 
 void ARCSimTranslation::ConvertToFB( const Geometry::Blob& blob, ARCSim::GarmentFrameT& garmentFrame){
@@ -99,20 +95,127 @@ void ARCSimTranslation::ConvertToFB( const Geometry::Blob& blob, ARCSim::Garment
     garmentFrame.geometry = std::make_unique<ARCSim::GeometryT>();
     LoadGeometry( garmentFrame.geometry.get(), blob );
     for( uint32_t nPiece = 0; nPiece < blob.NumPieces(); ++nPiece ){
-        std::string name;
         std::unique_ptr<ARCSim::PieceMapT> pieceMapT = std::make_unique<ARCSim::PieceMapT>();
-        blob.GetPiece( nPiece, name, pieceMapT->vertices_ms );
-    
-        for( uint32_t nCurve = 0; nCurve < blob.NumCurves(); ++nCurve){
-            std::unique_ptr<ARCSim::CurveMapT> curveMapT = std::make_unique<ARCSim::CurveMapT>();
-            uint32_t piece_id;
-            blob.GetCurve( nCurve, name, piece_id, curveMapT->vertices_ms);
-            if( piece_id != nPiece )
-                continue;
-            pieceMapT->curve_maps.push_back( std::move( curveMapT ) );
-        }
+        const auto piece_vertices = blob.GetPieceVertices( nPiece );
+        pieceMapT->vertices_ms.assign( piece_vertices.begin(), piece_vertices.end() );
         garmentFrame.piece_maps.push_back( std::move( pieceMapT ) );
     }
+
+    // Curves keep their order within each piece
+    for( uint32_t nCurve = 0; nCurve < blob.NumCurves(); ++nCurve){
+        std::unique_ptr<ARCSim::CurveMapT> curveMapT = std::make_unique<ARCSim::CurveMapT>();
+        const auto curve_vertices = blob.GetCurveVertices( nCurve );
+        curveMapT->vertices_ms.assign( curve_vertices.begin(), curve_vertices.end() );
+        garmentFrame.piece_maps.at( blob.GetCurvePiece( nCurve ) )->curve_maps.push_back( std::move( curveMapT ) );
+    }
+}
+
+// The blob arrays are handed to the builder as struct vectors in bulk
+static_assert( sizeof(ARCSim::Vec3) == sizeof(std::array< float, 3 >), "Vec3 must match the blob's 3D vertex layout" );
+static_assert( sizeof(ARCSim::Vec2) == sizeof(std::array< float, 2 >), "Vec2 must match the blob's 2D vertex layout" );
+
+flatbuffers::Offset<ARCSim::Geometry> PackGeometry( flatbuffers::FlatBufferBuilder& fbb, const Geometry::Blob& blob, uint32_t content )
+{
+    // Same creation order as GeometryT::Pack, so the buffers match byte for byte
+    flatbuffers::Offset<ARCSim::WorldSpaceCoordinates> vertices_ws = 0;
+    if( content & ARCSimTranslation::FRAME_POSITIONS ){
+        const auto& vertices_3d = blob.Get3DVertices();
+        vertices_ws = ARCSim::CreateWorldSpaceCoordinates( fbb,
+            vertices_3d.size() ? fbb.CreateVectorOfStructs( reinterpret_cast<const ARCSim::Vec3*>( vertices_3d.data() ), vertices_3d.size() ) : 0 );
+    }
+    if( !( content & ARCSimTranslation::FRAME_TOPOLOGY ) )
+        return ARCSim::CreateGeometry( fbb, vertices_ws );
+
+    flatbuffers::Offset<ARCSim::MaterialSpaceCoordinates> vertices_ms = 0;
+    if( blob.Has2DCoordinates() ){
+        const auto& vertices_2d = blob.Get2DVertices();
+        vertices_ms = ARCSim::CreateMaterialSpaceCoordinates( fbb,
+            vertices_2d.size() ? fbb.CreateVectorOfStructs( reinterpret_cast<const ARCSim::Vec2*>( vertices_2d.data() ), vertices_2d.size() ) : 0 );
+    }
+
+    flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<ARCSim::MaterialSpaceCoordinates>>> texture_channels = 0;
+    const uint32_t n_channels = blob.NumTexChannels();
+    if( n_channels ){
+        std::vector< flatbuffers::Offset<ARCSim::MaterialSpaceCoordinates> > channels;
+        channels.reserve( n_channels );
+        for( uint32_t tChannel = 0; tChannel < n_channels; ++tChannel){
+            const auto channel = blob.GetTexChannelView( tChannel );
+            channels.push_back( ARCSim::CreateMaterialSpaceCoordinates( fbb,
+                channel.size() ? fbb.CreateVectorOfStructs( reinterpret_cast<const ARCSim::Vec2*>( channel.data() ), channel.size() ) : 0 ) );
+        }
+        texture_channels = fbb.CreateVector( channels );
+    }
+
+    flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<ARCSim::Face>>> faces = 0;
+    const auto& blob_faces = blob.GetFaces();
+    if( blob_faces.size() ){
+        std::vector< flatbuffers::Offset<ARCSim::Face> > face_offsets;
+        face_offsets.reserve( blob_faces.size() );
+        std::vector< ARCSim::Triangle > tri_tx_chns( n_channels );
+        for( const auto& face : blob_faces ){
+            const ARCSim::Triangle triangle( face[0], face[1], face[2] );
+            std::fill( tri_tx_chns.begin(), tri_tx_chns.end(), triangle );
+            auto tri_tx = n_channels ? fbb.CreateVectorOfStructs( tri_tx_chns.data(), n_channels ) : 0;
+            face_offsets.push_back( ARCSim::CreateFace( fbb, &triangle, &triangle, tri_tx ) );
+        }
+        faces = fbb.CreateVector( face_offsets );
+    }
+
+    return ARCSim::CreateGeometry( fbb, vertices_ws, vertices_ms, texture_channels, faces );
+}
+
+flatbuffers::Offset<ARCSim::GarmentFrame> ARCSimTranslation::PackGarmentFrame( flatbuffers::FlatBufferBuilder& fbb, const Geometry::Blob& blob,
+                                                                             uint32_t frame, uint32_t subframe, float timestamp,
+                                                                             uint32_t content){
+    auto geometry = PackGeometry( fbb, blob, content );
+    if( !( content & FRAME_TOPOLOGY ) )
+        return ARCSim::CreateGarmentFrame( fbb, geometry, 0, 0, 0, frame, subframe, timestamp );
+
+    // Curves of each piece, in blob order
+    std::vector< std::vector< uint32_t > > piece_curves( blob.NumPieces() );
+    for( uint32_t nCurve = 0; nCurve < blob.NumCurves(); ++nCurve )
+        piece_curves.at( blob.GetCurvePiece( nCurve ) ).push_back( nCurve );
+
+    flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<ARCSim::PieceMap>>> piece_maps = 0;
+    if( blob.NumPieces() ){
+        std::vector< flatbuffers::Offset<ARCSim::PieceMap> > pieces;
+        pieces.reserve( blob.NumPieces() );
+        std::vector< flatbuffers::Offset<ARCSim::CurveMap> > curves;
+        for( uint32_t nPiece = 0; nPiece < blob.NumPieces(); ++nPiece ){
+            const auto piece_vertices = blob.GetPieceVertices( nPiece );
+            auto vertices_ms = piece_vertices.size() ? fbb.CreateVector( piece_vertices.data(), piece_vertices.size() ) : 0;
+
+            curves.clear();
+            for( uint32_t nCurve : piece_curves[nPiece] ){
+                const auto curve_vertices = blob.GetCurveVertices( nCurve );
+                curves.push_back( ARCSim::CreateCurveMap( fbb,
+                    curve_vertices.size() ? fbb.CreateVector( curve_vertices.data(), curve_vertices.size() ) : 0 ) );
+            }
+            pieces.push_back( ARCSim::CreatePieceMap( fbb, vertices_ms, curves.size() ? fbb.CreateVector( curves ) : 0 ) );
+        }
+        piece_maps = fbb.CreateVector( pieces );
+    }
+
+    return ARCSim::CreateGarmentFrame( fbb, geometry, 0, 0, piece_maps, frame, subframe, timestamp );
+}
+
+size_t ARCSimTranslation::EstimateGarmentFrameSize( const Geometry::Blob& blob, uint32_t content ){
+    const size_t n_vertices = blob.NumVertices();
+    const size_t n_channels = blob.NumTexChannels();
+    size_t size = 1024;
+    if( content & FRAME_POSITIONS )
+        size += n_vertices * sizeof(ARCSim::Vec3);
+    if( !( content & FRAME_TOPOLOGY ) )
+        return size;
+    size += n_vertices * ( ( blob.Has2DCoordinates() ? sizeof(ARCSim::Vec2) : 0 ) + n_channels * sizeof(ARCSim::Vec2) );
+    // Face table with its vtable offset and two inline triangles, its offset
+    // in the faces vector, and the texture channel triangles
+    size += size_t(blob.NumFaces()) * ( 40 + ( n_channels ? sizeof(uint32_t) + 2 * sizeof(ARCSim::Triangle) * n_channels : 0 ) );
+    for( uint32_t nPiece = 0; nPiece < blob.NumPieces(); ++nPiece )
+        size += 32 + blob.GetPieceVertices( nPiece ).size() * sizeof(uint32_t);
+    for( uint32_t nCurve = 0; nCurve < blob.NumCurves(); ++nCurve )
+        size += 32 + blob.GetCurveVertices( nCurve ).size() * sizeof(uint32_t);
+    return size;
 }
 
 void ARCSimTranslation::ConvertToFB( const Geometry::Blob& blob, const std::string& json, ARCSim::GarmentT& garment){
@@ -253,12 +356,13 @@ void ARCSimTranslation::ConvertToFB( const Geometry::Blob& blob, const std::stri
           
       
       for( uint32_t nCurve = 0; nCurve < blob.NumCurves(); ++nCurve){
+          if( blob.GetCurvePiece( nCurve ) != nPiece )
+              continue;
           std::unique_ptr<ARCSim::CurveT> curveT = std::make_unique<ARCSim::CurveT>();
           std::unique_ptr<ARCSim::CurveMapT> curveMapT = std::make_unique<ARCSim::CurveMapT>();
-          uint32_t piece_id;
-          blob.GetCurve( nCurve, curveT->name, piece_id, curveMapT->vertices_ms);
-          if( piece_id != nPiece )
-              continue;
+          curveT->name = blob.GetCurveName( nCurve );
+          const auto curve_vertices = blob.GetCurveVertices( nCurve );
+          curveMapT->vertices_ms.assign( curve_vertices.begin(), curve_vertices.end() );
 
           Json::Value curve_root;
           bool curve_found = false;
@@ -509,8 +613,7 @@ void ARCSimTranslation::ConvertFromFB( Geometry::Blob& blob, std::string& json,
         std::cout << "Converting Piece " << piece->name << std::endl;        
         blob.SetNumCurves(curve_index+piece->curves.size());
         std::string piece_name = piece->name;
-        std::vector<uint32_t> piece_vertices = frame.piece_maps.at(piece_index)->vertices_ms;
-        blob.SetPiece( piece_index, piece_name, piece_vertices );
+        blob.SetPiece( piece_index, piece_name, frame.piece_maps.at(piece_index)->vertices_ms );
         Json::Value piece_root;
         piece_root["name"] = piece_name;
         piece_root["grain_direction"][0u] = 0;
@@ -518,8 +621,7 @@ void ARCSimTranslation::ConvertFromFB( Geometry::Blob& blob, std::string& json,
         int piece_curve_index = 0;
         for( const auto& curve: piece->curves ){
             std::string curve_name = curve->name;
-            std::vector<uint32_t> curve_vertices = frame.piece_maps.at(piece_index)->curve_maps.at(piece_curve_index)->vertices_ms;
-            blob.SetCurve( curve_index, curve_name, piece_index, curve_vertices );
+            blob.SetCurve( curve_index, curve_name, piece_index, frame.piece_maps.at(piece_index)->curve_maps.at(piece_curve_index)->vertices_ms );
             curve_index++;
             piece_curve_index++;
         }
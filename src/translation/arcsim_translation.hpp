@@ -20,6 +20,22 @@ public:
     static void ConvertToFB( const Geometry::Blob& blob, const std::string& json, std::vector<std::unique_ptr<ARCSim::ConstraintT> >& constraints);
     static void ConvertToFB( const Geometry::Blob& blob, const std::string& json, ARCSim::ObstacleT& body);
 
+    // Parts of a garment frame PackGarmentFrame writes
+    enum FrameContent : uint32_t {
+        FRAME_POSITIONS = 1,    // world space vertices
+        FRAME_TOPOLOGY = 2,     // faces, material space coordinates, texture channels and piece maps
+        FRAME_ALL = FRAME_POSITIONS | FRAME_TOPOLOGY
+    };
+
+    // Writes a GarmentFrame for the blob straight into the builder, without
+    // going through GarmentFrameT. With FRAME_ALL this produces the same
+    // buffer as packing the result of ConvertToFB( blob, garmentFrame ).
+    static flatbuffers::Offset<ARCSim::GarmentFrame> PackGarmentFrame( flatbuffers::FlatBufferBuilder& fbb, const Geometry::Blob& blob,
+                                                                     uint32_t frame, uint32_t subframe, float timestamp,
+                                                                     uint32_t content = FRAME_ALL);
+    // Builder capacity that fits PackGarmentFrame's output for the blob
+    static size_t EstimateGarmentFrameSize( const Geometry::Blob& blob, uint32_t content = FRAME_ALL );
+
     static void ConvertFromFB( Geometry::Blob& blob, std::string& json, const ARCSim::GarmentT& garment);
     static void ConvertFromFB( Geometry::Blob& blob, std::string& json, const ARCSim::GarmentT& garment, const std::vector<ARCSim::ConstraintT>& constraints);
     static void ConvertFromFB( Geometry::Blob& blob, std::string& json, const ARCSim::ObstacleFrameT& body);
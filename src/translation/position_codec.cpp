@@ -0,0 +1,141 @@
+#include <translation/position_codec.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 )
+#define POSITION_CODEC_SSE2
+#include <emmintrin.h>
+#endif
+
+
+static_assert( sizeof(QuantizedPositionsHeader) == 40, "The JS decoder expects a 40 byte header" );
+
+PackedBuffer PositionCodec::Encode( const float* positions, uint32_t n_vertices, int32_t garment_handle,
+                                    std::vector<uint16_t>* history ){
+    const size_t count = size_t( n_vertices ) * 3;
+    const size_t size = sizeof(QuantizedPositionsHeader) + count * sizeof(uint16_t);
+
+    // Allocated the way the default flatbuffers allocator does, so the
+    // DetachedBuffer can release it
+    uint8_t* buffer = new uint8_t[size];
+    PackedBuffer packed( nullptr, false, buffer, size, buffer, size );
+
+    QuantizedPositionsHeader header;
+    std::memset( &header, 0, sizeof(header) );
+    header.version = VERSION;
+    header.garment_handle = garment_handle;
+    header.vertex_count = n_vertices;
+
+    float max[3];
+    ComputeBounds( positions, n_vertices, header.min, max );
+    for( int c = 0; c < 3; ++c )
+        header.step[c] = ( max[c] - header.min[c] ) / 65535.0f;
+
+    uint16_t* values = reinterpret_cast<uint16_t*>( buffer + sizeof(QuantizedPositionsHeader) );
+    Quantize( positions, n_vertices, header.min, header.step, values );
+
+    if( history ){
+        if( count && history->size() == count ){
+            DeltaEncode( values, history->data(), count );
+            header.flags |= FLAG_DELTA;
+        }
+        else
+            history->assign( values, values + count );
+    }
+
+    std::memcpy( buffer, &header, sizeof(header) );
+    return packed;
+}
+
+void PositionCodec::ComputeBounds( const float* positions, size_t n_vertices, float min[3], float max[3] ){
+    for( int c = 0; c < 3; ++c )
+        min[c] = max[c] = n_vertices ? positions[c] : 0.0f;
+
+    size_t v = 0;
+#ifdef POSITION_CODEC_SSE2
+    // Four vertices are three registers, laid out xyzx yzxy zxyz
+    if( n_vertices >= 4 ){
+        __m128 lo0 = _mm_loadu_ps( positions ), lo1 = _mm_loadu_ps( positions + 4 ), lo2 = _mm_loadu_ps( positions + 8 );
+        __m128 hi0 = lo0, hi1 = lo1, hi2 = lo2;
+        for( v = 4; v + 4 <= n_vertices; v += 4 ){
+            const float* block = positions + 3 * v;
+            const __m128 a0 = _mm_loadu_ps( block ), a1 = _mm_loadu_ps( block + 4 ), a2 = _mm_loadu_ps( block + 8 );
+            lo0 = _mm_min_ps( lo0, a0 ); hi0 = _mm_max_ps( hi0, a0 );
+            lo1 = _mm_min_ps( lo1, a1 ); hi1 = _mm_max_ps( hi1, a1 );
+            lo2 = _mm_min_ps( lo2, a2 ); hi2 = _mm_max_ps( hi2, a2 );
+        }
+
+        float lo[12], hi[12];
+        _mm_storeu_ps( lo, lo0 ); _mm_storeu_ps( lo + 4, lo1 ); _mm_storeu_ps( lo + 8, lo2 );
+        _mm_storeu_ps( hi, hi0 ); _mm_storeu_ps( hi + 4, hi1 ); _mm_storeu_ps( hi + 8, hi2 );
+        for( int i = 0; i < 12; ++i ){
+            min[i % 3] = std::min( min[i % 3], lo[i] );
+            max[i % 3] = std::max( max[i % 3], hi[i] );
+        }
+    }
+#endif
+    for( ; v < n_vertices; ++v ){
+        for( int c = 0; c < 3; ++c ){
+            min[c] = std::min( min[c], positions[3 * v + c] );
+            max[c] = std::max( max[c], positions[3 * v + c] );
+        }
+    }
+}
+
+void PositionCodec::Quantize( const float* positions, size_t n_vertices, const float min[3], const float step[3], uint16_t* out ){
+    float scale[3];
+    for( int c = 0; c < 3; ++c )
+        scale[c] = step[c] > 0.0f ? 1.0f / step[c] : 0.0f;
+
+    const size_t count = n_vertices * 3;
+    size_t i = 0;
+#ifdef POSITION_CODEC_SSE2
+    const __m128 offset[3] = { _mm_setr_ps( min[0], min[1], min[2], min[0] ),
+                               _mm_setr_ps( min[1], min[2], min[0], min[1] ),
+                               _mm_setr_ps( min[2], min[0], min[1], min[2] ) };
+    const __m128 factor[3] = { _mm_setr_ps( scale[0], scale[1], scale[2], scale[0] ),
+                               _mm_setr_ps( scale[1], scale[2], scale[0], scale[1] ),
+                               _mm_setr_ps( scale[2], scale[0], scale[1], scale[2] ) };
+    // SSE2 can only pack with signed saturation, so values are shifted into
+    // the int16 range and shifted back after packing
+    const __m128i bias = _mm_set1_epi32( 32768 );
+    const __m128i sign = _mm_set1_epi16( static_cast<short>( 0x8000 ) );
+
+    // Eight vertices per iteration, which keeps every register on the same
+    // component pattern
+    for( ; i + 24 <= count; i += 24 ){
+        __m128i quantized[6];
+        for( int r = 0; r < 6; ++r ){
+            const __m128 value = _mm_mul_ps( _mm_sub_ps( _mm_loadu_ps( positions + i + 4 * r ), offset[r % 3] ), factor[r % 3] );
+            quantized[r] = _mm_sub_epi32( _mm_cvtps_epi32( value ), bias );
+        }
+        for( int r = 0; r < 3; ++r )
+            _mm_storeu_si128( reinterpret_cast<__m128i*>( out + i + 8 * r ),
+                              _mm_xor_si128( _mm_packs_epi32( quantized[2 * r], quantized[2 * r + 1] ), sign ) );
+    }
+#endif
+    // Rounds to nearest even like _mm_cvtps_epi32, so both paths agree
+    for( ; i < count; ++i ){
+        const long value = std::lrint( ( positions[i] - min[i % 3] ) * scale[i % 3] );
+        out[i] = static_cast<uint16_t>( std::min( std::max( value, 0L ), 65535L ) );
+    }
+}
+
+void PositionCodec::DeltaEncode( uint16_t* values, uint16_t* history, size_t count ){
+    size_t i = 0;
+#ifdef POSITION_CODEC_SSE2
+    for( ; i + 8 <= count; i += 8 ){
+        const __m128i current = _mm_loadu_si128( reinterpret_cast<const __m128i*>( values + i ) );
+        const __m128i previous = _mm_loadu_si128( reinterpret_cast<const __m128i*>( history + i ) );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( history + i ), current );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( values + i ), _mm_sub_epi16( current, previous ) );
+    }
+#endif
+    for( ; i < count; ++i ){
+        const uint16_t current = values[i];
+        values[i] = static_cast<uint16_t>( current - history[i] );
+        history[i] = current;
+    }
+}
@@ -0,0 +1,46 @@
+#ifndef POSITION_CODEC_HPP_
+#define POSITION_CODEC_HPP_
+
+#include <translation/flatbuffer_utils.hpp>
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+
+// Compact encoding of a garment's world space positions for streaming.
+// Every coordinate is quantized to 16 bits across the frame's bounding box,
+// and can then be delta coded against the previous frame's quantized values.
+// The layout is a QuantizedPositionsHeader followed by 3 * vertex_count
+// little endian uint16 values; src/index.js has the matching decoder.
+struct QuantizedPositionsHeader {
+    uint16_t version;
+    uint16_t flags;
+    int32_t garment_handle;
+    uint32_t vertex_count;
+    uint32_t reserved;
+    float min[3];
+    // Size of one quantization step, so position = min + value * step
+    float step[3];
+};
+
+class PositionCodec{
+public:
+    enum : uint16_t { VERSION = 1 };
+    enum Flags : uint16_t { FLAG_DELTA = 1 };
+
+    // Encodes n_vertices xyz positions. With a history, values are delta
+    // coded against it whenever it holds a frame with the same vertex count;
+    // it is then updated to this frame's quantized values.
+    static PackedBuffer Encode( const float* positions, uint32_t n_vertices, int32_t garment_handle,
+                                std::vector<uint16_t>* history );
+
+    static void ComputeBounds( const float* positions, size_t n_vertices, float min[3], float max[3] );
+    static void Quantize( const float* positions, size_t n_vertices, const float min[3], const float step[3], uint16_t* out );
+    // Replaces values by their wrapping difference to history, and history
+    // by the original values
+    static void DeltaEncode( uint16_t* values, uint16_t* history, size_t count );
+};
+
+
+#endif
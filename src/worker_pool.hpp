@@ -0,0 +1,91 @@
+#ifndef WORKER_POOL_HPP_
+#define WORKER_POOL_HPP_
+
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed number of threads running queued jobs in order. The meshing
+// requests of a binding share one, so together they never mesh on more
+// threads than it has. Threads are started with the first job. Jobs must
+// not throw. Safe to use from any thread.
+class WorkerPool
+{
+public:
+    explicit WorkerPool( unsigned threads ) :
+        max_threads_( std::max( 1u, threads ) ),
+        stopped_( false )
+    {}
+
+    WorkerPool( const WorkerPool& ) = delete;
+    WorkerPool& operator=( const WorkerPool& ) = delete;
+
+    ~WorkerPool() { Shutdown(); }
+
+    // Returns false, without running the job, once the pool is shut down
+    bool Post( std::function<void()> job )
+    {
+        {
+            std::lock_guard<std::mutex> lock( mutex_ );
+            if( stopped_ )
+                return false;
+            jobs_.push_back( std::move( job ) );
+            while( threads_.size() < max_threads_ )
+                threads_.emplace_back( [this]{ Run(); } );
+        }
+        job_available_.notify_one();
+        return true;
+    }
+
+    // Drops the jobs that haven't started and waits for the running ones.
+    // Must not be called from a job.
+    void Shutdown()
+    {
+        std::deque< std::function<void()> > dropped;
+        std::vector<std::thread> threads;
+        {
+            std::lock_guard<std::mutex> lock( mutex_ );
+            stopped_ = true;
+            dropped.swap( jobs_ );
+            threads.swap( threads_ );
+        }
+        job_available_.notify_all();
+        for( std::thread& thread : threads )
+            thread.join();
+    }
+
+    unsigned MaxThreads() const { return max_threads_; }
+
+private:
+    void Run()
+    {
+        for(;;){
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock( mutex_ );
+                job_available_.wait( lock, [this]{ return stopped_ || !jobs_.empty(); } );
+                // Shutdown takes the queued jobs along
+                if( jobs_.empty() )
+                    return;
+                job = std::move( jobs_.front() );
+                jobs_.pop_front();
+            }
+            job();
+        }
+    }
+
+    const unsigned max_threads_;
+    std::deque< std::function<void()> > jobs_;
+    std::vector<std::thread> threads_;
+    bool stopped_;
+    std::mutex mutex_;
+    std::condition_variable job_available_;
+};
+
+#endif
@@ -0,0 +1,74 @@
+// Reads frame_ring.bin, a ring FrameRingWriter filled in
+// test/native/frame_ring.cpp: 3 slots of up to 8 vertices and 2 garments,
+// a status, then frames 1 to 4, frame 3 being incomplete.
+const assert = require('assert');
+const fs = require('fs');
+const path = require('path');
+const arcsim = require("../lib/index.js");
+const FrameRingReader = arcsim.FrameRingReader;
+
+// Same as GarmentPositions in frame_ring.cpp
+const garmentPositions = (frame, handle, n_vertices) => {
+    const positions = new Float32Array(n_vertices * 3);
+    for( let i = 0; i < positions.length; ++i )
+        positions[i] = frame * 100 + handle + i * 0.5;
+    return positions;
+};
+
+// The ring as a session would share it
+const fixture = fs.readFileSync(path.join(__dirname, 'frame_ring.bin'));
+const shared = () => {
+    const buffer = new SharedArrayBuffer(fixture.length);
+    new Uint8Array(buffer).set(fixture);
+    return buffer;
+};
+
+assert.strictEqual(FrameRingReader.byteLength(3, 8, 2), fixture.length);
+assert.strictEqual(FrameRingReader.slotSize(8, 2) % FrameRingReader.SLOT_ALIGNMENT, 0);
+
+const reader = new FrameRingReader(shared());
+assert.strictEqual(reader.frames_written(), 4);
+assert.strictEqual(reader.incomplete_frames(), 1);
+assert.deepStrictEqual(reader.status(), { type: 4, state: 2, frame: 5, steps: 50, time: 0.5 });
+
+const frame = reader.latest_frame();
+assert.strictEqual(frame.sequence, 4);
+assert.strictEqual(frame.type, 4);
+assert.strictEqual(frame.frame, 4);
+assert.strictEqual(frame.steps, 40);
+assert.strictEqual(frame.time, 4 * 0.1);
+assert.deepStrictEqual(frame.garments, [ { handle: 11, first_vertex: 0, vertex_count: 3 },
+                                         { handle: 12, first_vertex: 3, vertex_count: 5 } ]);
+assert.deepStrictEqual(Array.from(frame.positions.subarray(0, 9)), Array.from(garmentPositions(4, 11, 3)));
+assert.deepStrictEqual(Array.from(frame.positions.subarray(9)), Array.from(garmentPositions(4, 12, 5)));
+
+// Positions large enough are reused
+const again = reader.latest_frame(frame.positions);
+assert.strictEqual(again.positions.buffer, frame.positions.buffer);
+assert.deepStrictEqual(again.garments, frame.garments);
+
+// Rewound to frame 3, the latest frame is the incomplete one
+const rewound = shared();
+new Int32Array(rewound)[6] = 3;
+assert.strictEqual(new FrameRingReader(rewound).latest_frame(), null);
+
+// Rewound to frame 2, the slot after the one frame 4 reused
+new Int32Array(rewound)[6] = 2;
+const second = new FrameRingReader(rewound).latest_frame();
+assert.strictEqual(second.frame, 2);
+assert.deepStrictEqual(Array.from(second.positions.subarray(9)), Array.from(garmentPositions(2, 12, 2)));
+
+// A writer that never finishes keeps readers out of its seqlocks
+const busy = shared();
+const words = new Int32Array(busy);
+words[8] += 1;
+words[FrameRingReader.HEADER_SIZE / 4] += 1;
+assert.strictEqual(new FrameRingReader(busy).status(), null);
+assert.strictEqual(new FrameRingReader(busy).latest_frame(), null);
+
+// Nothing is read from a ring the session hasn't set up
+const empty = new FrameRingReader(new SharedArrayBuffer(fixture.length));
+assert.strictEqual(empty.status(), null);
+assert.strictEqual(empty.latest_frame(), null);
+
+console.log("frame ring ok");
@@ -0,0 +1,88 @@
+{
+    # Every target is a test program; node-gyp's defaults would make them
+    # addons, so each one sets its type
+    'target_defaults': {
+        'include_dirs': [
+            '../../src'
+        ],
+        'cflags': [
+            '-fexceptions', '-std=c++14', '-frtti'
+        ],
+        'cflags_cc': [
+            '-fexceptions', '-std=c++14', '-frtti'
+        ],
+        # Defaults node-gyp puts after the flags above
+        'cflags_cc!': [
+            '-fno-exceptions', '-fno-rtti', '-std=gnu++17'
+        ],
+        'xcode_settings': {
+            'GCC_ENABLE_CPP_EXCEPTIONS': 'YES',
+            'CLANG_CXX_LIBRARY': 'libc++',
+            'MACOSX_DEPLOYMENT_TARGET': '10.7',
+            'OTHER_CFLAGS': [
+                "-std=c++14",
+                "-stdlib=libc++",
+                "-fexceptions",
+                "-frtti"
+            ]
+        },
+        'msvs_settings': {
+            'VCCLCompilerTool': { 'ExceptionHandling': 1 },
+        },
+        'conditions': [
+            ['OS=="linux"', {
+                'defines': [
+                    'PLATFORM_LINUX',
+                ]
+            }],
+            ['OS=="win"', {
+                'defines': [
+                    'PLATFORM_WINDOWS',
+                    '_HAS_EXCEPTIONS=1'
+                ]
+            }],
+            ['OS=="mac"', {
+                'defines': [
+                    'PLATFORM_OSX',
+                ]
+            }]
+        ]
+    },
+    'targets': [
+        {
+            'target_name': 'blob_format',
+            'type': 'executable',
+            'sources': [ 'blob_format.cpp' ]
+        },
+        {
+            'target_name': 'blob_legacy',
+            'type': 'executable',
+            'sources': [ 'blob_legacy.cpp' ]
+        },
+        {
+            'target_name': 'position_codec',
+            'type': 'executable',
+            'sources': [ 'position_codec.cpp', '../../src/translation/position_codec.cpp' ]
+        },
+        {
+            'target_name': 'delivery_queue',
+            'type': 'executable',
+            'sources': [ 'delivery_queue.cpp' ]
+        },
+        {
+            'target_name': 'frame_ring',
+            'type': 'executable',
+            'sources': [ 'frame_ring.cpp' ]
+        },
+        {
+            'target_name': 'mesh_cache',
+            'type': 'executable',
+            'sources': [ 'mesh_cache.cpp', '../../src/mesh_cache.cpp', '../../src/jsoncpp.cpp' ]
+        },
+        {
+            'target_name': 'sdf_codec',
+            'type': 'executable',
+            'sources': [ 'sdf_codec.cpp', '../../src/sdf/sdf_codec.cpp', '../../src/sdf/sdf_builder.cpp', '../../src/sdf/triangle_bvh.cpp' ]
+        }
+    ]
+}
@@ -0,0 +1,203 @@
+// Blob format 0.4: round trips through Blob and BlobView, and rejection of
+// truncated and corrupt files.
+
+#include "check.hpp"
+
+#include <blob/blob_view.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <sstream>
+#include <vector>
+
+using Geometry::Blob;
+using Geometry::BlobView;
+typedef Geometry::blob_formats::format_0_4 Format;
+
+namespace
+{
+    // Two quads of two triangles each, one per piece, with every kind of
+    // section filled in
+    Blob MakeBlob()
+    {
+        Blob blob;
+        blob.Name() = "garment";
+        blob.Set3DVertices( { {0, 0, 0}, {1, 0, 0}, {1, 1, 0}, {0, 1, 0},
+                              {2, 0, 0}, {3, 0, 0}, {3, 1, 0}, {2, 1, 0} } );
+        blob.Set2DVertices( { {0, 0}, {1, 0}, {1, 1}, {0, 1}, {2, 0}, {3, 0}, {3, 1}, {2, 1} } );
+        blob.SetNumTexChannels( 2 );
+        blob.SetTexChannel( 0, { {0, 0}, {.5f, 0}, {.5f, .5f}, {0, .5f}, {.5f, 0}, {1, 0}, {1, .5f}, {.5f, .5f} } );
+        blob.SetTexChannel( 1, std::vector< std::array<float, 2> >( 8, {{.25f, .75f}} ) );
+        blob.SetFaces( { {0, 1, 2}, {0, 2, 3}, {4, 5, 6}, {4, 6, 7} } );
+        blob.SetNumPieces( 2 );
+        blob.SetPiece( 0, "front", { 0, 1, 2, 3 } );
+        blob.SetPiece( 1, "back", { 4, 5, 6, 7 } );
+        blob.SetNumCurves( 2 );
+        blob.SetCurve( 0, "front border", 0, { 0, 1, 2, 3 } );
+        blob.SetCurve( 1, "back border", 1, { 4, 5, 6, 7 } );
+        blob.SetGeomData( "thickness", true, { 1, 2, 3, 4 } );
+        blob.SetGeomData( "weight", false, { 1, 1, 1, 1, 2, 2, 2, 2 } );
+        return blob;
+    }
+
+    template< typename A, typename B >
+    void CheckSameContents( const A& a, const B& b )
+    {
+        CHECK( a.Name() == b.Name() );
+        CHECK( a.NumVertices() == b.NumVertices() );
+        CHECK( a.NumFaces() == b.NumFaces() );
+        CHECK( a.NumPieces() == b.NumPieces() );
+        CHECK( a.NumCurves() == b.NumCurves() );
+        CHECK( a.NumTexChannels() == b.NumTexChannels() );
+        CHECK( a.Has2DCoordinates() == b.Has2DCoordinates() );
+        CHECK( a.Get3DVertices() == b.Get3DVertices() );
+        CHECK( a.Get2DVertices() == b.Get2DVertices() );
+        for( uint32_t c = 0; c < a.NumTexChannels(); c++ )
+            CHECK( a.GetTexChannel( c ) == b.GetTexChannel( c ) );
+        CHECK( a.GetFaces() == b.GetFaces() );
+    }
+
+    void CheckSameBlobs( const Blob& a, const Blob& b )
+    {
+        CheckSameContents( a, b );
+        for( uint32_t p = 0; p < a.NumPieces(); p++ ){
+            CHECK( a.GetPieceName( p ) == b.GetPieceName( p ) );
+            CHECK( a.GetPieceVertices( p ).size() == b.GetPieceVertices( p ).size() );
+            CHECK( std::equal( a.GetPieceVertices( p ).begin(), a.GetPieceVertices( p ).end(), b.GetPieceVertices( p ).begin() ) );
+        }
+        for( uint32_t c = 0; c < a.NumCurves(); c++ ){
+            CHECK( a.GetCurveName( c ) == b.GetCurveName( c ) );
+            CHECK( a.GetCurvePiece( c ) == b.GetCurvePiece( c ) );
+            CHECK( std::equal( a.GetCurveVertices( c ).begin(), a.GetCurveVertices( c ).end(), b.GetCurveVertices( c ).begin() ) );
+        }
+        for( const char* name : { "thickness", "weight" } ){
+            CHECK( a.HasGeomData( name ) && b.HasGeomData( name ) );
+            CHECK( a.IsGeomDataFaceCentric( name ) == b.IsGeomDataFaceCentric( name ) );
+            CHECK( a.GetGeomDataView( name ).size() == b.GetGeomDataView( name ).size() );
+            CHECK( std::equal( a.GetGeomDataView( name ).begin(), a.GetGeomDataView( name ).end(), b.GetGeomDataView( name ).begin() ) );
+        }
+    }
+
+    // Saved bytes in 16 byte aligned memory, as a mapping or an engine
+    // buffer would hold them
+    struct AlignedBytes
+    {
+        explicit AlignedBytes( const Blob& blob )
+            : storage( blob.SerializedSize() / sizeof(storage[0]) + 1 ),
+              size( blob.SerializedSize() )
+        {
+            CHECK( blob.Save( data(), size ) == size );
+        }
+
+        char* data()
+        {
+            return reinterpret_cast<char*>( storage.data() );
+        }
+
+        std::vector< std::array<uint64_t, 2> > storage;
+        uint64_t size;
+    };
+
+    void Load( const char* data, uint64_t size )
+    {
+        Blob blob;
+        blob.Load( Blob::BinBuffer{ size, data } );
+    }
+
+    Format::SECTION_ENTRY& SectionEntry( char* data, Format::Section section )
+    {
+        return *reinterpret_cast<Format::SECTION_ENTRY*>( data + Format::FILE_OFFSET + Format::HEADER_FIELDS * sizeof(uint32_t) +
+                                                         section * sizeof(Format::SECTION_ENTRY) );
+    }
+
+    uint32_t& HeaderField( char* data, uint32_t field )
+    {
+        return *reinterpret_cast<uint32_t*>( data + Format::FILE_OFFSET + field * sizeof(uint32_t) );
+    }
+}
+
+int main()
+{
+    const Blob source = MakeBlob();
+
+        // Round trip through a buffer and a stream
+    AlignedBytes bytes( source );
+    {
+        Blob loaded;
+        loaded.Load( Blob::BinBuffer{ bytes.size, bytes.data() } );
+        CHECK( loaded.FileVersionMajor() == 0 && loaded.FileVersionMinor() == 4 );
+        CheckSameBlobs( source, loaded );
+
+        std::stringstream stream;
+        source.Save( stream );
+        CHECK( stream.str() == std::string( bytes.data(), bytes.size ) );
+        Blob streamed;
+        streamed.Load( static_cast<std::istream&>( stream ) );
+        CheckSameBlobs( source, streamed );
+    }
+
+        // Sections start where the table says, aligned
+    {
+        const Format::SECTION_ENTRY faces = SectionEntry( bytes.data(), Format::SECTION_FACES );
+        CHECK( faces.offset % Format::ALIGNMENT == 0 );
+        CHECK( faces.size == source.NumFaces() * sizeof(Format::TRIANGLE) );
+        CHECK( std::memcmp( bytes.data() + faces.offset, source.GetFaces().data(), faces.size ) == 0 );
+    }
+
+        // The view hands out the arrays in place and decodes the rest
+    {
+        BlobView view( bytes.data(), bytes.size );
+        CHECK( view.FileVersionMinor() == 4 );
+        CheckSameContents( source, view );
+        CHECK( view.Mapped3DVertices() != nullptr );
+        CHECK( reinterpret_cast<const char*>( view.MappedFaces() ) - bytes.data() == int64_t( SectionEntry( bytes.data(), Format::SECTION_FACES ).offset ) );
+        CHECK( std::memcmp( view.Mapped3DVertices(), source.Get3DVertices().data(), source.NumVertices() * sizeof(Format::VEC3D) ) == 0 );
+        CHECK( std::memcmp( view.MappedTexChannel( 1 ), source.GetTexChannel( 1 ).data(), source.NumVertices() * sizeof(Format::VEC2D) ) == 0 );
+        CHECK( view.MappedTexChannel( 2 ) == nullptr );
+        CHECK( view.GetPieces().size() == 2 && view.GetPieces()[1].name == "back" );
+        CHECK( view.GetCurves().size() == 2 && view.GetCurves()[0].piece_id == 0 );
+        CHECK( view.GetGeomData().at( "weight" ).second.size() == 8 );
+
+        Blob partial;
+        view.ToBlob( partial, BlobView::SECTION_FACES );
+        CHECK( partial.NumFaces() == 4 && partial.NumPieces() == 0 && !partial.Has2DCoordinates() );
+        Blob whole;
+        view.ToBlob( whole );
+        CheckSameBlobs( source, whole );
+    }
+
+        // Every truncation fails to load and to open
+    for( uint64_t size = 0; size < bytes.size; size++ ){
+        CHECK_THROWS( Load( bytes.data(), size ), std::runtime_error );
+        CHECK_THROWS( BlobView( bytes.data(), size ).Get3DVertices(), std::runtime_error );
+    }
+
+        // Corrupt headers and section tables
+    auto corrupt = [&]( std::function<void( char* )> change, bool view_rejects ){
+        AlignedBytes copy( source );
+        change( copy.data() );
+        CHECK_THROWS( Load( copy.data(), copy.size ), std::runtime_error );
+        if( view_rejects )
+            CHECK_THROWS( BlobView( copy.data(), copy.size ).GetGeomData(), std::runtime_error );
+    };
+    corrupt( [&]( char* data ){ HeaderField( data, 0 ) = 0xffffffff; }, true );                  // texture channels
+    corrupt( [&]( char* data ){ HeaderField( data, 2 ) = 0x10000000; }, true );                  // vertices
+    corrupt( [&]( char* data ){ HeaderField( data, 3 ) = 5; }, true );                           // faces
+    corrupt( [&]( char* data ){ HeaderField( data, 7 ) = Format::SECTION_COUNT - 1; }, true );   // section count
+    corrupt( [&]( char* data ){ reinterpret_cast<uint16_t*>( data )[1] = 9; }, true );           // version
+    corrupt( [&]( char* data ){ SectionEntry( data, Format::SECTION_FACES ).size -= 4; }, true );
+    corrupt( [&]( char* data ){ SectionEntry( data, Format::SECTION_FACES ).offset = bytes.size; }, true );
+    corrupt( [&]( char* data ){ SectionEntry( data, Format::SECTION_VERTICES_3D ).size = ~uint64_t( 0 ); }, true );
+    corrupt( [&]( char* data ){ SectionEntry( data, Format::SECTION_TEXTURE_CHANNELS ).size -= 8; }, true );
+    corrupt( [&]( char* data ){ SectionEntry( data, Format::SECTION_GEOM_DATA ).size += 16; }, true );
+
+        // Faces referring past the vertices are only caught by a full load,
+        // the view doesn't check the contents of its arrays
+    corrupt( [&]( char* data ){
+        const uint64_t offset = SectionEntry( data, Format::SECTION_FACES ).offset;
+        reinterpret_cast<uint32_t*>( data + offset )[4] = 8;
+    }, false );
+
+    return 0;
+}
@@ -0,0 +1,187 @@
+// Blob formats 0.1 to 0.3 loaded into the current format, from buffers,
+// streams and BlobView.
+
+#include "check.hpp"
+
+#include <blob/blob_view.hpp>
+
+#include <algorithm>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+using Geometry::Blob;
+using Geometry::BlobView;
+using namespace Geometry::blob_formats;
+
+namespace
+{
+    const std::vector< std::array<float, 3> > VERTICES_3D = { {0, 0, 0}, {1, 0, 0}, {1, 1, 0}, {0, 1, 0},
+                                                              {2, 0, 0}, {3, 0, 0}, {3, 1, 0}, {2, 1, 0} };
+    const std::vector< std::array<float, 2> > VERTICES_2D = { {0, 0}, {1, 0}, {1, 1}, {0, 1},
+                                                              {2, 0}, {3, 0}, {3, 1}, {2, 1} };
+    const std::vector< std::array<uint32_t, 3> > FACES = { {0, 1, 2}, {0, 2, 3}, {4, 5, 6}, {4, 6, 7} };
+
+    // Two quads, one per piece, each bordered by a curve of its corners.
+    // Piece vertices are left to the formats that have them.
+    template< typename FORMAT >
+    void FillGeometry( FORMAT& format )
+    {
+        format.name = "garment";
+        format.n_texture_channels = 1;
+        format.include_2D_coords = true;
+        format.n_vertices = uint32_t( VERTICES_3D.size() );
+        format.n_faces = uint32_t( FACES.size() );
+        format.n_pieces = 2;
+        format.n_curves = 2;
+        format.vertices_3D = VERTICES_3D;
+        format.vertices_2D = VERTICES_2D;
+        format.texture_channels = { VERTICES_2D };
+        format.faces = FACES;
+        format.curves.resize( 2 );
+        format.curves[0].name = "front border";
+        format.curves[0].piece_id = 0;
+        format.curves[0].vertices = { 0, 1, 2, 3 };
+        format.curves[1].name = "back border";
+        format.curves[1].piece_id = 1;
+        format.curves[1].vertices = { 4, 5, 6, 7 };
+    }
+
+    template< typename FORMAT >
+    void FillPieces( FORMAT& format )
+    {
+        format.pieces.resize( 2 );
+        format.pieces[0].name = "front";
+        format.pieces[0].vertices = { 0, 1, 2, 3 };
+        format.pieces[1].name = "back";
+        format.pieces[1].vertices = { 4, 5, 6, 7 };
+    }
+
+    // A file as Blob writes it: the version, then the format data
+    template< typename FORMAT >
+    std::string Serialize( const FORMAT& format )
+    {
+        std::stringstream stream;
+        stream.exceptions( std::ios_base::failbit | std::ios_base::badbit );
+        const uint16_t version[] = { uint16_t( FORMAT::version_major() ), uint16_t( FORMAT::version_minor() ) };
+        stream.write( reinterpret_cast<const char*>( version ), sizeof( version ) );
+        format.Save( stream );
+        return stream.str();
+    }
+
+    Blob LoadBuffer( const std::string& bytes )
+    {
+        Blob blob;
+        blob.Load( Blob::BinBuffer{ bytes.size(), bytes.data() } );
+        return blob;
+    }
+
+    Blob LoadStream( const std::string& bytes )
+    {
+        std::istringstream stream( bytes );
+        Blob blob;
+        blob.Load( static_cast<std::istream&>( stream ) );
+        return blob;
+    }
+
+    std::vector<uint32_t> Sorted( Geometry::ArrayView<uint32_t> vertices )
+    {
+        std::vector<uint32_t> sorted( vertices.begin(), vertices.end() );
+        std::sort( sorted.begin(), sorted.end() );
+        return sorted;
+    }
+
+    void CheckConverted( Blob blob, uint16_t minor )
+    {
+        CHECK( blob.FileVersionMajor() == 0 && blob.FileVersionMinor() == minor );
+        CHECK( blob.FormatVersionMinor() == Blob().FormatVersionMinor() );
+        CHECK( blob.Name() == "garment" );
+        CHECK( blob.Get3DVertices() == VERTICES_3D );
+        CHECK( blob.Has2DCoordinates() && blob.Get2DVertices() == VERTICES_2D );
+        CHECK( blob.NumTexChannels() == 1 && blob.GetTexChannel( 0 ) == VERTICES_2D );
+        CHECK( blob.GetFaces() == FACES );
+        CHECK( blob.NumPieces() == 2 && blob.GetPieceName( 0 ) == "front" && blob.GetPieceName( 1 ) == "back" );
+        CHECK( Sorted( blob.GetPieceVertices( 0 ) ) == std::vector<uint32_t>( { 0, 1, 2, 3 } ) );
+        CHECK( Sorted( blob.GetPieceVertices( 1 ) ) == std::vector<uint32_t>( { 4, 5, 6, 7 } ) );
+        CHECK( blob.NumCurves() == 2 && blob.GetCurveName( 1 ) == "back border" && blob.GetCurvePiece( 1 ) == 1 );
+    }
+
+    void CheckLegacyFile( const std::string& bytes, uint16_t minor )
+    {
+        CheckConverted( LoadBuffer( bytes ), minor );
+        CheckConverted( LoadStream( bytes ), minor );
+
+        BlobView view( bytes.data(), bytes.size() );
+        CHECK( view.FileVersionMinor() == minor );
+        CHECK( view.Get3DVertices() == VERTICES_3D );
+        CHECK( view.GetFaces() == FACES );
+        CHECK( view.GetCurves().size() == 2 && view.GetPieces().size() == 2 );
+        CHECK( view.Mapped3DVertices() == nullptr );
+        Blob from_view;
+        view.ToBlob( from_view );
+        CheckConverted( std::move( from_view ), minor );
+
+            // Saving the conversion writes the current format
+        const Blob converted = LoadBuffer( bytes );
+        std::string current( converted.SerializedSize(), '\0' );
+        converted.Save( &current[0], current.size() );
+        CheckConverted( LoadBuffer( current ), Blob().FormatVersionMinor() );
+
+        for( size_t size = 0; size < bytes.size(); size++ ){
+            CHECK_THROWS( LoadBuffer( bytes.substr( 0, size ) ), std::runtime_error );
+            CHECK_THROWS( LoadStream( bytes.substr( 0, size ) ), std::runtime_error );
+        }
+    }
+}
+
+int main()
+{
+        // 0.1 has no piece vertices, they are grown from the curves over the faces
+    {
+        format_0_1 legacy;
+        FillGeometry( legacy );
+        legacy.pieces = { "front", "back" };
+        CheckLegacyFile( Serialize( legacy ), 1 );
+    }
+
+    {
+        format_0_2 legacy;
+        FillGeometry( legacy );
+        FillPieces( legacy );
+        CheckLegacyFile( Serialize( legacy ), 2 );
+    }
+
+        // 0.3 adds geometry data, which must come through too
+    {
+        format_0_3 legacy;
+        FillGeometry( legacy );
+        FillPieces( legacy );
+        legacy.geom_data["thickness"] = { true, { 1, 2, 3, 4 } };
+        const std::string bytes = Serialize( legacy );
+        CheckLegacyFile( bytes, 3 );
+
+        const Blob converted = LoadBuffer( bytes );
+        CHECK( converted.IsGeomDataFaceCentric( "thickness" ) && converted.GetGeomDataView( "thickness" ).size() == 4 );
+        CHECK( BlobView( bytes.data(), bytes.size() ).GetGeomData().at( "thickness" ).second[3] == 4 );
+
+            // The current format can still write 0.3 files
+        std::string saved( converted.SerializedSize<format_0_3>(), '\0' );
+        CHECK( converted.Save<format_0_3>( &saved[0], saved.size() ) == saved.size() );
+        CHECK( saved == bytes );
+    }
+
+        // Versions before 0.1 or past the current one are refused
+    {
+        format_0_2 legacy;
+        FillGeometry( legacy );
+        FillPieces( legacy );
+        std::string bytes = Serialize( legacy );
+        bytes[2] = 0;
+        CHECK_THROWS( LoadBuffer( bytes ), Geometry::BlobError::IO );
+        bytes[2] = 5;
+        CHECK_THROWS( LoadBuffer( bytes ), Geometry::BlobError::IO );
+        CHECK_THROWS( BlobView( bytes.data(), bytes.size() ), Geometry::BlobError::IO );
+    }
+
+    return 0;
+}
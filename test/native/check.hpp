@@ -0,0 +1,65 @@
+#ifndef NATIVE_TEST_CHECK_HPP_
+#define NATIVE_TEST_CHECK_HPP_
+
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+// The native tests are plain programs. A failed check prints where it is
+// and exits with a non zero status; run.js runs them all.
+
+#define CHECK( condition ) \
+    do{ \
+        if( !( condition ) ){ \
+            std::fprintf( stderr, "%s:%d: CHECK( %s ) failed\n", __FILE__, __LINE__, #condition ); \
+            std::exit( 1 ); \
+        } \
+    } while( false )
+
+// Passes if evaluating the expression throws `type`, or a class derived
+// from it. Other exceptions are left to end the test.
+#define CHECK_THROWS( expression, type ) \
+    do{ \
+        bool thrown = false; \
+        try{ \
+            (void)( expression ); \
+        } \
+        catch( const type& ){ \
+            thrown = true; \
+        } \
+        if( !thrown ){ \
+            std::fprintf( stderr, "%s:%d: %s did not throw %s\n", __FILE__, __LINE__, #expression, #type ); \
+            std::exit( 1 ); \
+        } \
+    } while( false )
+
+namespace NativeTest
+{
+    inline std::string ReadFile( const std::string& path )
+    {
+        std::ifstream in( path, std::ios::binary );
+        return std::string( std::istreambuf_iterator<char>( in ), std::istreambuf_iterator<char>() );
+    }
+
+    // Fixtures are bytes written by the native side and read back by the JS
+    // tests. Checks that the fixture at path still holds `bytes`, or rewrites
+    // it when update is set.
+    inline bool MatchFixture( const std::string& path, const std::string& bytes, bool update )
+    {
+        if( update ){
+            std::ofstream out( path, std::ios::binary | std::ios::trunc );
+            out.write( bytes.data(), bytes.size() );
+            return bool( out );
+        }
+        if( ReadFile( path ) == bytes )
+            return true;
+        std::fprintf( stderr, "%s is out of date, run the native tests with --update\n", path.c_str() );
+        return false;
+    }
+}
+
+#endif
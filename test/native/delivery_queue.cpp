@@ -0,0 +1,150 @@
+// DeliveryQueue: what each policy does with a full queue, values that may
+// not be dropped, and a blocked producer.
+
+#include "check.hpp"
+
+#include <delivery_queue.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    typedef DeliveryQueue<int> Queue;
+
+    std::vector<int> Drain( Queue& queue )
+    {
+        std::vector<int> values;
+        int value;
+        while( queue.TryPop( value ) )
+            values.push_back( value );
+        return values;
+    }
+
+    // Pushes from another thread, which may block, and reports when it's done
+    struct Producer
+    {
+        Producer( Queue& queue, int value, bool droppable ) :
+            done( false ),
+            thread( [this, &queue, value, droppable]{
+                queue.Push( int( value ), droppable );
+                done = true;
+            } )
+        {}
+
+        ~Producer()
+        {
+            thread.join();
+        }
+
+        // Gives a producer that can go on time to do so
+        bool DoneAfterWaiting()
+        {
+            std::this_thread::sleep_for( std::chrono::milliseconds( 50 ) );
+            return done;
+        }
+
+        std::atomic<bool> done;
+        std::thread thread;
+    };
+}
+
+int main()
+{
+    int value = 0;
+
+        // Capacities below one are raised to one
+    {
+        Queue queue( 0, DeliveryPolicy::DropOldest );
+        CHECK( queue.Capacity() == 1 && queue.Policy() == DeliveryPolicy::DropOldest );
+        CHECK( !queue.TryPop( value ) );
+        CHECK( queue.Push( 1, true ) == Queue::PUSHED );
+        CHECK( queue.Push( 2, true ) == Queue::REPLACED );
+        CHECK( Drain( queue ) == std::vector<int>( { 2 } ) );
+    }
+
+        // DropOldest makes room by dropping the oldest droppable value
+    {
+        Queue queue( 3, DeliveryPolicy::DropOldest );
+        for( int i = 1; i <= 3; ++i )
+            CHECK( queue.Push( int( i ), true ) == Queue::PUSHED );
+        CHECK( queue.Push( 4, true ) == Queue::REPLACED );
+        CHECK( queue.Push( 5, true ) == Queue::REPLACED );
+        CHECK( queue.Depth() == 3 && queue.Dropped() == 2 );
+        CHECK( Drain( queue ) == std::vector<int>( { 3, 4, 5 } ) );
+
+        CHECK( queue.Push( 10, false ) == Queue::PUSHED );
+        CHECK( queue.Push( 11, true ) == Queue::PUSHED );
+        CHECK( queue.Push( 12, true ) == Queue::PUSHED );
+        CHECK( queue.Push( 13, true ) == Queue::REPLACED );
+        CHECK( Drain( queue ) == std::vector<int>( { 10, 12, 13 } ) );
+
+            // With nothing droppable queued, a droppable value is dropped
+            // itself and the others go past the capacity
+        for( int i = 20; i < 23; ++i )
+            CHECK( queue.Push( int( i ), false ) == Queue::PUSHED );
+        CHECK( queue.Push( 23, true ) == Queue::DROPPED );
+        CHECK( queue.Push( 24, false ) == Queue::PUSHED );
+        CHECK( queue.Depth() == 4 && queue.Dropped() == 4 );
+        CHECK( Drain( queue ) == std::vector<int>( { 20, 21, 22, 24 } ) );
+    }
+
+        // Latest keeps a single droppable value, the newest
+    {
+        Queue queue( 4, DeliveryPolicy::Latest );
+        CHECK( queue.Push( 1, true ) == Queue::PUSHED );
+        CHECK( queue.Push( 2, true ) == Queue::REPLACED );
+        CHECK( queue.Push( 3, false ) == Queue::PUSHED );
+        CHECK( queue.Push( 4, true ) == Queue::REPLACED );
+        CHECK( queue.Dropped() == 2 );
+        CHECK( Drain( queue ) == std::vector<int>( { 3, 4 } ) );
+
+        CHECK( queue.Push( 5, false ) == Queue::PUSHED );
+        CHECK( queue.Push( 6, true ) == Queue::PUSHED );
+        CHECK( Drain( queue ) == std::vector<int>( { 5, 6 } ) );
+    }
+
+        // Block holds the producer until the consumer makes room, and never
+        // drops anything
+    {
+        Queue queue( 2, DeliveryPolicy::Block );
+        CHECK( queue.Push( 1, true ) == Queue::PUSHED );
+        CHECK( queue.Push( 2, true ) == Queue::PUSHED );
+        {
+            Producer producer( queue, 3, true );
+            CHECK( !producer.DoneAfterWaiting() );
+            CHECK( queue.TryPop( value ) && value == 1 );
+            CHECK( producer.DoneAfterWaiting() );
+        }
+        CHECK( queue.Dropped() == 0 );
+        CHECK( Drain( queue ) == std::vector<int>( { 2, 3 } ) );
+
+            // Values that may not be dropped wait the same way
+        CHECK( queue.Push( 4, false ) == Queue::PUSHED );
+        CHECK( queue.Push( 5, false ) == Queue::PUSHED );
+        {
+            Producer producer( queue, 6, false );
+            CHECK( !producer.DoneAfterWaiting() );
+            CHECK( queue.TryPop( value ) && value == 4 );
+        }
+        CHECK( Drain( queue ) == std::vector<int>( { 5, 6 } ) );
+    }
+
+        // Closing releases a blocked producer, and later pushes don't wait
+    {
+        Queue queue( 1, DeliveryPolicy::Block );
+        CHECK( queue.Push( 1, true ) == Queue::PUSHED );
+        {
+            Producer producer( queue, 2, true );
+            CHECK( !producer.DoneAfterWaiting() );
+            queue.Close();
+            CHECK( producer.DoneAfterWaiting() );
+        }
+        CHECK( queue.Push( 3, true ) == Queue::PUSHED );
+        CHECK( Drain( queue ) == std::vector<int>( { 1, 2, 3 } ) );
+    }
+
+    return 0;
+}
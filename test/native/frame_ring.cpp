@@ -0,0 +1,110 @@
+// FrameRingWriter: the layout described in src/frame_ring.hpp, and the ring
+// test/frame_ring.js reads with FrameRingReader.
+//
+// Usage: frame_ring <test directory> [--update]
+
+#include "check.hpp"
+
+#include <frame_ring.hpp>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+    const uint32_t SLOTS = 3;
+    const uint32_t MAX_VERTICES = 8;
+    const uint32_t MAX_GARMENTS = 2;
+
+    // Positions of a garment's vertices in a frame; test/frame_ring.js
+    // computes the same ones
+    std::vector<float> GarmentPositions( int32_t frame, int32_t handle, uint32_t n_vertices )
+    {
+        std::vector<float> positions;
+        for( uint32_t i = 0; i < n_vertices * 3; ++i )
+            positions.push_back( float( frame * 100 + handle ) + i * 0.5f );
+        return positions;
+    }
+
+    int32_t Word( const char* data, size_t offset )
+    {
+        int32_t word;
+        std::memcpy( &word, data + offset, sizeof(word) );
+        return word;
+    }
+
+    double Float64( const char* data, size_t offset )
+    {
+        double value;
+        std::memcpy( &value, data + offset, sizeof(value) );
+        return value;
+    }
+
+    // Frame number and vertex counts of the two garments
+    void WriteFrame( FrameRingWriter& writer, int32_t frame, uint32_t vertices_11, uint32_t vertices_12 )
+    {
+        writer.BeginFrame( 4, frame, frame * 10, frame * 0.1 );
+        writer.AddGarment( 11, GarmentPositions( frame, 11, vertices_11 ).data(), vertices_11 );
+        writer.AddGarment( 12, GarmentPositions( frame, 12, vertices_12 ).data(), vertices_12 );
+        writer.EndFrame();
+    }
+}
+
+int main( int argc, char** argv )
+{
+    CHECK( argc >= 2 );
+    const bool update = argc > 2 && std::string( argv[2] ) == "--update";
+
+    const size_t slot_size = FrameRingWriter::SlotSize( MAX_VERTICES, MAX_GARMENTS );
+    const size_t size = FrameRingWriter::ByteLength( SLOTS, MAX_VERTICES, MAX_GARMENTS );
+    CHECK( slot_size % FrameRingWriter::SLOT_ALIGNMENT == 0 );
+    CHECK( slot_size >= FrameRingWriter::SLOT_HEADER_SIZE + MAX_GARMENTS * FrameRingWriter::GARMENT_ENTRY_SIZE + MAX_VERTICES * 12 );
+    CHECK( size == FrameRingWriter::HEADER_SIZE + SLOTS * slot_size );
+
+    std::vector<double> storage( size / sizeof(double) + 1 );
+    char* data = reinterpret_cast<char*>( storage.data() );
+    CHECK_THROWS( FrameRingWriter( data, size, 0, MAX_VERTICES, MAX_GARMENTS ), std::invalid_argument );
+    CHECK_THROWS( FrameRingWriter( data, size - 1, SLOTS, MAX_VERTICES, MAX_GARMENTS ), std::invalid_argument );
+    CHECK_THROWS( FrameRingWriter( data + 4, size, SLOTS, MAX_VERTICES, MAX_GARMENTS ), std::invalid_argument );
+
+    FrameRingWriter writer( data, size, SLOTS, MAX_VERTICES, MAX_GARMENTS );
+    CHECK( Word( data, 0 ) == int32_t( FrameRingWriter::MAGIC ) && Word( data, 4 ) == int32_t( FrameRingWriter::VERSION ) );
+    CHECK( Word( data, 8 ) == int32_t( SLOTS ) && Word( data, 12 ) == int32_t( MAX_VERTICES ) );
+    CHECK( Word( data, 16 ) == int32_t( MAX_GARMENTS ) && Word( data, 20 ) == int32_t( slot_size ) );
+    CHECK( Word( data, 24 ) == 0 && Word( data, 32 ) == 0 );
+
+        // Every status write moves its sequence on by two
+    writer.WriteStatus( 4, 1, 4, 40, 0.4 );
+    writer.WriteStatus( 4, 2, 5, 50, 0.5 );
+    CHECK( Word( data, 32 ) == 4 );
+    CHECK( Word( data, 36 ) == 4 && Word( data, 40 ) == 2 && Word( data, 44 ) == 5 && Word( data, 48 ) == 50 );
+    CHECK( Float64( data, 56 ) == 0.5 );
+
+        // Frame 3 has more vertices than a slot holds. Frame 4 wraps around
+        // to the first slot and fills it exactly.
+    WriteFrame( writer, 1, 3, 2 );
+    WriteFrame( writer, 2, 3, 2 );
+    WriteFrame( writer, 3, 3, 6 );
+    WriteFrame( writer, 4, 3, 5 );
+    CHECK( Word( data, 24 ) == 4 && Word( data, 28 ) == 1 );
+
+    const char* incomplete = data + FrameRingWriter::HEADER_SIZE + 2 * slot_size;
+    CHECK( Word( incomplete, 0 ) == 2 && Word( incomplete, 8 ) == 3 );
+    CHECK( Word( incomplete, 24 ) == 1 && Word( incomplete, 28 ) == 3 && Word( incomplete, 32 ) == int32_t( FrameRingWriter::FLAG_INCOMPLETE ) );
+
+    const char* latest = data + FrameRingWriter::HEADER_SIZE;
+    CHECK( Word( latest, 0 ) == 4 );
+    CHECK( Word( latest, 4 ) == 4 && Word( latest, 8 ) == 4 && Word( latest, 12 ) == 40 && Float64( latest, 16 ) == 4 * 0.1 );
+    CHECK( Word( latest, 24 ) == 2 && Word( latest, 28 ) == 8 && Word( latest, 32 ) == 0 );
+    const size_t entries = FrameRingWriter::SLOT_HEADER_SIZE;
+    CHECK( Word( latest, entries ) == 11 && Word( latest, entries + 4 ) == 0 && Word( latest, entries + 8 ) == 3 );
+    CHECK( Word( latest, entries + 16 ) == 12 && Word( latest, entries + 20 ) == 3 && Word( latest, entries + 24 ) == 5 );
+    const size_t positions = entries + MAX_GARMENTS * FrameRingWriter::GARMENT_ENTRY_SIZE;
+    CHECK( std::memcmp( latest + positions, GarmentPositions( 4, 11, 3 ).data(), 3 * 12 ) == 0 );
+    CHECK( std::memcmp( latest + positions + 3 * 12, GarmentPositions( 4, 12, 5 ).data(), 5 * 12 ) == 0 );
+
+    CHECK( NativeTest::MatchFixture( std::string( argv[1] ) + "/frame_ring.bin", std::string( data, size ), update ) );
+
+    return 0;
+}
@@ -0,0 +1,177 @@
+// MeshCache: keys, hits and misses, entries the verifier rejects,
+// copy-on-write hits and least recently used eviction, in a directory of
+// its own under the system temporary directory.
+
+#include "check.hpp"
+
+#include <mesh_cache.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#if defined(PLATFORM_WINDOWS)
+#include <direct.h>
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace
+{
+    std::string TestDirectory()
+    {
+        std::string temp = "/tmp";
+        for( const char* variable : { "TMPDIR", "TEMP", "TMP" } ){
+            if( const char* value = std::getenv( variable ) ){
+                temp = value;
+                break;
+            }
+        }
+#if defined(PLATFORM_WINDOWS)
+        const int pid = ::_getpid();
+#else
+        const int pid = ::getpid();
+#endif
+        return temp + "/arcsim_mesh_cache_test_" + std::to_string( pid );
+    }
+
+    void RemoveDirectory( const std::string& directory )
+    {
+#if defined(PLATFORM_WINDOWS)
+        ::_rmdir( directory.c_str() );
+#else
+        ::rmdir( directory.c_str() );
+#endif
+    }
+
+    bool FileExists( const std::string& path )
+    {
+        return bool( std::ifstream( path.c_str() ) );
+    }
+
+    void WriteFile( const std::string& path, const std::string& bytes )
+    {
+        std::ofstream out( path.c_str(), std::ios::binary | std::ios::trunc );
+        out.write( bytes.data(), bytes.size() );
+    }
+
+    // Entries are ten bytes starting with GOOD
+    std::string Entry( char fill )
+    {
+        return "GOOD" + std::string( 6, fill );
+    }
+
+    bool Verify( const char* data, uint64_t size )
+    {
+        return size >= 4 && std::memcmp( data, "GOOD", 4 ) == 0;
+    }
+
+    std::string Found( MeshCache& cache, const std::string& key )
+    {
+        std::unique_ptr<Geometry::MappedFile> file = cache.Find( key, Verify );
+        return file ? std::string( file->data(), file->size() ) : std::string();
+    }
+
+    MeshingParams Params( float edge_length )
+    {
+        MeshingParams params;
+        params.edge_length = edge_length;
+        params.max_deviation = 0.1f;
+        params.min_subdiv = 0.05f;
+        params.callback = CallbackHook{ nullptr, nullptr };
+        return params;
+    }
+}
+
+int main()
+{
+    const std::string directory = TestDirectory();
+    std::vector<std::string> keys;
+    {
+        MeshCache cache( directory, 30, "engine 1" );
+        auto path = [&]( const std::string& key ){ return directory + "/" + key + ".scene"; };
+
+            // Keys ignore how the JSON is written, but nothing else
+        const std::string garment = "{\"pieces\": [1, 2], \"name\": \"shirt\"}";
+        const std::string key = cache.Key( garment, Params( 1 ) );
+        CHECK( key == cache.Key( "{ \"name\":\"shirt\",\n  \"pieces\":[1,2] }", Params( 1 ) ) );
+        CHECK( key != cache.Key( garment, Params( 2 ) ) );
+        CHECK( key != cache.Key( garment, Params( 1 ), "part" ) );
+        CHECK( key != cache.Key( "{\"pieces\": [1, 3], \"name\": \"shirt\"}", Params( 1 ) ) );
+        CHECK( key != MeshCache( directory, 30, "engine 2" ).Key( garment, Params( 1 ) ) );
+        CHECK( cache.Key( "not json", Params( 1 ) ) != cache.Key( "not json ", Params( 1 ) ) );
+        for( int i = 0; i < 5; ++i )
+            keys.push_back( cache.Key( garment, Params( 1 ), "entry " + std::to_string( i ) ) );
+
+        CHECK( Found( cache, keys[0] ).empty() );
+        cache.Store( keys[0], Entry( 'a' ).data(), 10 );
+        CHECK( Found( cache, keys[0] ) == Entry( 'a' ) );
+        MeshCache::Stats stats = cache.GetStats();
+        CHECK( stats.hits == 1 && stats.misses == 1 && stats.stores == 1 );
+        CHECK( stats.entries == 1 && stats.bytes == 10 && stats.max_bytes == 30 );
+
+            // Hits are copy-on-write mappings
+        {
+            std::unique_ptr<Geometry::MappedFile> file = cache.Find( keys[0], Verify );
+            CHECK( file );
+            std::memset( file->data(), 'x', file->size() );
+        }
+        CHECK( Found( cache, keys[0] ) == Entry( 'a' ) );
+
+            // Entries larger than the cache aren't kept
+        cache.Store( keys[1], std::string( 31, 'G' ).data(), 31 );
+        CHECK( !FileExists( path( keys[1] ) ) && cache.GetStats().stores == 1 );
+
+            // The least recently used entry makes room, hits count as uses
+        cache.Store( keys[1], Entry( 'b' ).data(), 10 );
+        cache.Store( keys[2], Entry( 'c' ).data(), 10 );
+        CHECK( Found( cache, keys[0] ) == Entry( 'a' ) );
+        cache.Store( keys[3], Entry( 'd' ).data(), 10 );
+        stats = cache.GetStats();
+        CHECK( stats.evictions == 1 && stats.entries == 3 && stats.bytes == 30 );
+        CHECK( !FileExists( path( keys[1] ) ) );
+        CHECK( Found( cache, keys[1] ).empty() );
+        CHECK( Found( cache, keys[0] ) == Entry( 'a' ) );
+        CHECK( Found( cache, keys[2] ) == Entry( 'c' ) );
+        CHECK( Found( cache, keys[3] ) == Entry( 'd' ) );
+
+            // Storing a key again replaces its entry
+        cache.Store( keys[3], Entry( 'e' ).data(), 10 );
+        CHECK( Found( cache, keys[3] ) == Entry( 'e' ) );
+        CHECK( cache.GetStats().bytes == 30 );
+
+            // Entries the verifier rejects, or left empty, are removed and miss
+        WriteFile( path( keys[2] ), "BAD" );
+        const uint64_t misses = cache.GetStats().misses;
+        CHECK( Found( cache, keys[2] ).empty() );
+        CHECK( !FileExists( path( keys[2] ) ) );
+        WriteFile( path( keys[3] ), "" );
+        CHECK( Found( cache, keys[3] ).empty() );
+        stats = cache.GetStats();
+        CHECK( stats.misses == misses + 2 && stats.entries == 1 && stats.bytes == 10 );
+
+            // Entries another process stored are found
+        WriteFile( path( keys[4] ), Entry( 'f' ) );
+        CHECK( Found( cache, keys[4] ) == Entry( 'f' ) );
+        CHECK( cache.GetStats().entries == 2 && cache.GetStats().bytes == 20 );
+    }
+
+        // A new cache picks up the directory and trims it to its own size
+    {
+        MeshCache cache( directory, 30, "engine 1" );
+        CHECK( cache.GetStats().entries == 2 && cache.GetStats().bytes == 20 );
+        CHECK( Found( cache, keys[4] ) == Entry( 'f' ) );
+
+        MeshCache smaller( directory, 10, "engine 1" );
+        CHECK( smaller.GetStats().entries == 1 && smaller.GetStats().evictions == 1 );
+    }
+
+    for( const std::string& key : keys )
+        std::remove( ( directory + "/" + key + ".scene" ).c_str() );
+    RemoveDirectory( directory );
+    return 0;
+}
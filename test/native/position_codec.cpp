@@ -0,0 +1,158 @@
+// PositionCodec: bounds, quantization and delta coding against scalar
+// references, and the frames test/quantized_positions.js decodes.
+//
+// Usage: position_codec <test directory> [--update]
+
+#include "check.hpp"
+
+#include <translation/position_codec.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // Garment positions of a frame; test/quantized_positions.js computes
+    // the same ones
+    std::vector<float> FramePositions( uint32_t n_vertices, uint32_t frame )
+    {
+        std::vector<float> positions;
+        for( uint32_t v = 0; v < n_vertices; ++v ){
+            positions.push_back( float( v * 0.25 + frame * 0.01 ) );
+            positions.push_back( float( ( v % 3 ) * 0.5 - frame * 0.02 ) );
+            positions.push_back( float( -( v * 0.125 ) + ( frame % 2 ) * 0.03 ) );
+        }
+        return positions;
+    }
+
+    QuantizedPositionsHeader Header( const PackedBuffer& packed )
+    {
+        QuantizedPositionsHeader header;
+        std::memcpy( &header, packed.data(), sizeof(header) );
+        return header;
+    }
+
+    std::vector<uint16_t> Values( const PackedBuffer& packed )
+    {
+        const uint16_t* values = reinterpret_cast<const uint16_t*>( packed.data() + sizeof(QuantizedPositionsHeader) );
+        return std::vector<uint16_t>( values, values + Header( packed ).vertex_count * 3 );
+    }
+
+    // What the JS decoder does: adds delta values to the previous ones,
+    // then dequantizes
+    std::vector<float> Decode( const PackedBuffer& packed, std::vector<uint16_t>& previous )
+    {
+        const QuantizedPositionsHeader header = Header( packed );
+        std::vector<uint16_t> values = Values( packed );
+        if( header.flags & PositionCodec::FLAG_DELTA ){
+            CHECK( previous.size() == values.size() );
+            for( size_t i = 0; i < values.size(); ++i )
+                values[i] = uint16_t( previous[i] + values[i] );
+        }
+        previous = values;
+
+        std::vector<float> positions( values.size() );
+        for( size_t i = 0; i < values.size(); ++i )
+            positions[i] = header.min[i % 3] + values[i] * header.step[i % 3];
+        return positions;
+    }
+
+    void CheckWithinHalfStep( const std::vector<float>& decoded, const std::vector<float>& positions, const float step[3] )
+    {
+        CHECK( decoded.size() == positions.size() );
+        for( size_t i = 0; i < positions.size(); ++i )
+            CHECK( std::fabs( decoded[i] - positions[i] ) <= step[i % 3] * 0.5f + 1e-6f );
+    }
+
+    void AppendFrame( std::string& fixture, const PackedBuffer& packed )
+    {
+        const uint32_t size = uint32_t( packed.size() );
+        fixture.append( reinterpret_cast<const char*>( &size ), sizeof(size) );
+        fixture.append( reinterpret_cast<const char*>( packed.data() ), packed.size() );
+    }
+}
+
+int main( int argc, char** argv )
+{
+    CHECK( argc >= 2 );
+    const bool update = argc > 2 && std::string( argv[2] ) == "--update";
+
+        // The vector paths against scalar references, on counts that leave
+        // a scalar tail
+    for( uint32_t n_vertices : { 0u, 1u, 3u, 4u, 7u, 8u, 37u } ){
+        const std::vector<float> positions = FramePositions( n_vertices, 3 );
+        float min[3], max[3];
+        PositionCodec::ComputeBounds( positions.data(), n_vertices, min, max );
+        for( int c = 0; c < 3; ++c ){
+            float low = n_vertices ? positions[c] : 0.0f, high = low;
+            for( uint32_t v = 0; v < n_vertices; ++v ){
+                low = std::min( low, positions[3 * v + c] );
+                high = std::max( high, positions[3 * v + c] );
+            }
+            CHECK( min[c] == low && max[c] == high );
+        }
+
+        float step[3];
+        for( int c = 0; c < 3; ++c )
+            step[c] = ( max[c] - min[c] ) / 65535.0f;
+        std::vector<uint16_t> quantized( positions.size() );
+        PositionCodec::Quantize( positions.data(), n_vertices, min, step, quantized.data() );
+        for( size_t i = 0; i < positions.size(); ++i ){
+            const float scale = step[i % 3] > 0.0f ? 1.0f / step[i % 3] : 0.0f;
+            const long expected = std::lrint( ( positions[i] - min[i % 3] ) * scale );
+            CHECK( quantized[i] == std::min( std::max( expected, 0L ), 65535L ) );
+        }
+
+        std::vector<uint16_t> values = quantized, history( quantized.size() );
+        for( size_t i = 0; i < history.size(); ++i )
+            history[i] = uint16_t( 65535 - i * 977 );
+        const std::vector<uint16_t> previous = history;
+        PositionCodec::DeltaEncode( values.data(), history.data(), values.size() );
+        CHECK( history == quantized );
+        for( size_t i = 0; i < values.size(); ++i )
+            CHECK( uint16_t( previous[i] + values[i] ) == quantized[i] );
+    }
+
+        // Flat garments quantize to zero on the flat axis
+    {
+        std::vector<float> positions = FramePositions( 10, 0 );
+        for( size_t i = 2; i < positions.size(); i += 3 )
+            positions[i] = 1.5f;
+        const PackedBuffer packed = PositionCodec::Encode( positions.data(), 10, 1, nullptr );
+        CHECK( Header( packed ).step[2] == 0.0f && Header( packed ).min[2] == 1.5f );
+        const std::vector<uint16_t> values = Values( packed );
+        for( size_t i = 2; i < values.size(); i += 3 )
+            CHECK( values[i] == 0 );
+    }
+
+        // A history delta codes frames with the same vertex count only. The
+        // fixture interleaves two garments, the first of which changes its
+        // vertex count on frame 2.
+    std::string fixture;
+    std::vector<uint16_t> history_7, history_9, decoded_7, decoded_9;
+    const uint32_t vertices_7[] = { 10, 10, 6, 6 };
+    for( uint32_t frame = 0; frame < 4; ++frame ){
+        const std::vector<float> positions = FramePositions( vertices_7[frame], frame );
+        const PackedBuffer packed = PositionCodec::Encode( positions.data(), vertices_7[frame], 7, &history_7 );
+        const QuantizedPositionsHeader header = Header( packed );
+        CHECK( header.version == PositionCodec::VERSION && header.garment_handle == 7 && header.vertex_count == vertices_7[frame] );
+        CHECK( bool( header.flags & PositionCodec::FLAG_DELTA ) == ( frame % 2 == 1 ) );
+        CHECK( packed.size() == sizeof(QuantizedPositionsHeader) + vertices_7[frame] * 3 * sizeof(uint16_t) );
+        CheckWithinHalfStep( Decode( packed, decoded_7 ), positions, header.step );
+        AppendFrame( fixture, packed );
+
+        if( frame < 2 ){
+            const std::vector<float> other = FramePositions( 9, frame + 5 );
+            const PackedBuffer packed_9 = PositionCodec::Encode( other.data(), 9, 9, &history_9 );
+            CHECK( bool( Header( packed_9 ).flags & PositionCodec::FLAG_DELTA ) == ( frame == 1 ) );
+            CheckWithinHalfStep( Decode( packed_9, decoded_9 ), other, Header( packed_9 ).step );
+            AppendFrame( fixture, packed_9 );
+        }
+    }
+    CHECK( NativeTest::MatchFixture( std::string( argv[1] ) + "/quantized_positions.bin", fixture, update ) );
+
+    return 0;
+}
@@ -0,0 +1,29 @@
+// Runs the native tests, once built with
+//     node-gyp rebuild -C test/native
+// Tests that write fixtures for the JS tests check them against the test
+// directory; pass --update to rewrite them after a deliberate format change.
+const path = require('path');
+const child_process = require('child_process');
+
+const tests = [
+    'blob_format',
+    'blob_legacy',
+    'position_codec',
+    'delivery_queue',
+    'frame_ring',
+    'mesh_cache',
+    'sdf_codec'
+];
+
+const suffix = process.platform == 'win32' ? '.exe' : '';
+let failed = 0;
+for( const test of tests ){
+    const program = path.join(__dirname, 'build', 'Release', test + suffix);
+    const result = child_process.spawnSync(program, [ path.join(__dirname, '..') ].concat(process.argv.slice(2)),
+                                           { stdio: 'inherit' });
+    const passed = result.status == 0;
+    console.log((passed ? 'ok     ' : 'FAILED ') + test);
+    if( !passed )
+        failed++;
+}
+process.exit(failed ? 1 : 0);
@@ -0,0 +1,236 @@
+// SDF data layouts: dense packing, lossless conversions to and from sparse
+// bricks, SdfView lookups in both layouts and malformed data.
+
+#include "check.hpp"
+
+#include <sdf/sdf_codec.hpp>
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    // Offsets into the headers, see sdf_codec.hpp
+    const size_t DENSE_SAMPLES_OFFSET = 28;
+    const size_t BRICK_SIZE_OFFSET = 28;
+    const size_t NUM_BRICKS_OFFSET = 32;
+    const size_t SLOTS_OFFSET = 36;
+
+    uint32_t Word( const ARCSim::SdfT& sdf, size_t offset )
+    {
+        uint32_t word;
+        std::memcpy( &word, sdf.data.data() + offset, sizeof(word) );
+        return word;
+    }
+
+    void SetWord( ARCSim::SdfT& sdf, size_t offset, uint32_t word )
+    {
+        std::memcpy( sdf.data.data() + offset, &word, sizeof(word) );
+    }
+
+    // Distance to the plane x = 0, with sizes that aren't whole bricks
+    Sdf::Grid PlaneGrid()
+    {
+        Sdf::Grid grid;
+        grid.size[0] = 61; grid.size[1] = 13; grid.size[2] = 11;
+        grid.origin = {{ -0.3f, 1.0f, 2.0f }};
+        grid.dx = 0.01f;
+        grid.values.resize( grid.NumSamples() );
+        for( uint32_t k = 0; k < grid.size[2]; ++k )
+            for( uint32_t j = 0; j < grid.size[1]; ++j )
+                for( uint32_t i = 0; i < grid.size[0]; ++i )
+                    grid.values[grid.Index( i, j, k )] = grid.origin[0] + i * grid.dx;
+        return grid;
+    }
+
+    // Unit cube from the origin, faces wound outwards
+    Sdf::Grid CubeGrid( const Sdf::SdfOptions& options )
+    {
+        std::vector<Sdf::Vec3f> vertices;
+        for( int v = 0; v < 8; ++v )
+            vertices.push_back( {{ float( v & 1 ), float( ( v >> 1 ) & 1 ), float( ( v >> 2 ) & 1 ) }} );
+        const std::vector<Sdf::Triangle> triangles = {
+            {{0, 2, 1}}, {{1, 2, 3}}, {{4, 5, 6}}, {{5, 7, 6}},
+            {{0, 1, 4}}, {{1, 5, 4}}, {{2, 6, 3}}, {{3, 6, 7}},
+            {{0, 4, 2}}, {{2, 4, 6}}, {{1, 3, 5}}, {{3, 7, 5}} };
+        return Sdf::BuildGrid( vertices, triangles, options );
+    }
+
+    // Every sample and distance of the views agree with the dense grid
+    void CheckViews( const ARCSim::SdfT& dense, const ARCSim::SdfT& sparse )
+    {
+        const Sdf::Grid grid = Sdf::UnpackDense( dense );
+        const Sdf::SdfView dense_view( dense );
+        const Sdf::SdfView sparse_view( sparse );
+        for( int axis = 0; axis < 3; ++axis ){
+            CHECK( dense_view.Size( axis ) == grid.size[axis] && sparse_view.Size( axis ) == grid.size[axis] );
+            CHECK( dense_view.Origin()[axis] == grid.origin[axis] && sparse_view.Origin()[axis] == grid.origin[axis] );
+        }
+
+        for( uint32_t k = 0; k < grid.size[2]; ++k )
+            for( uint32_t j = 0; j < grid.size[1]; ++j )
+                for( uint32_t i = 0; i < grid.size[0]; ++i ){
+                    CHECK( sparse_view.Sample( i, j, k ) == dense_view.Sample( i, j, k ) );
+                    CHECK( dense_view.Sample( i, j, k ) == dense.data[DENSE_SAMPLES_OFFSET + grid.Index( i, j, k )] );
+                    CHECK( dense_view.Distance( i, j, k ) == grid.values[grid.Index( i, j, k )] );
+                    CHECK( sparse_view.Distance( i, j, k ) == grid.values[grid.Index( i, j, k )] );
+
+                        // Rounding may put the far samples' positions off the grid
+                    if( i + 1 == grid.size[0] || j + 1 == grid.size[1] || k + 1 == grid.size[2] )
+                        continue;
+                    const Sdf::Vec3f position = {{ grid.origin[0] + i * grid.dx,
+                                                   grid.origin[1] + j * grid.dx,
+                                                   grid.origin[2] + k * grid.dx }};
+                    CHECK( std::fabs( sparse_view.Distance( position ) - grid.values[grid.Index( i, j, k )] ) < 1e-5f );
+                }
+    }
+
+    // Layout conversions of a dense SDF, checked both ways
+    void CheckConversions( const ARCSim::SdfT& dense )
+    {
+        std::unique_ptr<ARCSim::SdfT> sparse = Sdf::ToSparse( dense );
+        CHECK( Sdf::IsSparse( *sparse ) && !Sdf::IsDense( *sparse ) );
+        CHECK( sparse->data.size() < dense.data.size() );
+        CHECK( sparse->dx == dense.dx && sparse->innerband == dense.innerband && sparse->outerband == dense.outerband );
+        CHECK( Word( *sparse, BRICK_SIZE_OFFSET ) == Sdf::SPARSE_BRICK_SIZE );
+
+        std::unique_ptr<ARCSim::SdfT> back = Sdf::ToDense( *sparse );
+        CHECK( Sdf::IsDense( *back ) && back->data == dense.data );
+        CHECK( back->dx == dense.dx && back->innerband == dense.innerband && back->outerband == dense.outerband );
+
+            // Converting to the layout data already has copies it
+        CHECK( Sdf::ToSparse( *sparse )->data == sparse->data );
+        CHECK( Sdf::ToDense( dense )->data == dense.data );
+
+        CheckViews( dense, *sparse );
+    }
+}
+
+int main()
+{
+        // Distances map onto bytes across the bands and clamp past them
+    {
+        const Sdf::Grid grid = PlaneGrid();
+        std::unique_ptr<ARCSim::SdfT> dense = Sdf::PackDense( grid, 0.02f, 0.04f );
+        CHECK( Sdf::IsDense( *dense ) && !Sdf::IsSparse( *dense ) );
+        CHECK( dense->dx == grid.dx && dense->innerband == 0.02f && dense->outerband == 0.04f );
+        CHECK( dense->data.size() == DENSE_SAMPLES_OFFSET + grid.NumSamples() );
+
+        const Sdf::SdfView view( *dense );
+        CHECK( view.Sample( 0, 0, 0 ) == 0 && view.Sample( 1, 12, 10 ) == 0 );
+        CHECK( view.Sample( 30, 0, 0 ) == 85 );
+        CHECK( view.Sample( 60, 6, 5 ) == 255 );
+        CHECK( std::fabs( view.Distance( 2, 0, 0 ) + 0.02f ) < 1e-6f );
+
+        const Sdf::Grid unpacked = Sdf::UnpackDense( *dense );
+        CHECK( unpacked.dx == grid.dx );
+        for( size_t s = 0; s < grid.NumSamples(); ++s ){
+            const float clamped = std::fmin( std::fmax( grid.values[s], -0.02f ), 0.04f );
+            CHECK( std::fabs( unpacked.values[s] - clamped ) <= 0.5f * 0.06f / 255 + 1e-6f );
+        }
+
+            // Interpolated between samples, and the outer band off the grid
+        const Sdf::Vec3f between = {{ grid.origin[0] + 30.5f * grid.dx, 1.05f, 2.04f }};
+        CHECK( std::fabs( view.Distance( between ) - 0.5f * ( view.Distance( 30, 5, 4 ) + view.Distance( 31, 5, 4 ) ) ) < 1e-5f );
+        CHECK( std::fabs( view.Distance( {{ 0.5f, 1.0f, 2.0f }} ) - 0.04f ) < 1e-5f );
+        CHECK( std::fabs( view.Distance( {{ 0.0f, 0.5f, 2.0f }} ) - 0.04f ) < 1e-5f );
+
+        CheckConversions( *dense );
+        CHECK_THROWS( Sdf::PackDense( grid, 0, 0 ), std::invalid_argument );
+    }
+
+        // A cube as BuildGrid samples it: uniform bricks inside and outside
+        // the bands, stored ones along the faces
+    {
+        Sdf::SdfOptions options;
+        options.dx = 0.02f;
+        options.innerband = 0.1f;
+        options.outerband = 0.1f;
+        options.threads = 2;
+        std::unique_ptr<ARCSim::SdfT> dense = Sdf::PackDense( CubeGrid( options ), options.innerband, options.outerband );
+        CheckConversions( *dense );
+
+        std::unique_ptr<ARCSim::SdfT> sparse = Sdf::ToSparse( *dense );
+        const Sdf::SdfView view( *sparse );
+        CHECK( std::fabs( view.Distance( {{ 0.5f, 0.5f, 0.5f }} ) + 0.1f ) < 1e-5f );
+        CHECK( std::fabs( view.Distance( {{ 1.05f, 0.5f, 0.5f }} ) - 0.05f ) < options.dx );
+        CHECK( std::fabs( view.Distance( {{ 0.5f, 0.96f, 0.5f }} ) + 0.04f ) < options.dx );
+        CHECK( std::fabs( view.Distance( {{ 3.0f, 0.5f, 0.5f }} ) - 0.1f ) < 1e-5f );
+
+        size_t num_slots = 1;
+        for( int axis = 0; axis < 3; ++axis )
+            num_slots *= ( view.Size( axis ) + Sdf::SPARSE_BRICK_SIZE - 1 ) / Sdf::SPARSE_BRICK_SIZE;
+        bool uniform = false, stored = false;
+        for( size_t slot = 0; slot < num_slots; ++slot ){
+            const uint32_t value = Word( *sparse, SLOTS_OFFSET + 4 * slot );
+            uniform = uniform || value >= Sdf::UNIFORM_SLOT;
+            stored = stored || value < Word( *sparse, NUM_BRICKS_OFFSET );
+        }
+        CHECK( uniform && stored );
+    }
+
+        // Grids no larger than a brick stay dense
+    {
+        Sdf::Grid grid;
+        grid.size[0] = grid.size[1] = grid.size[2] = 2;
+        grid.dx = 1;
+        grid.values = { -1, 0, 1, 2, -1, 0, 1, 2 };
+        std::unique_ptr<ARCSim::SdfT> dense = Sdf::PackDense( grid, 1, 1 );
+        std::unique_ptr<ARCSim::SdfT> kept = Sdf::ToSparse( *dense );
+        CHECK( Sdf::IsDense( *kept ) && kept->data == dense->data );
+        CHECK( kept->innerband == 1 && kept->outerband == 1 );
+    }
+
+        // Malformed data is refused by the view and both conversions
+    {
+        std::unique_ptr<ARCSim::SdfT> dense = Sdf::PackDense( PlaneGrid(), 0.02f, 0.04f );
+        std::unique_ptr<ARCSim::SdfT> sparse = Sdf::ToSparse( *dense );
+        CHECK( Word( *sparse, NUM_BRICKS_OFFSET ) > 0 );
+
+        auto check_rejected = [&]( const ARCSim::SdfT& sdf ){
+            CHECK_THROWS( Sdf::SdfView( sdf ), std::invalid_argument );
+            CHECK_THROWS( Sdf::ToSparse( sdf ), std::invalid_argument );
+            CHECK_THROWS( Sdf::ToDense( sdf ), std::invalid_argument );
+        };
+
+        ARCSim::SdfT broken = *dense;
+        broken.data.pop_back();
+        check_rejected( broken );
+        CHECK_THROWS( Sdf::UnpackDense( broken ), std::invalid_argument );
+
+        broken = *dense;
+        broken.data[0] = 'X';
+        check_rejected( broken );
+
+        broken = *sparse;
+        broken.data.resize( 20 );
+        check_rejected( broken );
+
+        broken = *sparse;
+        broken.data.pop_back();
+        check_rejected( broken );
+
+        broken = *sparse;
+        SetWord( broken, BRICK_SIZE_OFFSET, 0 );
+        check_rejected( broken );
+
+        broken = *sparse;
+        SetWord( broken, NUM_BRICKS_OFFSET, Word( *sparse, NUM_BRICKS_OFFSET ) + 1 );
+        check_rejected( broken );
+
+            // A slot past the stored bricks
+        broken = *sparse;
+        for( size_t offset = SLOTS_OFFSET; ; offset += 4 )
+            if( Word( broken, offset ) < Sdf::UNIFORM_SLOT ){
+                SetWord( broken, offset, Word( broken, NUM_BRICKS_OFFSET ) );
+                break;
+            }
+        check_rejected( broken );
+
+        CHECK_THROWS( Sdf::UnpackDense( *sparse ), std::invalid_argument );
+        CHECK_THROWS( Sdf::SdfView( ARCSim::SdfT() ), std::invalid_argument );
+    }
+
+    return 0;
+}
@@ -0,0 +1,68 @@
+// Decodes quantized_positions.bin, frames PositionCodec wrote in
+// test/native/position_codec.cpp, and checks them against the positions
+// it encoded. Garment 7 sends two 10 vertex frames, full then delta, then
+// two 6 vertex ones; garment 9 sends two 9 vertex frames in between.
+const assert = require('assert');
+const fs = require('fs');
+const path = require('path');
+const arcsim = require("../lib/index.js");
+
+// Same as FramePositions in position_codec.cpp
+const framePositions = (n_vertices, frame) => {
+    const positions = new Float32Array(n_vertices * 3);
+    for( let v = 0; v < n_vertices; ++v ){
+        positions[3 * v] = v * 0.25 + frame * 0.01;
+        positions[3 * v + 1] = ( v % 3 ) * 0.5 - frame * 0.02;
+        positions[3 * v + 2] = -( v * 0.125 ) + ( frame % 2 ) * 0.03;
+    }
+    return positions;
+};
+
+const fixture = fs.readFileSync(path.join(__dirname, 'quantized_positions.bin'));
+const buffers = [];
+for( let offset = 0; offset < fixture.length; ){
+    const size = fixture.readUInt32LE(offset);
+    buffers.push(new Uint8Array(fixture.buffer, fixture.byteOffset + offset + 4, size));
+    offset += 4 + size;
+}
+
+const expected = [
+    { handle: 7, delta: false, positions: framePositions(10, 0) },
+    { handle: 9, delta: false, positions: framePositions(9, 5) },
+    { handle: 7, delta: true, positions: framePositions(10, 1) },
+    { handle: 9, delta: true, positions: framePositions(9, 6) },
+    { handle: 7, delta: false, positions: framePositions(6, 2) },
+    { handle: 7, delta: true, positions: framePositions(6, 3) }
+];
+assert.strictEqual(buffers.length, expected.length);
+
+const decoder = new arcsim.QuantizedPositionDecoder();
+buffers.forEach((bytes, index) => {
+    const header = new DataView(bytes.buffer, bytes.byteOffset, arcsim.QuantizedPositionDecoder.HEADER_SIZE);
+    const flags = header.getUint16(2, true);
+    const step = [ header.getFloat32(28, true), header.getFloat32(32, true), header.getFloat32(36, true) ];
+    assert.strictEqual(( flags & arcsim.QuantizedPositionDecoder.FLAG_DELTA ) != 0, expected[index].delta);
+
+    const { garment_handle, positions } = decoder.decode(bytes);
+    assert.strictEqual(garment_handle, expected[index].handle);
+    assert.strictEqual(positions.length, expected[index].positions.length);
+    positions.forEach((value, i) => {
+        assert.ok(Math.abs(value - expected[index].positions[i]) <= step[i % 3] * 0.5 + 1e-6,
+                  "frame " + index + " value " + i + " is " + value + ", expected " + expected[index].positions[i]);
+    });
+});
+
+// Delta frames need the frame before them, with the same vertex count
+const fresh = new arcsim.QuantizedPositionDecoder();
+assert.throws(() => fresh.decode(buffers[2]), /Missing previous positions/);
+fresh.decode(buffers[0]);
+assert.throws(() => fresh.decode(buffers[5]), /Missing previous positions/);
+fresh.reset();
+assert.throws(() => fresh.decode(buffers[2]), /Missing previous positions/);
+
+// Unknown versions are refused
+const future = new Uint8Array(buffers[0]);
+future[0] = 2;
+assert.throws(() => fresh.decode(future), /Unsupported quantized positions version/);
+
+console.log("quantized positions ok");